@@ -0,0 +1,217 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "encoder.h"
+#include "qr_batch.h"
+#include "qr_output.h"
+#include "qr_terminal.h"
+
+static int failures = 0;
+
+static void check(bool passed, std::string_view what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << "\n";
+    ++failures;
+  }
+}
+
+// Bytes of a mapped file in each chunk, as in qr_batch.cc.
+static const std::size_t kChunkLength = 1 << 14;
+
+// What a batch wrote.
+struct Result {
+  std::string output;
+  std::string errors;
+  BatchSummary summary;
+}; // Result
+
+static std::string readAll(std::FILE* file) {
+  std::string text;
+  char buffer[1 << 16];
+  std::rewind(file);
+  for (std::size_t count; (count = std::fread(buffer, 1, sizeof buffer,
+                                              file)) > 0;) {
+    text.append(buffer, count);
+  }
+  return text;
+}
+
+// Runs a batch on the input, from a file so it is mapped, or from a pipe
+// written by another thread. stderr is caught in a file while it runs.
+static Result runBatch(const BatchOptions& options, const std::string& input,
+                       bool pipe) {
+  std::FILE* out = std::tmpfile();
+  std::FILE* errors = std::tmpfile();
+  std::FILE* file = nullptr;
+  int fds[2] = {-1, -1};
+  std::thread writer;
+  int in;
+  if (pipe) {
+    if (::pipe(fds) != 0) {
+      std::perror("pipe");
+      std::exit(1);
+    }
+    in = fds[0];
+    writer = std::thread([&input, fd = fds[1]]() {
+      QROutput::writeAll(fd, input);
+      ::close(fd);
+    });
+  } else {
+    file = std::tmpfile();
+    std::fwrite(input.data(), 1, input.size(), file);
+    std::fflush(file);
+    in = fileno(file);
+  }
+
+  const int saved = ::dup(2);
+  ::dup2(fileno(errors), 2);
+  Result result;
+  result.summary = BatchRunner(options).run(in, fileno(out));
+  ::dup2(saved, 2);
+  ::close(saved);
+
+  if (pipe) {
+    writer.join();
+    ::close(fds[0]);
+  } else {
+    std::fclose(file);
+  }
+  result.output = readAll(out);
+  result.errors = readAll(errors);
+  std::fclose(out);
+  std::fclose(errors);
+  return result;
+}
+
+// The batch made one payload at a time, to compare with.
+static Result makeExpected(const BatchOptions& options,
+                           const std::vector<std::string>& payloads) {
+  const TerminalRenderer renderer(options.quiet_zone);
+  EncodeOptions encode;
+  encode.err = options.err;
+  encode.mask = options.mask;
+  std::vector<std::uint8_t> blocks(177 * 23);
+  Result expected;
+  for (std::size_t i = 0; i < payloads.size(); ++i) {
+    const EncodeResult result = Encoder::encodeInto(payloads[i], encode,
+                                                    blocks);
+    if (!result) {
+      expected.errors += "line " + std::to_string(i + 1)
+                         + ": String too long!\n";
+      ++expected.summary.failed;
+      continue;
+    }
+    expected.output += renderer.render(QRImage(blocks, result.size,
+                                               result.size));
+    ++expected.summary.codes;
+  }
+  return expected;
+}
+
+// Payloads of several lengths, with one that straddles each chunk boundary
+// of the file and some too long for a code.
+static std::vector<std::string> makePayloads(std::size_t length) {
+  std::vector<std::string> payloads;
+  std::size_t used = 0;
+  int i = 0;
+  while (used < length) {
+    std::string payload;
+    if (i % 97 == 96) {
+      payload.assign(3000, 'l'); // Too long
+    } else if (used % kChunkLength > kChunkLength - 200) {
+      payload.assign(400, static_cast<char>('a' + i % 26)); // Straddles
+    } else {
+      payload = "payload " + std::to_string(i) + " "
+                + std::string(i % 50, '#');
+    }
+    used += payload.size() + 1;
+    payloads.push_back(std::move(payload));
+    ++i;
+  }
+  return payloads;
+}
+
+static void checkSame(const Result& result, const Result& expected,
+                      std::string_view what) {
+  check(result.output == expected.output, std::string(what) + ", output");
+  check(result.errors == expected.errors, std::string(what) + ", errors");
+  check(result.summary.codes == expected.summary.codes
+            && result.summary.failed == expected.summary.failed,
+        std::string(what) + ", summary");
+}
+
+// Lines ending in "\n" or "\r\n", the last one with no newline and too long
+// for a code, so it runs through several chunks.
+static void testLines() {
+  BatchOptions options;
+  options.quiet_zone = 1;
+  options.threads = 3;
+  std::vector<std::string> payloads = makePayloads(5 * kChunkLength);
+  payloads.push_back(std::string(2 * kChunkLength + 100, 't'));
+
+  std::string input;
+  for (std::size_t i = 0; i < payloads.size(); ++i) {
+    input += payloads[i];
+    if (i + 1 < payloads.size()) {
+      input += i % 3 == 0 ? "\r\n" : "\n";
+    }
+  }
+  check(input.size() > 5 * kChunkLength, "input spans several chunks");
+  int straddled = 0;
+  for (std::size_t at = kChunkLength; at < input.size(); at += kChunkLength) {
+    straddled += input.find('\n', at - 100) > at + 100;
+  }
+  check(straddled >= 4, "payloads straddle the chunk boundaries");
+
+  const Result expected = makeExpected(options, payloads);
+  const Result mapped = runBatch(options, input, false);
+  const Result piped = runBatch(options, input, true);
+  checkSame(mapped, expected, "mapped lines");
+  checkSame(piped, expected, "piped lines");
+  check(mapped.summary.bytes_read == input.size()
+            && piped.summary.bytes_read == input.size(),
+        "bytes read");
+  check(expected.summary.failed > 2 && expected.summary.codes > 100,
+        "lines include payloads that fail");
+}
+
+// Payloads ending in NUL may hold newlines, and a carriage return is part
+// of the payload.
+static void testNul() {
+  BatchOptions options;
+  options.delimiter = '\0';
+  options.quiet_zone = 0;
+  options.threads = 2;
+  std::vector<std::string> payloads = makePayloads(3 * kChunkLength);
+  for (std::size_t i = 0; i < payloads.size(); i += 5) {
+    payloads[i] += i % 2 == 0 ? "\nsecond line" : "\r";
+  }
+
+  std::string input;
+  for (const std::string& payload : payloads) {
+    input += payload;
+    input += '\0';
+  }
+  const Result expected = makeExpected(options, payloads);
+  checkSame(runBatch(options, input, false), expected, "mapped NUL");
+  checkSame(runBatch(options, input, true), expected, "piped NUL");
+}
+
+int main() {
+  testLines();
+  testNul();
+  if (failures != 0) {
+    std::cerr << failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "batch_test passed\n";
+  return 0;
+}
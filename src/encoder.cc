@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <iostream>
+
+#include "encoder.h"
+#include "qr_static.h"
+#include "qr_terminal.h"
+
+// Packs the blocks of a code into rows of 'stride' bytes.
+template <typename Code>
+static void packRows(const Code& code, std::uint8_t* rows, int stride) {
+  for (int y = 0; y < code.getSize(); ++y) {
+    std::uint8_t* row = rows + y * stride;
+    std::fill(row, row + stride, 0);
+    for (int x = 0; x < code.getSize(); ++x) {
+      row[x >> 3] |= static_cast<std::uint8_t>(code.getBlock(x, y))
+                     << (7 - (x & 7));
+    }
+  }
+}
+
+// Prints the QR code to the terminal, the same as QRCode::printQR().
+void QRBitmap::printQR() const {
+  std::cout.flush();
+  TerminalRenderer().print(*this);
+}
+
+QRBitmap Encoder::encode(std::string_view text, QRCode::ErrCor err,
+                         int msk) {
+  QRBitmap bitmap;
+  if (!free_rows_.empty()) {
+    bitmap.rows_ = std::move(free_rows_.back());
+    free_rows_.pop_back();
+  }
+  encode(text, err, msk, bitmap);
+  return bitmap;
+}
+
+// The code is made on the stack by the BasicQRCode for its version, then
+// packed into the rows. The rows only grow when the code is larger than any
+// code made in them before.
+void Encoder::encode(std::string_view text, QRCode::ErrCor err, int msk,
+                     QRBitmap& bitmap) {
+  StaticQRCode::visit(text, err, msk, [&bitmap](const auto& code) {
+    bitmap.version_ = code.getVersion();
+    bitmap.size_ = code.getSize();
+    bitmap.mask_ = code.getMask();
+    bitmap.correctionLevel_ = code.getErrCor();
+
+    bitmap.rows_.resize(
+        static_cast<std::size_t>(bitmap.getStride() * bitmap.size_));
+    packRows(code, bitmap.rows_.data(), bitmap.getStride());
+  });
+}
+
+void Encoder::recycle(QRBitmap&& bitmap) {
+  free_rows_.push_back(std::move(bitmap.rows_));
+  bitmap.size_ = 0;
+}
+
+// The version is found before the code is made, so BasicQRCode never has a
+// reason to throw.
+EncodeResult Encoder::encodeInto(std::string_view text,
+                                 const EncodeOptions& options,
+                                 std::span<std::uint8_t> out) noexcept {
+  EncodeResult result;
+  if (options.max_version < 1 || options.max_version > 40
+      || options.mask < QRCode::kAutoMask || options.mask > 7
+      || options.err < QRCode::ErrCor::kLow 
+      || options.err > QRCode::ErrCor::kHigh) {
+    result.error = EncodeResult::Error::kInvalidOption;
+    return result;
+  }
+  result.version = StaticQRCode::findVersion(text, options.err,
+                                             options.max_version);
+  if (result.version == 0) {
+    result.error = EncodeResult::Error::kTooLong;
+    return result;
+  }
+  result.size = (4 * result.version) + 17;
+  result.stride = (result.size + 7) / 8;
+  if (out.size() < static_cast<std::size_t>(result.stride * result.size)) {
+    result.error = EncodeResult::Error::kBufferTooSmall;
+    return result;
+  }
+
+  StaticQRCode::visit(result.version, text, options.err, options.mask,
+                      [&result, out](const auto& code) {
+    result.mask = code.getMask();
+    result.err = code.getErrCor();
+    packRows(code, out.data(), result.stride);
+  });
+  return result;
+}
+
+Encoder& Encoder::getThreadLocal() {
+  thread_local Encoder encoder;
+  return encoder;
+}
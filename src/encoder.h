@@ -0,0 +1,111 @@
+#ifndef ENCODER_H_
+#define ENCODER_H_
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "qr.h"
+
+// Blocks of a QR code packed into rows of bits, the leftmost block in the high
+// bit of the first byte. Each row starts on a byte boundary. Bitmaps can only
+// be moved, so the rows are never copied by accident.
+class QRBitmap {
+ public:
+  QRBitmap() = default;
+  QRBitmap(QRBitmap&&) noexcept = default;
+  QRBitmap& operator=(QRBitmap&&) noexcept = default;
+  QRBitmap(const QRBitmap&) = delete;
+  QRBitmap& operator=(const QRBitmap&) = delete;
+
+  int getVersion() const { return version_; }
+  int getSize() const { return size_; }
+  int getMask() const { return mask_; }
+  QRCode::ErrCor getErrCor() const { return correctionLevel_; }
+
+  // Bytes per row, and the packed rows.
+  int getStride() const { return (size_ + 7) / 8; }
+  std::span<const std::uint8_t> getRow(int y) const {
+    return std::span<const std::uint8_t>(rows_).subspan(
+        static_cast<std::size_t>(y * getStride()), getStride());
+  }
+  std::span<const std::uint8_t> getData() const { return rows_; }
+  bool getBlock(int x, int y) const {
+    return ((rows_[y * getStride() + x / 8] >> (7 - x % 8)) & 1) != 0;
+  }
+
+  void printQR() const;
+
+ private:
+  friend class Encoder;
+  friend class CompactQRCode;
+
+  int version_ = 0;                                 // Version number
+  int size_ = 0;                                    // Height and width
+  int mask_ = 0;                                    // Mask pattern used
+  QRCode::ErrCor correctionLevel_ = QRCode::ErrCor::kLow;
+  std::vector<std::uint8_t> rows_;                  // Packed rows of blocks
+}; // QRBitmap
+
+// Options for Encoder::encodeInto().
+struct EncodeOptions {
+  QRCode::ErrCor err = QRCode::ErrCor::kLow; // Lowest error correction level
+  int mask = 0;                              // Mask, or QRCode::kAutoMask
+  int max_version = 40;                      // Largest version to use
+}; // EncodeOptions
+
+// Result of Encoder::encodeInto(), the code is only written when 'error' is
+// kOk.
+struct EncodeResult {
+  enum class Error {
+    kOk = 0,         // The code was written
+    kTooLong,        // The text does not fit in 'max_version'
+    kBufferTooSmall, // The buffer is smaller than 'stride' * 'size' bytes
+    kInvalidOption,  // 'max_version' or 'mask' is out of range
+  }; // Error
+
+  Error error = Error::kOk;
+  int version = 0;                           // Version number
+  int size = 0;                              // Height and width
+  int stride = 0;                            // Bytes per row
+  int mask = 0;                              // Mask pattern used
+  QRCode::ErrCor err = QRCode::ErrCor::kLow; // Error correction level used
+
+  explicit operator bool() const { return error == Error::kOk; }
+}; // EncodeResult
+
+// Makes many QR codes without allocating for each one. The rows of finished
+// bitmaps can be given back with recycle(), and are reused by later codes, so
+// once the buffers have grown to the largest version seen no more memory is
+// allocated. Each thread should use its own encoder, see getThreadLocal().
+class Encoder {
+ public:
+  Encoder() = default;
+  Encoder(const Encoder&) = delete;
+  Encoder& operator=(const Encoder&) = delete;
+
+  // Makes a QR code for the text, the same as QRCode(text, err, msk).
+  QRBitmap encode(std::string_view, QRCode::ErrCor err = QRCode::ErrCor::kLow,
+                  int msk = 0);
+
+  // Makes a QR code into an existing bitmap, reusing its rows.
+  void encode(std::string_view, QRCode::ErrCor, int, QRBitmap&);
+
+  // Keeps the rows of a bitmap that is no longer needed for the next code.
+  void recycle(QRBitmap&&);
+
+  // Writes the packed rows of a QR code for the text into the buffer, in the
+  // same layout as QRBitmap. Nothing is allocated and nothing is thrown, the
+  // result says why the code could not be made.
+  static EncodeResult encodeInto(std::string_view, const EncodeOptions&,
+                                 std::span<std::uint8_t>) noexcept;
+
+  // Encoder for the calling thread.
+  static Encoder& getThreadLocal();
+
+ private:
+  std::vector<std::vector<std::uint8_t> > free_rows_; // Rows to reuse
+}; // Encoder
+
+#endif // ENCODER_H_
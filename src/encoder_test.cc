@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+
+// Every allocation of the program, counted by the replaced operator new.
+static std::size_t allocations = 0;
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+    return memory;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+
+void operator delete(void* memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+static int failures = 0;
+
+static void check(bool passed, std::string_view what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << "\n";
+    ++failures;
+  }
+}
+
+// Payloads of several versions, from version 1 to version 40.
+static std::vector<std::string> makeTexts() {
+  std::vector<std::string> texts = {"HELLO", "https://example.com/a/b?c=d"};
+  texts.push_back(std::string(300, 'x'));
+  texts.push_back(std::string(1200, '7'));
+  texts.push_back(std::string(1200, 'y'));
+  return texts;
+}
+
+static const QRCode::ErrCor kErrCors[] = {
+  QRCode::ErrCor::kLow, QRCode::ErrCor::kMedium, QRCode::ErrCor::kQuartile,
+  QRCode::ErrCor::kHigh,
+};
+
+// Once every code has been made once, encode() and recycle() reuse the same
+// rows and allocate nothing.
+static void testEncodeSteadyState(const std::vector<std::string>& texts) {
+  Encoder& encoder = Encoder::getThreadLocal();
+  for (int round = 0; round < 3; ++round) {
+    const std::size_t before = allocations;
+    for (const std::string& text : texts) {
+      for (QRCode::ErrCor err : kErrCors) {
+        for (int msk : {0, 5, QRCode::kAutoMask}) {
+          encoder.recycle(encoder.encode(text, err, msk));
+        }
+      }
+    }
+    if (round == 0) {
+      check(allocations > before, "operator new is not counted");
+    } else {
+      check(allocations == before, "encode() allocates after warm up");
+    }
+  }
+}
+
+// The bitmap overload reuses the rows it is given, once they have grown to
+// the largest code.
+static void testEncodeIntoBitmap(const std::vector<std::string>& texts) {
+  Encoder& encoder = Encoder::getThreadLocal();
+  QRBitmap bitmap;
+  for (int round = 0; round < 2; ++round) {
+    const std::size_t before = allocations;
+    for (const std::string& text : texts) {
+      for (QRCode::ErrCor err : kErrCors) {
+        encoder.encode(text, err, 0, bitmap);
+      }
+    }
+    if (round > 0) {
+      check(allocations == before, "encode(..., QRBitmap&) allocates");
+    }
+  }
+}
+
+// encodeInto() never allocates, not even for the first code, and matches
+// encode().
+static void testEncodeIntoBuffer(const std::vector<std::string>& texts) {
+  std::vector<std::uint8_t> buffer(177 * 23);
+  for (const std::string& text : texts) {
+    for (QRCode::ErrCor err : kErrCors) {
+      EncodeOptions options;
+      options.err = err;
+      options.mask = QRCode::kAutoMask;
+      const std::size_t before = allocations;
+      const EncodeResult result = Encoder::encodeInto(text, options, buffer);
+      check(allocations == before, "encodeInto() allocates");
+      if (!result) {
+        check(result.error == EncodeResult::Error::kTooLong,
+              "encodeInto() fails on a payload that fits");
+        continue;
+      }
+
+      const QRBitmap bitmap = Encoder::getThreadLocal().encode(
+          text, err, QRCode::kAutoMask);
+      const std::span<const std::uint8_t> rows = bitmap.getData();
+      check(result.size == bitmap.getSize()
+                && std::equal(rows.begin(), rows.end(), buffer.begin()),
+            "encodeInto() differs from encode()");
+    }
+  }
+
+  std::uint8_t small[8];
+  const std::size_t before = allocations;
+  const EncodeResult result = Encoder::encodeInto(texts.back(),
+                                                  EncodeOptions(), small);
+  check(allocations == before && result.error
+                                     == EncodeResult::Error::kBufferTooSmall,
+        "encodeInto() with a small buffer");
+}
+
+int main() {
+  const std::vector<std::string> texts = makeTexts();
+  testEncodeSteadyState(texts);
+  testEncodeIntoBitmap(texts);
+  testEncodeIntoBuffer(texts);
+  if (failures != 0) {
+    std::cerr << failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "encoder_test passed\n";
+  return 0;
+}
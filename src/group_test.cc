@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qr.h"
+#include "qr_group.h"
+#include "qr_packed.h"
+#include "thread_pool.h"
+
+static int failures = 0;
+
+static void check(bool passed, std::string_view what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << "\n";
+    ++failures;
+  }
+}
+
+// The serialized symbols of a group, to compare groups made on different
+// threads.
+static std::vector<std::vector<std::uint8_t> > getSymbols(
+    QRCodeGroup& group) {
+  std::vector<std::vector<std::uint8_t> > symbols;
+  for (int i = 0; i < group.getCount(); ++i) {
+    symbols.push_back(PackedQRCode::serialize(group.getSymbol(i), 0));
+  }
+  return symbols;
+}
+
+// A group made in a task of its own pool, with every worker busy with the
+// task, is encoded by that task rather than waiting on the pool.
+static void testInTask(std::string_view text, int count) {
+  const std::string what = std::to_string(count) + " symbols";
+  QRCodeGroup expected(text, QRCode::ErrCor::kMedium, 3, 10);
+  check(expected.getCount() == count, what + ", count");
+
+  ThreadPool pool(1);
+  std::future<std::vector<std::vector<std::uint8_t> > > symbols =
+      pool.submit([text, &pool]() {
+        QRCodeGroup group(text, QRCode::ErrCor::kMedium, 3, 10, &pool);
+        return getSymbols(group);
+      });
+  if (symbols.wait_for(std::chrono::seconds(60))
+      != std::future_status::ready) {
+    std::cerr << "FAILED: " << what << ", deadlocked in a task\n";
+    std::_Exit(1);
+  }
+  check(symbols.get() == getSymbols(expected), what + ", made in a task");
+}
+
+int main() {
+  testInTask("one symbol", 1);
+  testInTask(std::string(600, 'g'), 3);
+  testInTask(std::string(3000, '7'), 6);
+
+  bool threw = false;
+  try {
+    QRCodeGroup group(std::string(20000, 'g'), QRCode::ErrCor::kLow, 0, 10);
+  } catch (const std::logic_error&) {
+    threw = true;
+  }
+  check(threw, "text too long for 16 symbols throws");
+
+  if (failures != 0) {
+    std::cerr << failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "group_test passed\n";
+  return 0;
+}
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+#include "qr_packed.h"
+
+static int failures = 0;
+
+static void check(bool passed, std::string_view what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << "\n";
+    ++failures;
+  }
+}
+
+// Returns true if reading the buffer throws.
+static bool rejects(const std::vector<std::uint8_t>& data) {
+  try {
+    PackedQRCode code(data);
+  } catch (const std::logic_error&) {
+    return true;
+  }
+  return false;
+}
+
+// Reading a serialized QRCode gives back its header and every block.
+static void checkRoundTrip(const QRCode& code, std::string_view what) {
+  const std::vector<std::uint8_t> data = PackedQRCode::serialize(code, 3);
+  const PackedQRCode packed(data);
+  bool same = packed.getSymbolType() == code.getSymbolType()
+              && packed.getVersion() == code.getVersion()
+              && packed.getErrCor() == code.getErrCor()
+              && packed.getMask() == code.getMask()
+              && packed.getQuietZone() == 3
+              && packed.getSize() == code.getSize()
+              && packed.getHeight() == code.getHeight()
+              && packed.getLength() == data.size();
+  for (int y = 0; same && y < code.getHeight(); ++y) {
+    for (int x = 0; x < code.getSize(); ++x) {
+      same = same && packed.getBlock(x, y) == code.getBlock(x, y);
+    }
+  }
+  check(same, what);
+}
+
+static void testRoundTrip() {
+  for (int version : {1, 7, 40}) {
+    const std::string text(QRCode::getTotalCodewords(version,
+                                                     QRCode::ErrCor::kLow)
+                           - 3, 'a');
+    checkRoundTrip(QRCode(text, QRCode::ErrCor::kLow, QRCode::kAutoMask),
+                   "QR round trip");
+  }
+  for (const char* text : {"1", "HELLO", "micro code"}) {
+    checkRoundTrip(QRCode(text, QRCode::ErrCor::kLow, QRCode::kAutoMask,
+                          QRCode::SymbolType::kMicro),
+                   "Micro QR round trip");
+  }
+  for (int height : {7, 11, 17}) {
+    for (QRCode::ErrCor err : {QRCode::ErrCor::kMedium,
+                               QRCode::ErrCor::kHigh}) {
+      checkRoundTrip(QRCode("rMQR 1234", err, 0,
+                            QRCode::SymbolType::kRectMicro, height),
+                     "rMQR round trip");
+    }
+  }
+
+  // A bitmap is stored with its rows as they are.
+  const QRBitmap bitmap = Encoder::getThreadLocal().encode(
+      "https://example.com", QRCode::ErrCor::kQuartile, 2);
+  const std::vector<std::uint8_t> data = PackedQRCode::serialize(bitmap);
+  const PackedQRCode packed(data);
+  const std::span<const std::uint8_t> rows = bitmap.getData();
+  check(packed.getVersion() == bitmap.getVersion() && packed.getMask() == 2
+            && std::equal(rows.begin(), rows.end(),
+                          packed.getData().begin(), packed.getData().end()),
+        "QRBitmap round trip");
+}
+
+static void testRejects() {
+  const std::vector<std::uint8_t> qr = PackedQRCode::serialize(
+      QRCode("HELLO", QRCode::ErrCor::kLow, 0));
+  const std::vector<std::uint8_t> rmqr = PackedQRCode::serialize(
+      QRCode("HELLO", QRCode::ErrCor::kMedium, 0,
+             QRCode::SymbolType::kRectMicro));
+  check(!rejects(qr) && !rejects(rmqr), "valid headers are read");
+
+  std::vector<std::uint8_t> data = qr;
+  data.pop_back();
+  check(rejects(data), "truncated rows");
+  check(rejects(std::vector<std::uint8_t>(qr.begin(), qr.begin() + 8)),
+        "truncated header");
+
+  data = qr;
+  data[2] = 'X';
+  check(rejects(data), "bad magic");
+  data = qr;
+  data[3] = PackedQRCode::kFormatVersion + 1;
+  check(rejects(data), "unsupported format version");
+  data = qr;
+  data[9] += 4;
+  check(rejects(data), "QR size not matching the version");
+
+  // rMQR codes take their width and height from the version table, and only
+  // have the medium and high levels.
+  data = rmqr;
+  data[9] -= 2;
+  check(rejects(data), "rMQR width not matching the version");
+  data = rmqr;
+  data[10] -= 2;
+  check(rejects(data), "rMQR height not matching the version");
+  data = rmqr;
+  data[6] = static_cast<std::uint8_t>(QRCode::ErrCor::kLow);
+  check(rejects(data), "rMQR with level L");
+  data = rmqr;
+  data[7] = 1;
+  check(rejects(data), "rMQR with a mask");
+}
+
+int main() {
+  testRoundTrip();
+  testRejects();
+  if (failures != 0) {
+    std::cerr << failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "packed_test passed\n";
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+#include "qr_png.h"
+
+// Codes of the same version, each from random text of 'length' letters.
+static std::vector<QRBitmap> makeCodes(int length, int count) {
+  Encoder& encoder = Encoder::getThreadLocal();
+  std::mt19937 random(length);
+  std::vector<QRBitmap> codes;
+  for (int i = 0; i < count; ++i) {
+    std::string text;
+    for (int j = 0; j < length; ++j) {
+      text += static_cast<char>('a' + random() % 26);
+    }
+    codes.push_back(encoder.encode(text, QRCode::ErrCor::kMedium,
+                                   QRCode::kAutoMask));
+  }
+  return codes;
+}
+
+// Prints the bytes and the time of each PNG, for both compressions and a few
+// scales. The codes are made before the clock starts, only writing the PNG
+// is timed.
+int main() {
+  const int kCodes = 100;
+  const int kRounds = 20;
+  std::printf("version scale compression  bytes/code  us/code\n");
+  for (int length : {20, 100, 400, 1500}) {
+    const std::vector<QRBitmap> codes = makeCodes(length, kCodes);
+    for (int scale : {1, 4, 8}) {
+      for (PngWriter::Compression compression :
+           {PngWriter::Compression::kStored, PngWriter::Compression::kRle}) {
+        const PngWriter writer(scale, 4, false, compression);
+        std::vector<std::uint8_t> buffer(writer.getMaxLength(codes.back()));
+        std::size_t bytes = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (int round = 0; round < kRounds; ++round) {
+          for (const QRBitmap& code : codes) {
+            bytes += writer.write(code, buffer);
+          }
+        }
+        const std::chrono::duration<double, std::micro> time =
+            std::chrono::steady_clock::now() - start;
+        std::printf("%7d %5d %-11s %11zu %8.1f\n", codes.back().getVersion(),
+                    scale,
+                    compression == PngWriter::Compression::kRle ? "rle"
+                                                                : "stored",
+                    bytes / (kCodes * kRounds),
+                    time.count() / (kCodes * kRounds));
+      }
+    }
+  }
+  return 0;
+}
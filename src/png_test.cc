@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+#include "qr_packed.h"
+#include "qr_png.h"
+#include "test_inflater.h"
+#include "thread_pool.h"
+
+static int failures = 0;
+
+static void check(bool passed, std::string_view what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << "\n";
+    ++failures;
+  }
+}
+
+// CRC-32 a bit at a time, not shared with the writer.
+static std::uint32_t crc32(const std::uint8_t* data, std::size_t length) {
+  std::uint32_t crc = 0xFFFFFFFF;
+  for (std::size_t i = 0; i < length; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+static std::uint32_t read32(const std::uint8_t* data) {
+  return static_cast<std::uint32_t>(data[0]) << 24 | data[1] << 16
+         | data[2] << 8 | data[3];
+}
+
+// A decoded PNG, one byte for each pixel, 1 for white.
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<std::uint8_t> pixels;
+  int chunks = 0; // Number of IDAT chunks
+}; // Image
+
+// Reads a 1 bit grayscale PNG, checking the CRC of every chunk, the zlib
+// header and the Adler-32.
+static Image decodePng(const std::vector<std::uint8_t>& png) {
+  static const std::uint8_t kSignature[8] = {
+    0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  if (png.size() < 8 || !std::equal(kSignature, kSignature + 8,
+                                    png.begin())) {
+    throw std::runtime_error("No PNG signature.");
+  }
+  Image image;
+  std::vector<std::uint8_t> idat;
+  bool ended = false;
+  for (std::size_t at = 8; !ended;) {
+    if (at + 12 > png.size()) {
+      throw std::runtime_error("Chunk cut short.");
+    }
+    const std::uint32_t length = read32(&png[at]);
+    if (at + 12 + length > png.size()) {
+      throw std::runtime_error("Chunk cut short.");
+    }
+    const std::string type(png.begin() + at + 4, png.begin() + at + 8);
+    const std::uint8_t* body = &png[at + 8];
+    if (crc32(&png[at + 4], length + 4) != read32(body + length)) {
+      throw std::runtime_error("Bad CRC in " + type);
+    }
+    if (type == "IHDR") {
+      if (length != 13 || body[8] != 1 || body[9] != 0 || body[12] != 0) {
+        throw std::runtime_error("Not a 1 bit grayscale PNG.");
+      }
+      image.width = static_cast<int>(read32(body));
+      image.height = static_cast<int>(read32(body + 4));
+    } else if (type == "IDAT") {
+      idat.insert(idat.end(), body, body + length);
+      ++image.chunks;
+    } else if (type == "IEND") {
+      ended = at + 12 == png.size();
+      if (!ended) {
+        throw std::runtime_error("Bytes after IEND.");
+      }
+    }
+    at += 12 + length;
+  }
+
+  if (idat.size() < 6 || idat[0] != 0x78 || (idat[0] << 8 | idat[1]) % 31) {
+    throw std::runtime_error("Bad zlib header.");
+  }
+  Inflater inflater(std::span<const std::uint8_t>(idat).subspan(2));
+  const std::vector<std::uint8_t> raw = inflater.inflate();
+  if (inflater.getPosition() + 6 != idat.size()
+      || adler32(raw) != read32(&idat[idat.size() - 4])) {
+    throw std::runtime_error("Bad Adler-32.");
+  }
+
+  const std::size_t line = (image.width + 7) / 8 + 1;
+  if (raw.size() != line * image.height) {
+    throw std::runtime_error("Wrong length of image data.");
+  }
+  for (int y = 0; y < image.height; ++y) {
+    const std::uint8_t* row = &raw[y * line];
+    if (row[0] != 0) {
+      throw std::runtime_error("Unexpected filter type.");
+    }
+    for (int x = 0; x < image.width; ++x) {
+      image.pixels.push_back((row[1 + x / 8] >> (7 - x % 8)) & 1);
+    }
+  }
+  return image;
+}
+
+// Every pixel is the block under it, or light in the quiet zone, and white
+// is light unless inverted.
+static bool matches(const Image& image, const QRImage& code, int scale,
+                    int quiet_zone, bool invert) {
+  if (image.width != (code.getWidth() + 2 * quiet_zone) * scale
+      || image.height != (code.getHeight() + 2 * quiet_zone) * scale) {
+    return false;
+  }
+  for (int y = 0; y < image.height; ++y) {
+    for (int x = 0; x < image.width; ++x) {
+      const int block_x = x / scale - quiet_zone;
+      const int block_y = y / scale - quiet_zone;
+      const bool dark = block_x >= 0 && block_y >= 0
+                        && block_x < code.getWidth()
+                        && block_y < code.getHeight()
+                        && code.getBlock(block_x, block_y);
+      if (image.pixels[y * image.width + x] != (dark == invert)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void checkCode(const QRImage& code, int scale, int quiet_zone,
+                      bool invert, PngWriter::Compression compression) {
+  const std::string what = "PNG at scale " + std::to_string(scale)
+                           + " quiet zone " + std::to_string(quiet_zone)
+                           + (invert ? " inverted" : "")
+                           + (compression == PngWriter::Compression::kRle
+                                  ? " rle" : " stored");
+  const PngWriter writer(scale, quiet_zone, invert, compression);
+  const std::vector<std::uint8_t> png = writer.encode(code);
+  try {
+    check(matches(decodePng(png), code, scale, quiet_zone, invert), what);
+  } catch (const std::runtime_error& error) {
+    check(false, what + ": " + error.what());
+  }
+
+  // The buffer and file descriptor overloads write the same bytes.
+  std::vector<std::uint8_t> buffer(writer.getMaxLength(code));
+  const std::size_t length = writer.write(code, buffer);
+  check(png.size() <= buffer.size() && length == png.size()
+            && std::equal(png.begin(), png.end(), buffer.begin()),
+        what + ", into a buffer");
+
+  std::FILE* file = std::tmpfile();
+  writer.write(code, fileno(file));
+  std::vector<std::uint8_t> written(png.size() + 1);
+  std::rewind(file);
+  written.resize(std::fread(written.data(), 1, written.size(), file));
+  std::fclose(file);
+  check(written == png, what + ", to a file descriptor");
+}
+
+static void testCodes() {
+  Encoder& encoder = Encoder::getThreadLocal();
+  const QRBitmap small = encoder.encode("HELLO", QRCode::ErrCor::kLow, 0);
+  const QRBitmap large = encoder.encode(std::string(2000, 'z'),
+                                        QRCode::ErrCor::kLow,
+                                        QRCode::kAutoMask);
+  const std::vector<std::uint8_t> rmqr = PackedQRCode::serialize(
+      QRCode("rectangular", QRCode::ErrCor::kMedium, 0,
+             QRCode::SymbolType::kRectMicro, 9));
+  for (PngWriter::Compression compression :
+       {PngWriter::Compression::kStored, PngWriter::Compression::kRle}) {
+    for (int scale : {1, 3, 8}) {
+      for (int quiet_zone : {0, 4}) {
+        checkCode(small, scale, quiet_zone, false, compression);
+        checkCode(PackedQRCode(rmqr), scale, quiet_zone, true, compression);
+      }
+    }
+    checkCode(large, 1, 4, false, compression);
+    checkCode(large, 4, 2, true, compression);
+  }
+
+  const PngWriter writer;
+  std::vector<std::uint8_t> buffer(16);
+  bool threw = false;
+  try {
+    writer.write(small, buffer);
+  } catch (const std::logic_error&) {
+    threw = true;
+  }
+  check(threw, "a small buffer throws");
+}
+
+// Rows already drawn are split into stripes, each its own IDAT chunk, and
+// the pixels come back as they were.
+static void testEncodeRows() {
+  const int width = 203;
+  const int height = 517;
+  const std::size_t stride = 32;
+  std::mt19937 random(7);
+  std::vector<std::uint8_t> rows(stride * height);
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    // Long runs and repeated rows, as an atlas has, with some noise.
+    rows[i] = (i / stride) % 5 == 0 ? static_cast<std::uint8_t>(random())
+                                    : (i / 3) % 2 ? 0xFF : 0x00;
+  }
+  ThreadPool pool(3);
+  for (PngWriter::Compression compression :
+       {PngWriter::Compression::kStored, PngWriter::Compression::kRle}) {
+    try {
+      const Image image = decodePng(PngWriter::encodeRows(
+          rows, width, height, stride, compression, &pool));
+      bool same = image.width == width && image.height == height
+                  && image.chunks > 1;
+      for (int y = 0; same && y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+          same = same && image.pixels[y * width + x]
+                             == ((rows[y * stride + x / 8] >> (7 - x % 8))
+                                 & 1);
+        }
+      }
+      check(same, "encodeRows() gives back the rows");
+    } catch (const std::runtime_error& error) {
+      check(false, std::string("encodeRows(): ") + error.what());
+    }
+  }
+}
+
+int main() {
+  testCodes();
+  testEncodeRows();
+  if (failures != 0) {
+    std::cerr << failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "png_test passed\n";
+  return 0;
+}
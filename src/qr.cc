@@ -1,8 +1,17 @@
 #include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/uio.h>
 
 #include "qr.h"
+#include "qr_image.h"
+#include "qr_output.h"
+#include "qr_static.h"
+#include "qr_terminal.h"
+#include "qr_upscale.h"
 
 // ---------------------- Internal Encoding Class ----------------------
 int QRCode::Encoding::getEncodingMode() const {
@@ -21,15 +30,53 @@ int QRCode::Encoding::getBitsPerChar(int ver) const {
   }
 }
 
-QRCode::Encoding::Encoding(int mode, int v1_9, int v10_26, int v27_40): 
-                           encoding_mode_(mode) {
+int QRCode::Encoding::getMicroEncodingMode() const {
+  return micro_encoding_mode_;
+}
+
+int QRCode::Encoding::getMicroBitsPerChar(int ver) const {
+  if (ver < 1 || ver > 4) {
+    throw std::logic_error("Invalid version");
+  }
+  return micro_bits_per_char_[ver - 1];
+}
+
+int QRCode::Encoding::getRectMicroEncodingMode() const {
+  return rmqr_encoding_mode_;
+}
+
+// ECI segments have no character count, other modes look up the count length
+// for the version. Only modes 1 to 4 have a row in the table.
+int QRCode::Encoding::getRectMicroBitsPerChar(int ver) const {
+  if (ver < 1 || ver > 32) {
+    throw std::logic_error("Invalid version");
+  }
+  if (rmqr_encoding_mode_ == 7) {
+    return 0;
+  } else if (rmqr_encoding_mode_ < 1 || rmqr_encoding_mode_ > 4) {
+    return -1;
+  }
+  return kRMQR_bits_per_char_[rmqr_encoding_mode_ - 1][ver];
+}
+
+QRCode::Encoding::Encoding(int mode, int v1_9, int v10_26, int v27_40, 
+                           int micro_mode, int m1, int m2, int m3, int m4, 
+                           int rmqr_mode): 
+                           encoding_mode_(mode), 
+                           micro_encoding_mode_(micro_mode), 
+                           rmqr_encoding_mode_(rmqr_mode) {
   bits_per_char_[0] = v1_9;
   bits_per_char_[1] = v10_26;
   bits_per_char_[2] = v27_40;
+  micro_bits_per_char_[0] = m1;
+  micro_bits_per_char_[1] = m2;
+  micro_bits_per_char_[2] = m3;
+  micro_bits_per_char_[3] = m4;
 }
 
 // ---------------------- Internal BitBuffer Class ----------------------
-QRCode::BitBuffer::BitBuffer() : std::vector<bool>() {}
+QRCode::BitBuffer::BitBuffer(std::pmr::memory_resource* resource) : 
+    std::pmr::vector<bool>(resource) {}
 
 void QRCode::BitBuffer::appendBits(std::uint32_t val, int len) {
   if (len < 0 || len > 31 || val >> len != 0) {
@@ -40,113 +87,254 @@ void QRCode::BitBuffer::appendBits(std::uint32_t val, int len) {
   }
 }
 
-// ---------------------- QRCode Class ----------------------
-// QRCode constructor.
-QRCode::QRCode(std::string text, ErrCor err, int msk):
-               plain_text_(text), correctionLevel_(err), rsLog_(256), 
-               rsExp_(256) {
-  if (msk < 0 || msk > 7) {
-    msk = 0;
+// ---------------------- Internal Segment Class ----------------------
+QRCode::Segment::Segment(const Encoding& encoding, int num_chars, 
+                         BitBuffer data):
+                         encoding_(&encoding), num_chars_(num_chars), 
+                         data_(std::move(data)) {}
+
+// Groups of three digits are encoded with 10 bits each.
+QRCode::Segment QRCode::Segment::makeNumeric(
+    std::string_view text, std::pmr::memory_resource* resource) {
+  if (!StaticQRCode::isNumeric(text)) {
+    throw std::logic_error("Numeric: Contains non numeric characters!");
   }
-  mask_ = msk;
-  determineEncoding(text);
-  setVersionAndErrorLevel(kEncoding_->getEncodingMode(), text.length(), err);
-  size_ = (4 * version_) + 17;
-  blocks_ = std::vector<std::vector<bool> >(size_, std::vector<bool>(size_));
-  funcBlock_ = std::vector<std::vector<bool> >(size_, std::vector<bool>(size_));
-  drawPatterns();
-  data_ = encodeText(text);
-  data_ = addEDCInterleave(data_);
-  drawCodewords();
-  mask(msk);
-}
-QRCode::~QRCode() {
-  delete kEncoding_;
+  BitBuffer buffer(resource);
+  StaticQRCode::encodeText(1, text, [&buffer](std::uint32_t value, int len) {
+    buffer.appendBits(value, len);
+  });
+  return Segment(Encoding::kNumeric_, static_cast<int>(text.length()), 
+                 std::move(buffer));
 }
 
-// Determines the method of encoding to be used.
-void QRCode::determineEncoding(std::string_view text) {
-  if (isNumeric(text)) {
-    kEncoding_ = new Encoding(Encoding::kNumeric_);
-  } else if (isAlphanumeric(text)) {
-    kEncoding_ = new Encoding(Encoding::kAlpha_);
-  } else if (isByte(text)) {
-    kEncoding_ = new Encoding(Encoding::kByte_);
-  } else if (isKanji(text)) {
-    kEncoding_ = new Encoding(Encoding::kKanji_);
+// Pairs of characters are encoded with 11 bits each, from their alphanumeric
+// codes.
+QRCode::Segment QRCode::Segment::makeAlphanumeric(
+    std::string_view text, std::pmr::memory_resource* resource) {
+  if (!StaticQRCode::isAlphanumeric(text)) {
+    throw std::logic_error("Alphanumeric: Contains unsupported characters!");
   }
+  BitBuffer buffer(resource);
+  StaticQRCode::encodeText(2, text, [&buffer](std::uint32_t value, int len) {
+    buffer.appendBits(value, len);
+  });
+  return Segment(Encoding::kAlpha_, static_cast<int>(text.length()), 
+                 std::move(buffer));
+}
+
+// Convert each char to binary using 8 bits per character.
+QRCode::Segment QRCode::Segment::makeBytes(
+    std::string_view text, std::pmr::memory_resource* resource) {
+  BitBuffer buffer(resource);
+  buffer.reserve(text.length() * 8);
+  StaticQRCode::encodeText(4, text, [&buffer](std::uint32_t value, int len) {
+    buffer.appendBits(value, len);
+  });
+  return Segment(Encoding::kByte_, static_cast<int>(text.length()), 
+                 std::move(buffer));
 }
 
-// Determines the positions of the aligment blocks.
-std::vector<int> QRCode::determineAlignmentPos() const {
-  if (version_ == 1) {
-    return std::vector<int>();
+// The ECI designator takes 8, 16 or 24 bits depending on the assignment
+// number. An ECI segment has no character count.
+QRCode::Segment QRCode::Segment::makeEci(
+    int assign_val, std::pmr::memory_resource* resource) {
+  BitBuffer buffer(resource);
+  if (assign_val < 0) {
+    throw std::logic_error("ECI assignment value out of range");
+  } else if (assign_val < (1 << 7)) {
+    buffer.appendBits(static_cast<std::uint32_t>(assign_val), 8);
+  } else if (assign_val < (1 << 14)) {
+    buffer.appendBits(2, 2);
+    buffer.appendBits(static_cast<std::uint32_t>(assign_val), 14);
+  } else if (assign_val < 1000000) {
+    buffer.appendBits(6, 3);
+    buffer.appendBits(static_cast<std::uint32_t>(assign_val), 21);
   } else {
+    throw std::logic_error("ECI assignment value out of range");
+  }
+  return Segment(Encoding::kEci_, 0, std::move(buffer));
+}
 
-    // Calculate distance between alignment patterns
-    int intervals = std::floor(version_ / 7 + 1);
-    int distance = 4 * version_ + 4;
-    int step = std::ceil(distance / intervals / 2) * 2;
+// The header is the symbol position and the number of symbols less one in
+// 4 bits each, followed by the parity byte.
+QRCode::Segment QRCode::Segment::makeStructuredAppend(
+    int index, int total, std::uint8_t parity, 
+    std::pmr::memory_resource* resource) {
+  if (total < 1 || total > 16 || index < 0 || index >= total) {
+    throw std::logic_error("Invalid Structured Append position");
+  }
+  BitBuffer buffer(resource);
+  buffer.appendBits(static_cast<std::uint32_t>(index), 4);
+  buffer.appendBits(static_cast<std::uint32_t>(total - 1), 4);
+  buffer.appendBits(parity, 8);
+  return Segment(Encoding::kStructuredAppend_, 0, std::move(buffer));
+}
 
-    std::vector<int> alignment_tracks;
-    alignment_tracks.push_back(6);
+std::pmr::vector<QRCode::Segment> QRCode::Segment::makeSegments(
+    std::string_view text, std::pmr::memory_resource* resource) {
+  std::pmr::vector<Segment> segments(resource);
+  if (StaticQRCode::isNumeric(text)) {
+    segments.push_back(makeNumeric(text, resource));
+  } else if (StaticQRCode::isAlphanumeric(text)) {
+    segments.push_back(makeAlphanumeric(text, resource));
+  } else if (StaticQRCode::isByte(text)) {
+    segments.push_back(makeBytes(text, resource));
+  } else if (StaticQRCode::isUtf8(text)) {
+    segments.push_back(makeEci(kEciUtf8, resource));
+    segments.push_back(makeBytes(text, resource));
+  } else {
+    // Not valid UTF-8, readers will assume ISO-8859-1.
+    segments.push_back(makeBytes(text, resource));
+  }
+  return segments;
+}
 
-    for (int i = 0; i < intervals; ++i) {
-      alignment_tracks.push_back(distance + 6 - (intervals - 1 - i) * step);
+int QRCode::Segment::getTotalBits(const std::pmr::vector<Segment>& segments, 
+                                  int version) {
+  int total = 0;
+  for (const auto& segment : segments) {
+    int count_bits = segment.getEncoding().getBitsPerChar(version);
+    if (segment.getNumChars() >= (1L << count_bits)) {
+      return -1;
     }
+    total += 4 + count_bits + static_cast<int>(segment.getData().size());
+  }
+  return total;
+}
 
-    return alignment_tracks;
+// Micro QR codes have a mode indicator of 0 to 3 bits depending on version.
+int QRCode::Segment::getMicroTotalBits(const std::pmr::vector<Segment>& segments, 
+                                       int version) {
+  int total = 0;
+  for (const auto& segment : segments) {
+    int count_bits = segment.getEncoding().getMicroBitsPerChar(version);
+    if (count_bits < 0 || segment.getNumChars() >= (1L << count_bits)) {
+      return -1;
+    }
+    total += version - 1 + count_bits 
+             + static_cast<int>(segment.getData().size());
   }
+  return total;
 }
 
-// Returns total modules for the QRCode based on version.
-int QRCode::getTotalModules(int version) {
-  if (version == 1) {
-    return 21 * 21 - 3 * 8 * 8 - 2 * 15 - 1 - 2 * 5;
+// rMQR codes use a 3 bit mode indicator.
+int QRCode::Segment::getRectMicroTotalBits(
+    const std::pmr::vector<Segment>& segments, int version) {
+  int total = 0;
+  for (const auto& segment : segments) {
+    int count_bits = segment.getEncoding().getRectMicroBitsPerChar(version);
+    if (count_bits < 0 || segment.getNumChars() >= (1L << count_bits)) {
+      return -1;
+    }
+    total += 3 + count_bits + static_cast<int>(segment.getData().size());
   }
-  
-  int alignBlocks = (version / 7) + 2;
+  return total;
+}
 
-  return pow((version * 4 + 17), 2) - 3 * 8 * 8 
-         - (pow(alignBlocks, 2) - 3) * 5 * 5 - 2 * (version * 4 + 1) 
-         + (alignBlocks - 2) * 5 * 2 - 2 * 15 - 1 
-         - (version > 6 ? 2 * 3 * 6 : 0);
+// ---------------------- QRCode Class ----------------------
+// QRCode constructors.
+QRCode::QRCode(std::string text, ErrCor err, int msk, SymbolType type, 
+               int max_height, std::pmr::memory_resource* resource):
+               QRCode(Segment::makeSegments(text, resource), err, msk, type, 
+                      max_height, resource) {
+  plain_text_ = std::move(text);
 }
 
-// Returns total codewords per block depending on version and error 
-// correction level.
-int QRCode::getTotalCodewords(int version, ErrCor error_level) {
-  return (getTotalModules(version) >> 3) 
-         - (kErr_corr_blocks_[static_cast<int>(error_level)][version] 
-         * kEC_codewords_per_block_[static_cast<int>(error_level)][version]);
+QRCode::QRCode(const std::pmr::vector<Segment>& segments, ErrCor err, 
+               int msk, SymbolType type, int max_height, 
+               std::pmr::memory_resource* resource):
+               correctionLevel_(err), resource_(resource), blocks_(resource),
+               funcBlock_(resource), data_(resource) {
+  determineEncoding(segments);
+  if (type == SymbolType::kRectMicro) {
+    symbol_ = SymbolType::kRectMicro;
+    setRectMicroVersionAndErrorLevel(segments, err, max_height);
+    size_ = kRMQR_width_[version_];
+    height_ = kRMQR_height_[version_];
+  } else if (type != SymbolType::kQR 
+             && setMicroVersionAndErrorLevel(segments, err)) {
+    symbol_ = SymbolType::kMicro;
+    size_ = (2 * version_) + 9;
+    height_ = size_;
+  } else if (type == SymbolType::kMicro) {
+    throw std::logic_error("String too long!");
+  } else {
+    symbol_ = SymbolType::kQR;
+    setVersionAndErrorLevel(segments, err);
+    size_ = (4 * version_) + 17;
+    height_ = size_;
+  }
+
+  // rMQR codes only have one mask.
+  int num_masks = symbol_ == SymbolType::kMicro ? 4 
+                  : symbol_ == SymbolType::kRectMicro ? 1 : 8;
+  if (msk != kAutoMask && (msk < 0 || msk >= num_masks)) {
+    msk = 0;
+  }
+  mask_ = msk == kAutoMask ? 0 : msk;
+  blocks_.assign(height_, std::pmr::vector<bool>(size_, false, resource_));
+  funcBlock_.assign(height_, std::pmr::vector<bool>(size_, false, resource_));
+  drawPatterns();
+  data_ = encodeSegments(segments);
+  data_ = addEDCInterleave(data_);
+  drawCodewords();
+  if (msk == kAutoMask && symbol_ != SymbolType::kRectMicro) {
+    mask_ = chooseMask();
+    drawFormat(mask_);
+  }
+  mask(mask_);
 }
 
-// Returns total capacity depending on version, error correction level, 
-// and encoding method.
-int QRCode::getCapacity(int version, ErrCor error_level) {
-  int data_codewords = getTotalCodewords(version, error_level);
-  int bits_per_char = kEncoding_->getBitsPerChar(version);
-  int available_bits = (data_codewords << 3) - bits_per_char - 4;
-  
-  int mode = kEncoding_->getEncodingMode();
-  switch (mode) {
-    case 1: return numericCapacity(available_bits);
-    case 2: return alphanumbericCapacity(available_bits);
-    case 4: return byteCapacity(available_bits);
-    case 7: return byteCapacity(available_bits);
-    case 8: return kanjiCapacity(available_bits);
-    default: throw std::logic_error("Invalid encoding mode.");
+QRCode::QRCode(int version, std::pmr::memory_resource* resource):
+               symbol_(SymbolType::kQR), version_(version), 
+               size_((4 * version) + 17), height_(size_), mask_(0), 
+               correctionLevel_(ErrCor::kLow), resource_(resource), 
+               blocks_(resource), funcBlock_(resource), data_(resource), 
+               kEncoding_(&Encoding::kByte_) {
+  if (version < 1 || version > 40) {
+    throw std::logic_error("Invalid version.");
+  }
+  blocks_.assign(height_, std::pmr::vector<bool>(size_, false, resource_));
+  funcBlock_.assign(height_, std::pmr::vector<bool>(size_, false, resource_));
+  drawPatterns();
+}
+
+int QRCode::getBitsPerChar() {
+  switch (symbol_) {
+    case SymbolType::kMicro: return kEncoding_->getMicroBitsPerChar(version_);
+    case SymbolType::kRectMicro: 
+      return kEncoding_->getRectMicroBitsPerChar(version_);
+    default: return kEncoding_->getBitsPerChar(version_);
+  }
+}
+
+// Determines the method of encoding to be used, ECI and Structured Append
+// segments hold no text so the first data segment is used.
+void QRCode::determineEncoding(const std::pmr::vector<Segment>& segments) {
+  kEncoding_ = &Encoding::kByte_;
+  for (const auto& segment : segments) {
+    const Encoding* encoding = &segment.getEncoding();
+    if (encoding != &Encoding::kEci_ 
+        && encoding != &Encoding::kStructuredAppend_) {
+      kEncoding_ = encoding;
+      return;
+    }
   }
 }
 
 // Sets version and error level. Chooses the smallest version possible with the
 // highest error correction without increasing version.
-void QRCode::setVersionAndErrorLevel(int mode, int length, ErrCor min_err_cor) {
+void QRCode::setVersionAndErrorLevel(const std::pmr::vector<Segment>& segments, 
+                                     ErrCor min_err_cor) {
   for (int i = 1; i <= 40; ++i) {
+    int used_bits = Segment::getTotalBits(segments, i);
+    if (used_bits < 0) {
+      continue;
+    }
     for (int j = static_cast<int>(ErrCor::kHigh); 
          j >= static_cast<int>(min_err_cor); --j) {
-      int capacity = getCapacity(i, static_cast<ErrCor>(j));
-      if (capacity >= length) {
+      int capacity = getTotalCodewords(i, static_cast<ErrCor>(j)) * 8;
+      if (capacity >= used_bits) {
         version_ = i;
         correctionLevel_ = static_cast<ErrCor>(j);
         return;
@@ -156,32 +344,69 @@ void QRCode::setVersionAndErrorLevel(int mode, int length, ErrCor min_err_cor) {
   throw std::logic_error("String too long!");
 }
 
-bool QRCode::isNumeric(std::string_view text) {
-  for (const auto& ch : text) {
-    if (ch < '0' || ch > '9') {
-      return false;
+// Sets the Micro QR version and error level the same way, returns false if
+// the data does not fit in any Micro QR code.
+bool QRCode::setMicroVersionAndErrorLevel(const std::pmr::vector<Segment>& segments, 
+                                          ErrCor min_err_cor) {
+  for (int i = 1; i <= 4; ++i) {
+    int used_bits = Segment::getMicroTotalBits(segments, i);
+    if (used_bits < 0) {
+      continue;
+    }
+    for (int j = static_cast<int>(ErrCor::kHigh); 
+         j >= static_cast<int>(min_err_cor); --j) {
+      int capacity = kMicro_data_bits_[j][i];
+      if (capacity >= used_bits) {
+        version_ = i;
+        correctionLevel_ = static_cast<ErrCor>(j);
+        return true;
+      }
     }
   }
-  return true;
+  return false;
 }
 
-bool QRCode::isAlphanumeric(std::string_view text) {
-  for (const auto& ch : text) {
-    if (kAlphanumericChar_.find(ch) == std::string::npos) {
-      return false;
+// Sets the rMQR version to the smallest rectangle no taller than 'max_height'
+// (any height if it is 0) that fits the data. rMQR codes only have the medium
+// and high error correction levels, the lower levels use medium.
+void QRCode::setRectMicroVersionAndErrorLevel(
+    const std::pmr::vector<Segment>& segments, ErrCor min_err_cor, 
+    int max_height) {
+  ErrCor min_level = min_err_cor <= ErrCor::kMedium ? ErrCor::kMedium 
+                                                    : ErrCor::kHigh;
+  int best = 0;
+  for (int i = 1; i <= 32; ++i) {
+    if (max_height > 0 && kRMQR_height_[i] > max_height) {
+      continue;
+    }
+    int used_bits = Segment::getRectMicroTotalBits(segments, i);
+    if (used_bits < 0 
+        || getRectMicroDataCodewords(i, min_level) * 8 < used_bits) {
+      continue;
+    }
+    int area = kRMQR_width_[i] * kRMQR_height_[i];
+    if (best == 0 || area < kRMQR_width_[best] * kRMQR_height_[best]) {
+      best = i;
     }
   }
-  return true;
-}
+  if (best == 0) {
+    throw std::logic_error("String too long!");
+  }
 
-// Only supporting ASCII characters currently.
-bool QRCode::isByte(std::string_view text) {
-  for (const auto& ch : text) {
-    if (ch < ' ' || ch > '~') {
-      return false;
-    }
+  version_ = best;
+  correctionLevel_ = min_level;
+  if (getRectMicroDataCodewords(best, ErrCor::kHigh) * 8 
+      >= Segment::getRectMicroTotalBits(segments, best)) {
+    correctionLevel_ = ErrCor::kHigh;
   }
-  return true;
+}
+
+// Returns the number of data codewords for a rMQR version and error
+// correction level (medium or high).
+int QRCode::getRectMicroDataCodewords(int version, ErrCor error_level) {
+  int ecl = error_level == ErrCor::kHigh ? 1 : 0;
+  return kRMQR_codewords_[version] - kRMQR_err_corr_blocks_[ecl][version] 
+         * kRMQR_EC_codewords_per_block_[ecl][version];
 }
 
 // Not supported currently.
@@ -189,22 +414,6 @@ bool QRCode::isKanji(std::string_view text) {
   return false;
 }
 
-int QRCode::numericCapacity(int bits) {
-  return (bits / 10) * 3 + ((bits % 10) > 6 ? 2 : (bits % 10) > 3 ? 1 : 0);
-}
-
-int QRCode::alphanumbericCapacity(int bits) {
-  return (bits / 11) * 2 + (bits % 11 > 5 ? 1 : 0);
-}
-
-int QRCode::byteCapacity(int bits) {
-  return bits >> 3;
-}
-
-int QRCode::kanjiCapacity(int bits) {
-  return bits / 13;
-}
-
 // Helper function to set function blocks to make sure they do not 
 // get overwritten.
 void QRCode::setFuncBlocks(int x, int y, bool isBlock) {
@@ -216,296 +425,363 @@ void QRCode::setFuncBlocks(int x, int y, bool isBlock) {
 
 // Sets all finder blocks in the correct location
 void QRCode::setFinderBlocks(int x, int y) {
-  for (int distance_y = -4; distance_y <= 4; ++distance_y) {
-    for (int distance_x = -4; distance_x <= 4; ++distance_x) {
-      int distance = std::max(std::abs(distance_x), std::abs(distance_y));
-      int block_x = x + distance_x;
-      int block_y = y + distance_y;
-      if (0 <= block_x && block_x < size_ && 0 <= block_y && block_y < size_) {
-        setFuncBlocks(block_x, block_y, distance != 2 && distance != 4);
-      }
-    }
-  }
+  StaticQRCode::drawFinder(x, y, size_, height_, 
+                           [this](int block_x, int block_y, bool dark) {
+    setFuncBlocks(block_x, block_y, dark);
+  });
 }
 
 // Helper function to set aligment blocks.
 void QRCode::setAlignmentBlocks(int x, int y) {
-  for (int distance_y = -2; distance_y <= 2; ++distance_y) {
-    for (int distance_x = -2; distance_x <= 2; ++distance_x) {
-      setFuncBlocks(x + distance_x, y + distance_y, 
-                    std::max(std::abs(distance_x), std::abs(distance_y)) != 1);
-    }
-  }
-}
-
-// Draws all alignment blocks
-void QRCode::drawAlignmentBlocks() {
-  const std::vector<int> aligment_pattern = determineAlignmentPos();
-  std::size_t intervals = aligment_pattern.size();
-  for (std::size_t i = 0; i < intervals; ++i) {
-    for (std::size_t j = 0; j < intervals; ++j) {
-      if (!((i == 0 && j == 0) || (i == 0 && j == intervals - 1) || 
-          (i == intervals - 1 && j == 0 ))) {
-        setAlignmentBlocks(aligment_pattern.at(i), aligment_pattern.at(j));
-      }
-    }
-  }
+  StaticQRCode::drawAlignment(x, y, 
+                              [this](int block_x, int block_y, bool dark) {
+    setFuncBlocks(block_x, block_y, dark);
+  });
 }
 
 // Draws all timing blocks, finder blocks, aligment blocks, format blocks,
 // and version blocks.
 void QRCode::drawPatterns() {
 
-  // Set each timing block, timing blocks are in row 6 and and column 6
-  // alternating true / false.
-  for (int i = 0; i < size_; ++i) {
-    setFuncBlocks(i, 6, i % 2 == 0);
-    setFuncBlocks(6, i, i % 2 == 0);
+  // Micro QR codes only have one finder, with the timing blocks along the
+  // top row and left column.
+  if (symbol_ == SymbolType::kMicro) {
+    for (int i = 0; i < size_; ++i) {
+      setFuncBlocks(i, 0, i % 2 == 0);
+      setFuncBlocks(0, i, i % 2 == 0);
+    }
+    setFinderBlocks(3, 3);
+    drawFormat(mask_);
+    return;
+  } else if (symbol_ == SymbolType::kRectMicro) {
+    drawRectMicroPatterns();
+    return;
   }
 
-  // Set each finder block
-  setFinderBlocks(3, 3);
-  setFinderBlocks(size_ - 4, 3);
-  setFinderBlocks(3, size_ - 4);
-
-  drawAlignmentBlocks();
-  drawFormat(mask_);
-  drawVersion();
+  StaticQRCode::drawPatterns(version_, correctionLevel_, mask_, 
+                             [this](int x, int y, bool dark) {
+    setFuncBlocks(x, y, dark);
+  });
 }
 
-// Draws all codewords into the QR code, without overwriting function blocks.
-void QRCode::drawCodewords() {
-  std::size_t i = 0;
+// Draws the rMQR finder, finder sub-pattern, corner finders, alignment blocks,
+// timing blocks and format blocks.
+void QRCode::drawRectMicroPatterns() {
+  static const int kAlignmentPos[6][5] = {
+    // Width, x position of each alignment pattern
+    {  27 },
+    {  43, 21 },
+    {  59, 19, 39 },
+    {  77, 25, 51 },
+    {  99, 23, 49, 75 },
+    { 139, 27, 55, 83, 111 },
+  };
+
+  // Finder with its separator in the top left, and the 5x5 finder 
+  // sub-pattern in the bottom right.
+  setFinderBlocks(3, 3);
+  setAlignmentBlocks(size_ - 3, height_ - 3);
 
-  // Draw the codewords in the zig-zag pattern, two columns at a time.
-  for (int right = size_ - 1; right >= 1; right -= 2) {
+  // Corner finders in the top right and bottom left. Short codes only have 
+  // the bottom row of the bottom left one, the rest is in the finder.
+  for (int i = 1; i <= 5; ++i) {
+    setFuncBlocks(size_ - i, 0, true);
+  }
+  setFuncBlocks(size_ - 2, 1, false);
+  setFuncBlocks(size_ - 1, 1, true);
+  setFuncBlocks(size_ - 1, 2, true);
+  for (int i = 0; i < 3; ++i) {
+    setFuncBlocks(i, height_ - 1, true);
+  }
+  if (height_ >= 11) {
+    setFuncBlocks(0, height_ - 2, true);
+    setFuncBlocks(1, height_ - 2, false);
+    setFuncBlocks(0, height_ - 3, true);
+  }
 
-    // Skip the 7th column since it is always reserved.
-    if (right == 6) { 
-      right = 5;
+  // 3x3 alignment blocks on the top and bottom edges, joined by a column of
+  // timing blocks.
+  std::pmr::vector<int> timing_columns({ 0, size_ - 1 }, resource_);
+  for (const auto& row : kAlignmentPos) {
+    if (row[0] != size_) {
+      continue;
     }
-    
-    // Starting from the bottom right corner, place blocks in a zig-zag pattern.
-    for (int vert = 0; vert < size_; ++vert) {
-      for (int j = 0; j < 2; ++j) { 
-        std::size_t x = static_cast<std::size_t>(right - j);
-        bool up = ((right + 1) & 2) == 0;
-        std::size_t y = static_cast<std::size_t>(up ? size_ - 1 - vert : vert);
-
-        // Don't overwrite function blocks.
-        if (!funcBlock_.at(y).at(x) && i < data_.size() * 8) {
-          blocks_.at(y).at(x) = 
-              (((data_.at(i >> 3) 
-              >> (7 - static_cast<int>(i & 7))) & 1) != 0) ? true : false;
-          ++i;
+    for (int i = 1; i < 5 && row[i] != 0; ++i) {
+      for (int distance_y = -1; distance_y <= 1; ++distance_y) {
+        for (int distance_x = -1; distance_x <= 1; ++distance_x) {
+          bool dark = distance_x != 0 || distance_y != 0;
+          setFuncBlocks(row[i] + distance_x, 1 + distance_y, dark);
+          setFuncBlocks(row[i] + distance_x, height_ - 2 + distance_y, dark);
         }
       }
+      timing_columns.push_back(row[i]);
     }
   }
-}
-
-// Draws format information (Error correction level and mask).
-void QRCode::drawFormat(int mask) {
 
-  // The format blocks are always made up of 15 bits.
-  // Find the first 5 format bits by shifting the format bits left 3, 
-  // and bitwise OR the mask.
-  int data = formatBits(correctionLevel_) << 3 | mask;
-
-  // Divide the first 5 bits by the polynomial x^10 
-  // (x^10 + x^9 ... x^2 + x + 1) and calculate the remainder.
-  int remainder = data;
-  for (int i = 0; i < 10; ++i) {
-    remainder = (remainder << 1) ^ ((remainder >> 9) * 0x537);
+  // Timing blocks fill the rest of the edges and the alignment columns.
+  for (int x = 0; x < size_; ++x) {
+    for (int y : { 0, height_ - 1 }) {
+      if (!funcBlock_.at(y).at(x)) {
+        setFuncBlocks(x, y, x % 2 == 0);
+      }
+    }
   }
-  
-  // Shift the bits left 10, bitwise OR the remainder and XOR 21522.
-  int bits = (data << 10 | remainder) ^ 0x5412;
-  
-  // Set the first set of format bits in the 8th column.
-  for (int i = 0; i <= 8; ++i) {
-    if ( i <= 5) {
-      setFuncBlocks(8, i, ((bits >> i) & 1) != 0);
-    } else if (i == 6) { // Skip row 6 since it is a timing block
-      continue;
-    } else { // Subtract 1 from 'i' since 6 was skipped.
-      setFuncBlocks(8, i, ((bits >> (i - 1)) & 1) != 0);
+  for (int x : timing_columns) {
+    for (int y = 0; y < height_; ++y) {
+      if (!funcBlock_.at(y).at(x)) {
+        setFuncBlocks(x, y, y % 2 == 0);
+      }
     }
   }
 
-  setFuncBlocks(7, 8, ((bits >> 8) & 1) != 0);
+  drawFormat(mask_);
+}
 
-  // Set the format blocks in the 8th row on the left side.
-  for (int i = 9; i < 15; ++i) {
-    setFuncBlocks(14 - i, 8, ((bits >> i) & 1) != 0);
-  }
+// Draws all codewords into the QR code, without overwriting function blocks.
+// The right column of a rMQR code is all function blocks, and only QR codes
+// have their timing blocks in the 7th column.
+void QRCode::drawCodewords() {
+  std::size_t i = 0;
+  int first = symbol_ == SymbolType::kRectMicro ? size_ - 2 : size_ - 1;
+  StaticQRCode::forEachDataBlock(height_, first, 
+                                 symbol_ == SymbolType::kQR, 
+                                 [this](int x, int y) {
+    return funcBlock_[y][x];
+  }, [this, &i](int x, int y) {
+    if (i < data_.size() * 8) {
+      blocks_[y][x] = ((data_[i >> 3] >> (7 - (i & 7))) & 1) != 0;
+      ++i;
+    }
+  });
+}
+
+// Draws format information (Error correction level and mask).
+void QRCode::drawFormat(int mask) {
 
-  // Set the function blocks in the 8th row on the right side.
-  for (int i = 0; i < 8; ++i) {
-     setFuncBlocks(size_ - 1 - i, 8, ((bits >> i) & 1) != 0);
+  // rMQR format blocks are 18 bits, the error correction level and version
+  // followed by 12 bits of the same polynomial division as the version 
+  // blocks. A copy next to each finder is XORed with its own value.
+  if (symbol_ == SymbolType::kRectMicro) {
+    long bits = StaticQRCode::versionCode(
+        (correctionLevel_ == ErrCor::kHigh ? 1 : 0) << 5 | (version_ - 1));
+    long left = bits ^ 0x1FAB2;
+    long right = bits ^ 0x20A7B;
+
+    for (int i = 0; i < 15; ++i) {
+      setFuncBlocks(8 + i / 5, 1 + i % 5, ((left >> i) & 1) != 0);
+      setFuncBlocks(size_ - 8 + i / 5, height_ - 6 + i % 5, 
+                    ((right >> i) & 1) != 0);
+    }
+    for (int i = 15; i < 18; ++i) {
+      setFuncBlocks(11, i - 14, ((left >> i) & 1) != 0);
+      setFuncBlocks(size_ - 20 + i, height_ - 6, ((right >> i) & 1) != 0);
+    }
+    return;
   }
 
-  // Set the function blocks in the 8th coloumn on the bottom.
-  for (int i = 8; i < 15; ++i) {
-    setFuncBlocks(8, size_ - 15 + i, ((bits >> i) & 1) != 0);
+  // Micro QR codes use a 3 bit symbol number (version and error correction
+  // level) and a 2 bit mask, XOR 17477 and have a single copy of the format
+  // blocks around the finder.
+  if (symbol_ == SymbolType::kMicro) {
+    static const int kFirstSymbolNumber[] = { 0, 1, 3, 5 };
+    int symbol_number = kFirstSymbolNumber[version_ - 1] 
+                        + static_cast<int>(correctionLevel_);
+    int bits = StaticQRCode::formatCode(symbol_number << 2 | mask) ^ 0x4445;
+    for (int i = 0; i < 8; ++i) {
+      setFuncBlocks(8, i + 1, ((bits >> i) & 1) != 0);
+    }
+    for (int i = 8; i < 15; ++i) {
+      setFuncBlocks(15 - i, 8, ((bits >> i) & 1) != 0);
+    }
+    return;
   }
 
-  // Set the single dark block
-  setFuncBlocks(8, size_ - 8, true);
+  StaticQRCode::drawFormat(size_, correctionLevel_, mask, 
+                           [this](int x, int y, bool dark) {
+    setFuncBlocks(x, y, dark);
+  });
 }
 
-// Draws version data for versions 7 - 40.
+// Draws version data, only QR codes have version blocks.
 void QRCode::drawVersion() {
-
-  // No version blocks for v 1-6.
-  if (version_ < 7) {
+  if (symbol_ != SymbolType::kQR) {
     return;
   }
-
-  // The version blocks are made up of 18 bits. The first 6 bits are the
-  // version in binary, the other 12 are the remainder of polynomial division
-  // between the version and x^12 (x^12 + x^11 + x^10 + x^9... + x^2 + x + 1).
-  int remainder = version_;
-
-  for (int i = 0; i < 12; ++i) {
-
-    // Basically multiplies remainder by 2, divides remainder by 2^11 * 7973
-    // and XOR the calculated values.
-    remainder = (remainder << 1) ^ ((remainder >> 11) * 0x1F25);
-  }
-  
-  // Add the version bits to the other 12 bits by shifting the version by 12,
-  // and bitwise OR the calculated remainder.
-  long version_bits = static_cast<long>(version_) << 12 | remainder;
-  
-  // Place the version bits in a 6x3 rectangle above the bottom left finder 
-  // blocks, and a 3x6 rectangle to the left of the top right finder blocks.
-  for (int i = 0; i < 18; ++i) {
-    setFuncBlocks(size_ - 11 + i % 3, i / 3, ((version_bits >> i) & 1) != 0);
-    setFuncBlocks(i / 3, size_ - 11 + i % 3, ((version_bits >> i) & 1) != 0);
-  }
+  StaticQRCode::drawVersion(version_, [this](int x, int y, bool dark) {
+    setFuncBlocks(x, y, dark);
+  });
 }
 
 // Applies a mask to the data bits.
 void QRCode::mask(int mask) {
-  if (mask < 0 || mask > 7) {
+  if (mask < 0 || mask > 7 
+      || (symbol_ == SymbolType::kMicro && mask > 3)
+      || (symbol_ == SymbolType::kRectMicro && mask > 0)) {
     throw std::logic_error("Invalid mask.");
   }
-  
-  std::size_t size = static_cast<std::size_t>(size_);
-
-  for (std::size_t y = 0; y < size; ++y) {
-    for (std::size_t x = 0; x < size; ++x) {
-      bool swap;
-      switch (mask) {
-        // The mask pattern algorithms can be found here:
-        // https://www.thonky.com/qr-code-tutorial/mask-patterns
-        case 0: swap = (x + y) % 2 == 0;                   break;
-        case 1: swap = y % 2 == 0;                         break;
-        case 2: swap = x % 3 == 0;                         break;
-        case 3: swap = (x + y) % 3 == 0;                   break;
-        case 4: swap = (x / 3 + y / 2) % 2 == 0;           break;
-        case 5: swap = x * y % 2 + x * y % 3 == 0;         break;
-        case 6: swap = (x * y % 2 + x * y % 3) % 2 == 0;   break;
-        case 7: swap = ((x + y) % 2 + x * y % 3) % 2 == 0; break;
-        default: throw std::logic_error("Invalid mask value.");
-      }
 
-      // Apply the mask to all blocks that aren't function blocks.
-      blocks_.at(y).at(x) = 
-          blocks_.at(y).at(x) ^ (swap & !funcBlock_.at(y).at(x));
+  // Micro QR codes use four of the QR code masks, rMQR codes only use one.
+  if (symbol_ == SymbolType::kMicro) {
+    mask = kMicro_mask_pattern_[mask];
+  } else if (symbol_ == SymbolType::kRectMicro) {
+    mask = 4;
+  }
+  
+  // Apply the mask to all blocks that aren't function blocks.
+  for (int y = 0; y < height_; ++y) {
+    for (int x = 0; x < size_; ++x) {
+      blocks_[y][x] = blocks_[y][x] 
+          ^ (StaticQRCode::maskBit(mask, x, y) & !funcBlock_[y][x]);
     }
   }
 }
 
-// Encodes text based on encoding method.
-std::vector<std::uint8_t> QRCode::encodeText(std::string_view text) {
-  int mode = kEncoding_->getEncodingMode();
-
-  BitBuffer buffer;
-
-  // Convert encoding mode used to binary
-  buffer.appendBits(static_cast<std::uint32_t>(mode), 4);
-
-  // Convert number of codewords to binary
-  buffer.appendBits(static_cast<std::uint32_t>(text.length()), 
-                    kEncoding_->getBitsPerChar(version_));
-
-  if (mode == 1) { // Numeric
-    // Split each number into 'groups' of three, then encode each group
-    // with 10 bits
-    int group = 0;
-    int max = 0;
-
-    for (const auto& ch : text) {
-      if (ch < '0' || ch > '9') {
-        throw std::logic_error("Numeric: Contains non numeric characters!");
-      }
-      group = group * 10 + (ch - '0');
-      max++;
-      if (max == 3) {
-        buffer.appendBits(static_cast<std::uint32_t>(group), 10);
-        max = 0;
-        group = 0;
-      }
+// Tries each mask and returns the best one. QR codes keep the mask with the
+// lowest penalty score, Micro QR codes the highest edge score. For other
+// objectives each mask is scored the same way, then the mask best for the
+// objective is kept from those within 'tolerance' percent of the best score.
+int QRCode::chooseMask(MaskObjective objective, int tolerance) {
+  bool micro = symbol_ == SymbolType::kMicro;
+  int num_masks = micro ? 4 : 8;
+  long scores[8];
+  long costs[8];
+  int best_mask = 0;
+
+  for (int i = 0; i < num_masks; ++i) {
+    drawFormat(i);
+    mask(i);
+    scores[i] = micro ? -microMaskScore() : penaltyScore();
+    if (objective != MaskObjective::kPenalty) {
+      costs[i] = objectiveScore(objective);
     }
+    if (scores[i] < scores[best_mask]) {
+      best_mask = i;
+    }
+    mask(i); // XOR the mask again to remove it.
+  }
+  if (objective == MaskObjective::kPenalty) {
+    return best_mask;
+  }
 
-    // Check for extra digits
-    if (max > 0) {
-      buffer.appendBits(static_cast<std::uint32_t>(group), max * 3 + 1);
+  // Micro QR scores are negative, a higher edge score is better, so the
+  // bound moves toward zero.
+  long best_score = scores[best_mask];
+  long bound = best_score + std::abs(best_score) * tolerance / 100;
+  int chosen = best_mask;
+  for (int i = 0; i < num_masks; ++i) {
+    if (scores[i] <= bound && (costs[i] < costs[chosen] 
+        || (costs[i] == costs[chosen] && scores[i] < scores[chosen]))) {
+      chosen = i;
     }
+  }
+  return chosen;
+}
 
-  } else if (mode == 2) { // Alphanumeric
-    // Split each character into 'groups' of two, then encode each
-    // group with 11 bits. Each character is mapped to its aplha-
-    // numeric code.
-    int group = 0;
-    int max = 0;
+void QRCode::remask(MaskObjective objective, int tolerance) {
+  if (tolerance < 0) {
+    throw std::logic_error("Invalid tolerance.");
+  }
+  if (symbol_ == SymbolType::kRectMicro) {
+    return;
+  }
+  mask(mask_);
+  mask_ = chooseMask(objective, tolerance);
+  drawFormat(mask_);
+  mask(mask_);
+}
 
-    for (const auto& ch : text) {
-      std::size_t index = kAlphanumericChar_.find(ch);
-      group = group * 45 + index;
-      max++;
-      if (max == 2) {
-        buffer.appendBits(static_cast<std::uint32_t>(group), 11);
-        group = 0;
-        max = 0;
+// Dark blocks, or runs of dark blocks in the rows, of the masked code.
+long QRCode::objectiveScore(MaskObjective objective) const {
+  long score = 0;
+  for (int y = 0; y < height_; ++y) {
+    bool last = false;
+    for (int x = 0; x < size_; ++x) {
+      bool block = blocks_[y][x];
+      if (objective == MaskObjective::kDarkBlocks) {
+        score += block ? 1 : 0;
+      } else {
+        score += block && !last ? 1 : 0;
       }
+      last = block;
     }
+  }
+  return score;
+}
 
-    // Check for one remaining character
-    if (max > 0) {
-      // Only 6 bits needed for one char.
-      buffer.appendBits(static_cast<std::uint32_t>(group), 6); 
-    }
-
-  } else if (mode == 4) { // Byte
-    // Convert each char to binary using 8 bits per character.
-    for (const auto& ch : text) {
-      buffer.appendBits(static_cast<std::uint32_t>(ch), 8);
-    }
+// Penalty score from the four rules in the QR Code specification.
+long QRCode::penaltyScore() const {
+  return StaticQRCode::penaltyScore(blocks_, size_, height_);
+}
 
-  } else if (mode == 7) { // ECI
+// Micro QR code score, counting the dark blocks on the right and bottom
+// edges (without the timing blocks). The smaller count is weighted by 16.
+int QRCode::microMaskScore() const {
+  int right = 0;
+  int bottom = 0;
+  for (int i = 1; i < size_; ++i) {
+    right += blocks_[i][size_ - 1] ? 1 : 0;
+    bottom += blocks_[size_ - 1][i] ? 1 : 0;
+  }
+  return right <= bottom ? right * 16 + bottom : bottom * 16 + right;
+}
 
-  } else if (mode == 8) { // Kanji
+// Encodes each segment with its mode, character count and data bits.
+std::pmr::vector<std::uint8_t> QRCode::encodeSegments(
+    const std::pmr::vector<Segment>& segments) {
+  BitBuffer buffer(resource_);
+
+  bool micro = symbol_ == SymbolType::kMicro;
+  bool rmqr = symbol_ == SymbolType::kRectMicro;
+  for (const auto& segment : segments) {
+    const Encoding& encoding = segment.getEncoding();
+
+    // Convert encoding mode used to binary, and the number of characters.
+    if (rmqr) {
+      buffer.appendBits(
+          static_cast<std::uint32_t>(encoding.getRectMicroEncodingMode()), 3);
+      buffer.appendBits(static_cast<std::uint32_t>(segment.getNumChars()), 
+                        encoding.getRectMicroBitsPerChar(version_));
+    } else if (micro) {
+      buffer.appendBits(
+          static_cast<std::uint32_t>(encoding.getMicroEncodingMode()), 
+          version_ - 1);
+      buffer.appendBits(static_cast<std::uint32_t>(segment.getNumChars()), 
+                        encoding.getMicroBitsPerChar(version_));
+    } else {
+      buffer.appendBits(
+          static_cast<std::uint32_t>(encoding.getEncodingMode()), 4);
+      buffer.appendBits(static_cast<std::uint32_t>(segment.getNumChars()), 
+                        encoding.getBitsPerChar(version_));
+    }
 
+    const BitBuffer& data = segment.getData();
+    buffer.insert(buffer.end(), data.cbegin(), data.cend());
   }
 
-  // Add terminator if possible
-  std::size_t capacity = 
-      static_cast<std::size_t>(getTotalCodewords(version_, correctionLevel_))
-      * 8;
-  buffer.appendBits(0, std::min(4, static_cast<int>(capacity - buffer.size())));
-  buffer.appendBits(0, (8 - static_cast<int>(buffer.size() % 8)) % 8);
+  // Add terminator if possible. Micro QR codes have a longer terminator, and
+  // M1 and M3 have a capacity that ends with a 4 bit codeword.
+  int ecl = static_cast<int>(correctionLevel_);
+  std::size_t capacity = micro ? kMicro_data_bits_[ecl][version_] 
+      : rmqr ? getRectMicroDataCodewords(version_, correctionLevel_) * 8
+      : static_cast<std::size_t>(getTotalCodewords(version_, correctionLevel_))
+        * 8;
+  int terminator = micro ? 2 * version_ + 1 : rmqr ? 3 : 4;
+  buffer.appendBits(0, std::min(terminator, 
+                                static_cast<int>(capacity - buffer.size())));
+  buffer.appendBits(0, std::min((8 - static_cast<int>(buffer.size() % 8)) % 8,
+                                static_cast<int>(capacity - buffer.size())));
 
   // Add padding bytes until capacity is reached
-  for (std::uint8_t byte = 0xEC; buffer.size() < capacity;
+  for (std::uint8_t byte = 0xEC; buffer.size() + 8 <= capacity;
        byte ^= 0xEC ^ 0x11) {
     buffer.appendBits(byte, 8);
   }
+  buffer.appendBits(0, static_cast<int>(capacity - buffer.size()));
 
-  // Make a vector of bytes from the bit buffer
-  std::vector<std::uint8_t> codewords(buffer.size() / 8);
+  // Make a vector of bytes from the bit buffer, the last 4 bit codeword is
+  // kept in the high bits of a byte.
+  std::pmr::vector<std::uint8_t> codewords((buffer.size() + 7) / 8, 
+                                           resource_);
   for (std::size_t i = 0; i < buffer.size(); ++i) {
     codewords.at(i >> 3) |= (buffer.at(i) ? 1 : 0) << (7 - (i & 7));
   }
@@ -514,47 +790,75 @@ std::vector<std::uint8_t> QRCode::encodeText(std::string_view text) {
 }
 
 // Generates the correct error data correction codewords.
-std::vector<std::uint8_t> QRCode::generateEDC(
-    const std::vector<std::uint8_t>& data, int codewords) {
+std::pmr::vector<std::uint8_t> QRCode::generateEDC(
+    const std::pmr::vector<std::uint8_t>& data, int codewords) {
 
   // The degree will always be the total amount of codewords - the amount
   // of data codewords.
-  int degree = codewords - data.size();
-
-  // Create a message polynomial with a size of total codewords. Copy the data
-  // codewords into it and fill the remaining space with zeros.
-  std::vector<std::uint8_t> messagePoly(codewords, 0);
-  std::copy(data.cbegin(), data.cend(), messagePoly.begin());
-
-  // Divide the message polynomial by the generated polynomial and return 
-  // the remainder.
-  return rsPolyDiv(messagePoly, rsGeneratePoly(degree));
+  int degree = codewords - static_cast<int>(data.size());
+  std::pmr::vector<std::uint8_t> generator(degree, 0, resource_);
+  StaticQRCode::rsGeneratePoly(degree, generator.data());
+
+  std::pmr::vector<std::uint8_t> edc(degree, 0, resource_);
+  StaticQRCode::generateEDC(data.data(), static_cast<int>(data.size()), 
+                            generator.data(), degree, edc.data());
+  return edc;
 }
 
 // Splits data into blocks, appends EDC, and interleaves bits.
-std::vector<std::uint8_t> QRCode::addEDCInterleave(
-    const std::vector<std::uint8_t>& data) {
+std::pmr::vector<std::uint8_t> QRCode::addEDCInterleave(
+    const std::pmr::vector<std::uint8_t>& data) {
+
+  // Micro QR codes have a single block. The last data codeword of M1 and M3
+  // is only 4 bits, so the EDC follows it without being byte aligned.
+  if (symbol_ == SymbolType::kMicro) {
+    int ecl = static_cast<int>(correctionLevel_);
+    int data_bits = kMicro_data_bits_[ecl][version_];
+    const std::pmr::vector<std::uint8_t> edc = generateEDC(
+        data, static_cast<int>(data.size()) + kMicro_EC_codewords_[ecl][version_]);
+
+    BitBuffer buffer(resource_);
+    for (int i = 0; i < data_bits; ++i) {
+      buffer.push_back(((data.at(i >> 3) >> (7 - (i & 7))) & 1) != 0);
+    }
+    for (const auto& codeword : edc) {
+      buffer.appendBits(codeword, 8);
+    }
 
-  // Generate log and exponent tables
-  rsGenerateLogExp();
+    std::pmr::vector<std::uint8_t> codewords((buffer.size() + 7) / 8, 
+                                             resource_);
+    for (std::size_t i = 0; i < buffer.size(); ++i) {
+      codewords.at(i >> 3) |= (buffer.at(i) ? 1 : 0) << (7 - (i & 7));
+    }
+    return codewords;
+  }
 
   int num_blocks = 
       kErr_corr_blocks_[static_cast<int>(correctionLevel_)][version_];
   int ECC_per_block = 
       kEC_codewords_per_block_[static_cast<int>(correctionLevel_)][version_];
   int total_codewords = getTotalModules(version_) >> 3; // Divides result by 8.
+
+  // rMQR codes split their blocks the same way, using their own tables.
+  if (symbol_ == SymbolType::kRectMicro) {
+    int ecl = correctionLevel_ == ErrCor::kHigh ? 1 : 0;
+    num_blocks = kRMQR_err_corr_blocks_[ecl][version_];
+    ECC_per_block = kRMQR_EC_codewords_per_block_[ecl][version_];
+    total_codewords = kRMQR_codewords_[version_];
+  }
   int num_short_blocks = num_blocks - total_codewords % num_blocks;
   int short_block_len = total_codewords / num_blocks;
   
   // Split data into blocks, generate EDC for each block.
-  std::vector<std::vector<std::uint8_t> > split_blocks;
+  std::pmr::vector<std::pmr::vector<std::uint8_t> > split_blocks(resource_);
   for (int i = 0, j = 0; i < num_blocks; ++i) {
 
     // Calculate the amount of data codewords to be split into blocks by 
     // subtracting the number of error code correction codewords per block from
     // the length of a short block. Add 1 if splitting data into a long block.
-    std::vector<uint8_t> block(data.cbegin() + j, data.cbegin() 
-      + (j + short_block_len - ECC_per_block + (i < num_short_blocks ? 0 : 1)));
+    std::pmr::vector<uint8_t> block(data.cbegin() + j, data.cbegin() 
+      + (j + short_block_len - ECC_per_block + (i < num_short_blocks ? 0 : 1)),
+      resource_);
 
     // Increment 'j' by the size of the block to keep track of the index 
     // for the data codewords.
@@ -563,7 +867,7 @@ std::vector<std::uint8_t> QRCode::addEDCInterleave(
     // Generate EDC for short and long blocks. Adding 1 to the length of the
     // 'short_block_len'if generating EDC for long blocks. Append the EDC to the
     // block and insert into the 'split_blocks' vector.
-    const std::vector<uint8_t> edc = 
+    const std::pmr::vector<uint8_t> edc = 
         generateEDC(block, short_block_len + (i < num_short_blocks ? 0 : 1));
 
     // Pad short blocks with a '0' for now.
@@ -574,7 +878,7 @@ std::vector<std::uint8_t> QRCode::addEDCInterleave(
 
   // Interleave each byte from every block, ignoring the padding for 
   // the short blocks.
-  std::vector<uint8_t> EDC_interleave;
+  std::pmr::vector<uint8_t> EDC_interleave(resource_);
   for (int i = 0; i < split_blocks.at(0).size(); ++i) {
     for (int j = 0; j < split_blocks.size(); ++j) {
       if (i != short_block_len - ECC_per_block || j >= num_short_blocks)
@@ -585,178 +889,234 @@ std::vector<std::uint8_t> QRCode::addEDCInterleave(
   return EDC_interleave;
 }
 
-// ------------------------- Reed Solomon Math -------------------------
-
-// Generates logarithmic and exponential tables.
-void QRCode::rsGenerateLogExp() {
-  // Create logarithmic and expontent tables for GF(256).
-  // More info can be found here: 
-  // https://en.wikiversity.org/wiki/Reed%E2%80%93Solomon_codes_for_coders#Multiplication
-  for (int exp = 1, val = 1; exp < 256; exp++) {
-    val = val > 127 ? ((val << 1) ^ 285) : (val << 1);
-    rsLog_.at(val) = static_cast<uint8_t>(exp % 255);
-    rsExp_.at(exp % 255) = static_cast<uint8_t>(val);
-  }
-  rsExp_.at(255) = 1; // Exponent values cannot be zero.
-}
-
-// Returns the correct exponent for multiplication.
-std::uint8_t QRCode::reedSolomonMult(std::uint8_t x, std::uint8_t y) {
-  return x && y ? rsExp_.at((rsLog_.at(static_cast<std::size_t>(x)) 
-         + rsLog_.at(static_cast<std::size_t>(y))) % 255) : 0;
+// Prints the actual QR code to the terminal, with a quiet zone, in one
+// write() by TerminalRenderer. The stream is flushed first so what was
+// printed before the code comes before it.
+void QRCode::printQR() {
+  const std::vector<std::uint8_t> packed = PackedQRCode::serialize(*this, 0);
+  std::cout.flush();
+  TerminalRenderer().print(PackedQRCode(packed));
 }
 
-// Returns the correct exponent for division.
-std::uint8_t QRCode::reedSolomonDiv(std::uint8_t x, std::uint8_t y) {
-  return rsExp_.at((rsLog_.at(static_cast<std::size_t>(x)) 
-         + rsLog_.at(static_cast<std::size_t>(y))) % 255);
+// Prints encoded QR data.
+void QRCode::printData() {
+  std::cout << "Data: ";
+  for (int i = 0; i < data_.size(); ++i) {
+    std::cout << static_cast<int>(data_[i]) << " ";
+  }
+  std::cout << "\n";
 }
 
-// Reed Solomon Polynomial multiplication.
-std::vector<std::uint8_t> QRCode::rsPolyMult(
-    const std::vector<std::uint8_t>& poly1, 
-    const std::vector<std::uint8_t>& poly2) {
-
-  // 'coeffs' will be the resulting product polynomial, it will always be
-  // poly1.size() + poly2.size() - 1 in length.
-  std::vector<std::uint8_t> coeffs(poly1.size() + poly2.size() - 1, 0);
-
-  // Multiply each term of poly1 by all terms of poly2.
-  for (std::size_t index = 0; index < coeffs.size(); ++index) {
-    std::uint8_t coeff = 0;
-    
-    for (std::size_t p1index = 0; p1index <= index; ++p1index) {
-      std::size_t p2index = index - p1index;
-
-      // Make sure the indexes are not out of range, multiply, then add.
-      if (p1index < poly1.size() && p2index < poly2.size()) {
-        coeff ^= reedSolomonMult(poly1.at(p1index), poly2.at(p2index));
+// ---------------------- Raster Images ----------------------
+
+// A code drawn for a PBM or BMP file. PBM pixels are 1 for black and BMP
+// pixels index a palette of black then white, so PBM draws inverted. BMP
+// rows are padded to 4 bytes and the height is negative so the rows are
+// top down, the same order as PBM.
+class RasterImage {
+ public:
+  RasterImage(const QRCode& code, bool bmp, int scale, int quiet_zone)
+      : upscaler_(scale, quiet_zone, !bmp),
+        blocks_(static_cast<std::size_t>((code.getSize() + 7) / 8)
+                * code.getHeight()),
+        image_(blocks_, code.getSize(), code.getHeight()),
+        width_(upscaler_.getWidth(image_)),
+        height_(upscaler_.getHeight(image_)),
+        length_(Upscaler::getRowLength(width_, Upscaler::Format::k1Bit)),
+        stride_(bmp ? (length_ + 3) / 4 * 4 : length_),
+        header_(bmp ? makeBmpHeader() : makePbmHeader()) {
+    const int stride = image_.getStride();
+    for (int y = 0; y < code.getHeight(); ++y) {
+      for (int x = 0; x < code.getSize(); ++x) {
+        if (code.getBlock(x, y)) {
+          blocks_[y * stride + x / 8] |=
+              static_cast<std::uint8_t>(0x80 >> (x % 8));
+        }
       }
     }
-
-    coeffs.at(index) = coeff;
   }
-  return coeffs;
-}
-
-// Divides two polynomials and returns the remainder.
-std::vector<std::uint8_t> QRCode::rsPolyDiv(
-    const std::vector<std::uint8_t>& dividend, 
-    const std::vector<std::uint8_t>& divisor) {
-  std::size_t quotientLenth = dividend.size() - divisor.size() + 1;
 
-  // Assume all dividends are a remainder for now.
-  std::vector<std::uint8_t> remainder(dividend);
+  std::size_t getLength() const { return header_.size() + stride_ * height_; }
 
-  for (std::size_t count = 0; count < quotientLenth; ++count) {
-    if (remainder[0]) { // If the first value is 0, just remove it.
+  std::size_t write(std::span<std::uint8_t> out) const {
+    if (out.size() < getLength()) {
+      throw std::logic_error("Buffer too small.");
+    }
+    std::memcpy(out.data(), header_.data(), header_.size());
+    std::uint8_t* rows = out.data() + header_.size();
+    upscaler_.draw(image_, Upscaler::Format::k1Bit,
+                   std::span<std::uint8_t>(rows, stride_ * height_), stride_);
+    for (int y = 0; y < height_ && stride_ > length_; ++y) {
+      std::memset(rows + y * stride_ + length_, 0, stride_ - length_);
+    }
+    return getLength();
+  }
 
-      // Divide the first term of the dividend polynomial by the first term 
-      // of the divisor polynomial.
-      std::uint8_t factor = reedSolomonDiv(remainder.at(0), divisor.at(0));
+  // Only a light row and one row for each row of blocks are drawn. Every
+  // row of pixels is a buffer of its own pointing at one of them.
+  void write(int fd) const {
+    const int quiet_zone = upscaler_.getQuietZone();
+    const int scale = upscaler_.getScale();
+    std::vector<std::uint8_t> rows((image_.getHeight() + 1) * stride_, 0);
+    upscaler_.drawRow(image_, Upscaler::Format::k1Bit, -1, rows.data());
+    for (int y = 0; y < image_.getHeight(); ++y) {
+      upscaler_.drawRow(image_, Upscaler::Format::k1Bit, y + quiet_zone,
+                        rows.data() + (y + 1) * stride_);
+    }
 
-      // Subtraction polynomial. The size will always be the same as the size 
-      // of the remainder.
-      std::vector<std::uint8_t> subtr(remainder.size(), 0);
+    std::vector<iovec> buffers;
+    buffers.reserve(height_ + 1);
+    buffers.push_back({const_cast<char*>(header_.data()), header_.size()});
+    for (int y = 0; y < height_; ++y) {
+      int block = y / scale - quiet_zone;
+      std::size_t row = block < 0 || block >= image_.getHeight() ? 0
+                                                                  : block + 1;
+      buffers.push_back({rows.data() + row * stride_, stride_});
+    }
+    QROutput::writeAll(fd, buffers);
+  }
 
-      // Multiply the divisor polynomial by the above quotient and copy the
-      // values into the subtraction polynomial vector.
-      std::vector<std::uint8_t> product = rsPolyMult(divisor, { factor });
-      std::copy(product.begin(), product.end(), subtr.begin());
+ private:
+  std::string makePbmHeader() const {
+    return "P4\n" + std::to_string(width_) + " " + std::to_string(height_)
+           + "\n";
+  }
 
-      // Find the remainder by subtracting the result from the dividend.
-      for (std::size_t index = 0; index < remainder.size(); ++index) {
-        remainder.at(index) ^= subtr.at(index);
+  std::string makeBmpHeader() const {
+    std::string header(62, '\0');
+    auto put = [&header](int offset, std::uint32_t value, int bytes) {
+      for (int i = 0; i < bytes; ++i) {
+        header[offset + i] = static_cast<char>(value >> (8 * i));
       }
-
-      // Remove the first term from the remainder.
-      remainder.erase(remainder.begin());
-    } else {
-
-      // Since the first term is 0, remove it.
-      remainder.erase(remainder.begin());
-    }
+    };
+    const std::uint32_t image = static_cast<std::uint32_t>(stride_ * height_);
+    header[0] = 'B';
+    header[1] = 'M';
+    put(2, 62 + image, 4);                            // File size
+    put(10, 62, 4);                                   // Offset of the pixels
+    put(14, 40, 4);                                   // Info header size
+    put(18, static_cast<std::uint32_t>(width_), 4);
+    put(22, static_cast<std::uint32_t>(-height_), 4); // Top down
+    put(26, 1, 2);                                    // Planes
+    put(28, 1, 2);                                    // Bits per pixel
+    put(34, image, 4);
+    put(38, 2835, 4);                                 // 72 DPI
+    put(42, 2835, 4);
+    put(46, 2, 4);                                    // Colors in palette
+    put(58, 0x00FFFFFF, 4);                           // Black then white
+    return header;
   }
 
-  return remainder;
+  Upscaler upscaler_;                // Draws the rows of pixels
+  std::vector<std::uint8_t> blocks_; // Packed rows of blocks
+  QRImage image_;                    // View of 'blocks_'
+  int width_;                        // Pixels in a row
+  int height_;                       // Rows of pixels
+  std::size_t length_;               // Bytes of pixels in a row
+  std::size_t stride_;               // Bytes in a row with padding
+  std::string header_;               // Header of the file
+}; // RasterImage
+
+std::size_t QRCode::getPbmLength(int scale, int quiet_zone) const {
+  return RasterImage(*this, false, scale, quiet_zone).getLength();
 }
 
-// Generates a polynomial of degree 'n' to find the remainder in RS division.
-std::vector<std::uint8_t> QRCode::rsGeneratePoly(int degree) {
-  std::vector<std::uint8_t> lastPoly = { 1 };
-
-  // Generate a polynomial with 'degree' terms.
-  for (std::size_t i = 0; i < degree; ++i) {
-    lastPoly = rsPolyMult(lastPoly, { 1, rsExp_.at(i) });
-  }
+std::size_t QRCode::getBmpLength(int scale, int quiet_zone) const {
+  return RasterImage(*this, true, scale, quiet_zone).getLength();
+}
 
-  return lastPoly;
+std::size_t QRCode::writePbm(std::span<std::uint8_t> out, int scale,
+                             int quiet_zone) const {
+  return RasterImage(*this, false, scale, quiet_zone).write(out);
 }
 
-// Returns a value from 0 to 3 depending on error correction level.
-int QRCode::formatBits(ErrCor errorCorrectionLevel) {
-  switch(errorCorrectionLevel) {
-    case ErrCor::kLow      : return 1;
-    case ErrCor::kMedium   : return 0;
-    case ErrCor::kQuartile : return 3;
-    case ErrCor::kHigh     : return 2;
-    default: throw std::logic_error("Invalid ECL");
-  }
+std::size_t QRCode::writeBmp(std::span<std::uint8_t> out, int scale,
+                             int quiet_zone) const {
+  return RasterImage(*this, true, scale, quiet_zone).write(out);
 }
 
-// Prints the actual QR code to the terminal.
-void QRCode::printQR() {
-  for (int y = 0; y < size_; ++y) {
-    for (int x = 0; x < size_; ++x) {
-      std::cout << (blocks_[y][x] ? "██" : "  ");
-    }
-    std::cout << "\n";
-  }
+void QRCode::writePbm(int fd, int scale, int quiet_zone) const {
+  RasterImage(*this, false, scale, quiet_zone).write(fd);
 }
 
-// Prints encoded QR data.
-void QRCode::printData() {
-  std::cout << "Data: ";
-  for (int i = 0; i < data_.size(); ++i) {
-    std::cout << static_cast<int>(data_[i]) << " ";
-  }
-  std::cout << "\n";
+void QRCode::writeBmp(int fd, int scale, int quiet_zone) const {
+  RasterImage(*this, true, scale, quiet_zone).write(fd);
 }
 
-// ------Constants------                                Version Version Version
-                                        // Encoding Mode,  1-9,  10-26,  27-40
-const QRCode::Encoding QRCode::Encoding::kNumeric_ (   1,   10,     12,   14);
-const QRCode::Encoding QRCode::Encoding::kAlpha_   (   2,   9,      11,   13);
-const QRCode::Encoding QRCode::Encoding::kByte_    (   4,   8,      16,   16);
-const QRCode::Encoding QRCode::Encoding::kEci_     (   7,   0,       0,    0);
-const QRCode::Encoding QRCode::Encoding::kKanji_   (   8,   8,      10,   12);
+// ------Constants------                                Version Version Version  Micro QR                 rMQR
+                                        // Encoding Mode,  1-9,  10-26,  27-40,  Mode, M1, M2, M3, M4,  Mode
+const QRCode::Encoding QRCode::Encoding::kNumeric_ (   1,   10,     12,   14,     0,  3,  4,  5,  6,     1);
+const QRCode::Encoding QRCode::Encoding::kAlpha_   (   2,   9,      11,   13,     1, -1,  3,  4,  5,     2);
+const QRCode::Encoding QRCode::Encoding::kByte_    (   4,   8,      16,   16,     2, -1, -1,  4,  5,     3);
+const QRCode::Encoding QRCode::Encoding::kEci_     (   7,   0,       0,    0,    -1, -1, -1, -1, -1,     7);
+const QRCode::Encoding QRCode::Encoding::kKanji_   (   8,   8,      10,   12,     3, -1, -1,  3,  4,     4);
+const QRCode::Encoding QRCode::Encoding::kStructuredAppend_ 
+                                                    (   3,   0,       0,    0,    -1, -1, -1, -1, -1,    -1);
+
+// Micro QR data bits and error correction codewords, -1 when the error
+// correction level can not be used with the version. M1 only has error
+// detection, which is treated as the low level.
+const std::int16_t QRCode::kMicro_data_bits_[4][5] = {
+  // Version: (index[0] is a placeholder)
+  //    M1,  M2,  M3,  M4  Error Correction
+  {-1,  20,  40,  84, 128}, // Low
+  {-1,  -1,  32,  68, 112}, // Medium
+  {-1,  -1,  -1,  -1,  80}, // Quartile
+  {-1,  -1,  -1,  -1,  -1}, // High
+};
+
+const std::int8_t QRCode::kMicro_EC_codewords_[4][5] = {
+  // Version: (index[0] is a placeholder)
+  //   M1, M2, M3, M4  Error Correction
+  {-1,  2,  5,  6,  8}, // Low
+  {-1, -1,  6,  8, 10}, // Medium
+  {-1, -1, -1, -1, 14}, // Quartile
+  {-1, -1, -1, -1, -1}, // High
+};
+
+// QR code mask used for each of the four Micro QR masks.
+const std::int8_t QRCode::kMicro_mask_pattern_[4] = { 1, 4, 6, 7 };
 
-// Supported alphanumeric char set.
-const std::string QRCode::kAlphanumericChar_ = 
-    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+// The rMQR values can be found in ISO/IEC 23941, version 1 is R7x43 and the
+// versions go through each width for every height.
+const std::uint8_t QRCode::kRMQR_height_[33] = {
+  0,  7,  7,  7,  7,  7,  9,  9,  9,  9,  9, 11, 11, 11, 11, 11, 11, 
+     13, 13, 13, 13, 13, 13, 15, 15, 15, 15, 15, 17, 17, 17, 17, 17,
+};
 
-// The values for error correction code words per block and the number of error
-// correction blocks can be found at: 
-// https://www.thonky.com/qr-code-tutorial/error-correction-table
+const std::uint8_t QRCode::kRMQR_width_[33] = {
+  0, 43, 59, 77, 99,139, 43, 59, 77, 99,139, 27, 43, 59, 77, 99,139,
+     27, 43, 59, 77, 99,139, 43, 59, 77, 99,139, 43, 59, 77, 99,139,
+};
+
+// Total codewords for each rMQR version.
+const std::uint8_t QRCode::kRMQR_codewords_[33] = {
+  0, 13, 21, 32, 44, 68, 21, 33, 49, 66, 99, 15, 31, 47, 67, 89,132,
+     21, 41, 60, 85,113,166, 51, 74,103,136,199, 61, 88,122,160,232,
+};
+
+// Character count length for numeric, alphanumeric, byte and kanji modes.
+const std::int8_t QRCode::Encoding::kRMQR_bits_per_char_[4][33] = {
+  // Version: (index[0] is a placeholder)
+  //  R7 x 43-139,   R9 x 43-139,   R11 x 27-139,     R13 x 27-139,     R15 x 43-139,  R17 x 43-139   Mode
+  {-1, 4, 5, 6, 7, 7, 5, 6, 7, 7, 8, 4, 6, 7, 7, 8, 8, 5, 6, 7, 7, 8, 8, 7, 7, 8, 8, 9, 7, 8, 8, 8, 9}, // Numeric
+  {-1, 3, 5, 5, 6, 6, 5, 5, 6, 6, 7, 4, 5, 6, 6, 7, 7, 5, 6, 6, 7, 7, 8, 6, 7, 7, 7, 8, 6, 7, 7, 8, 8}, // Alphanumeric
+  {-1, 3, 4, 5, 5, 6, 4, 5, 5, 6, 6, 3, 5, 5, 6, 6, 7, 4, 5, 6, 6, 7, 7, 6, 6, 7, 7, 7, 6, 6, 7, 7, 8}, // Byte
+  {-1, 2, 3, 4, 5, 5, 3, 4, 5, 5, 6, 2, 4, 5, 5, 6, 6, 3, 5, 5, 6, 6, 7, 5, 5, 6, 6, 7, 5, 6, 6, 6, 7}, // Kanji
+};
 
 // Error correction codewords per block
-const std::int8_t QRCode::kEC_codewords_per_block_[4][41] = {
+const std::int8_t QRCode::kRMQR_EC_codewords_per_block_[2][33] = {
   // Version: (index[0] is a placeholder)
-  //    1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40  Error Correction
-  {-1,  7, 10, 15, 20, 26, 18, 20, 24, 30, 18, 20, 24, 26, 30, 22, 24, 28, 30, 28, 28, 28, 28, 30, 30, 26, 28, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}, // Low
-  {-1, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26, 30, 22, 22, 24, 24, 28, 28, 26, 26, 26, 26, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28}, // Medium
-  {-1, 13, 22, 18, 26, 18, 24, 18, 22, 20, 24, 28, 26, 24, 20, 30, 24, 28, 28, 26, 30, 28, 30, 30, 30, 30, 28, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}, // Quartile
-  {-1, 17, 28, 22, 16, 22, 28, 26, 26, 24, 28, 24, 28, 22, 24, 24, 30, 28, 28, 26, 28, 30, 24, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}, // High
+  //       R7 x 43-139,        R9 x 43-139,            R11 x 27-139,            R13 x 27-139,        R15 x 43-139,        R17 x 43-139  Error Correction
+  {-1,  7,  9, 12, 16, 24,  9, 12, 18, 24, 18,  8, 12, 16, 24, 16, 24,  9, 14, 22, 16, 20, 20, 18, 26, 18, 24, 24, 22, 16, 22, 20, 20}, // Medium
+  {-1, 10, 14, 22, 30, 22, 14, 22, 16, 22, 22, 10, 20, 16, 22, 30, 30, 14, 28, 20, 28, 26, 26, 18, 24, 24, 22, 26, 20, 30, 28, 26, 26}, // High
 };
 
 // Number of error correction blocks
-const std::int8_t QRCode::kErr_corr_blocks_[4][41] = {
+const std::int8_t QRCode::kRMQR_err_corr_blocks_[2][33] = {
   // Version: (index[0] is a placeholder)
-  //   1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40  Error Correction
-  {-1, 1, 1, 1, 1, 1, 2, 2, 2, 2,  4,  4,  4,  4,  4,  6,  6,  6,  6,  7,  8,  8,  9,  9, 10, 12, 12, 12, 13, 14, 15, 16, 17, 18, 19, 19, 20, 21, 22, 24, 25}, // Low
-  {-1, 1, 1, 1, 2, 2, 4, 4, 4, 5,  5,  5,  8,  9,  9, 10, 10, 11, 13, 14, 16, 17, 17, 18, 20, 21, 23, 25, 26, 28, 29, 31, 33, 35, 37, 38, 40, 43, 45, 47, 49}, // Medium
-  {-1, 1, 1, 2, 2, 4, 4, 6, 6, 8,  8,  8, 10, 12, 16, 12, 17, 16, 18, 21, 20, 23, 23, 25, 27, 29, 34, 34, 35, 38, 40, 43, 45, 48, 51, 53, 56, 59, 62, 65, 68}, // Quartile
-  {-1, 1, 1, 2, 4, 4, 4, 5, 6, 8,  8, 11, 11, 16, 16, 18, 16, 19, 21, 25, 25, 25, 34, 30, 32, 35, 37, 40, 42, 45, 48, 51, 54, 57, 60, 63, 66, 70, 74, 77, 81}, // High
+  //  R7 x 43-139,   R9 x 43-139,   R11 x 27-139,     R13 x 27-139,     R15 x 43-139,  R17 x 43-139   Error Correction
+  {-1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 1, 1, 1, 1, 2, 2, 1, 1, 1, 2, 2, 3, 1, 1, 2, 2, 3, 1, 2, 2, 3, 4}, // Medium
+  {-1, 1, 1, 1, 1, 2, 1, 1, 2, 2, 3, 1, 1, 2, 2, 2, 3, 1, 1, 2, 2, 3, 4, 2, 2, 3, 4, 5, 2, 2, 3, 4, 6}, // High
 };
-
-
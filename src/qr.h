@@ -1,7 +1,10 @@
 #ifndef QR_H_
 #define QR_H_
 
+#include <cstdint>
 #include <cstdlib>
+#include <memory_resource>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -16,6 +19,14 @@ class QRCode {
     kHigh,      // 30% Error Correction
   }; // ErrCor
 
+  // Kind of symbol to generate.
+  enum class SymbolType {
+    kQR = 0,    // QR code, versions 1-40
+    kMicro,     // Micro QR code, versions M1-M4
+    kAuto,      // Micro QR code if the data fits, otherwise a QR code
+    kRectMicro, // Rectangular Micro QR code (rMQR), R7x43 to R17x139
+  }; // SymbolType
+
   class Encoding {
    public:
     // Constants for length of bits depending on version number
@@ -25,99 +36,279 @@ class QRCode {
     static const Encoding kByte_;
     static const Encoding kEci_;
     static const Encoding kKanji_;
+    static const Encoding kStructuredAppend_;
 
     int getEncodingMode() const;
     int getBitsPerChar(int) const;
+
+    // Mode indicator and character count length for Micro QR versions. The
+    // length is -1 if the mode can not be used in the version.
+    int getMicroEncodingMode() const;
+    int getMicroBitsPerChar(int) const;
+
+    // Mode indicator and character count length for rMQR versions (R7x43 is
+    // version 1), -1 if the mode can not be used.
+    int getRectMicroEncodingMode() const;
+    int getRectMicroBitsPerChar(int) const;
    private:
     // Constructor
-    Encoding(int, int, int, int);
+    Encoding(int, int, int, int, int, int, int, int, int, int);
 
     int encoding_mode_;
     int bits_per_char_[3];
+    int micro_encoding_mode_;
+    int micro_bits_per_char_[4];
+    int rmqr_encoding_mode_;
+    static const std::int8_t kRMQR_bits_per_char_[4][33];
   }; // Encoding
 
-  class BitBuffer : public std::vector<bool> {
+  class BitBuffer : public std::pmr::vector<bool> {
    public:
-    BitBuffer();
+    explicit BitBuffer(std::pmr::memory_resource* resource = 
+                           std::pmr::get_default_resource());
     void appendBits(std::uint32_t, int);
   }; // BitBuffer
 
-  // QR Code constructor.
-  QRCode(std::string, ErrCor err = ErrCor::kLow, int msk = 0);
-  ~QRCode();
+  // A run of data encoded with a single mode. Several segments can be put
+  // in one QR code, an ECI segment changes the character set used to read
+  // the segments that follow it.
+  class Segment {
+   public:
+    // Each factory allocates the segment data from 'resource'.
+    static Segment makeNumeric(std::string_view, 
+                               std::pmr::memory_resource* resource = 
+                                   std::pmr::get_default_resource());
+    static Segment makeAlphanumeric(std::string_view, 
+                                    std::pmr::memory_resource* resource = 
+                                        std::pmr::get_default_resource());
+    static Segment makeBytes(std::string_view, 
+                             std::pmr::memory_resource* resource = 
+                                 std::pmr::get_default_resource());
+    static Segment makeEci(int, std::pmr::memory_resource* resource = 
+                                    std::pmr::get_default_resource());
+
+    // Structured Append header: position of the symbol, number of symbols
+    // and the parity of the whole message.
+    static Segment makeStructuredAppend(int, int, std::uint8_t, 
+                                        std::pmr::memory_resource* resource = 
+                                            std::pmr::get_default_resource());
+
+    // Chooses the segments for the text. UTF-8 text that is not plain ASCII
+    // is put in byte mode after an ECI 26 (UTF-8) designator.
+    static std::pmr::vector<Segment> makeSegments(
+        std::string_view, std::pmr::memory_resource* resource = 
+                              std::pmr::get_default_resource());
+
+    // Returns the number of bits needed to store the segments in the given
+    // version, or -1 if a character count is too long for the version.
+    static int getTotalBits(const std::pmr::vector<Segment>&, int);
+    static int getMicroTotalBits(const std::pmr::vector<Segment>&, int);
+    static int getRectMicroTotalBits(const std::pmr::vector<Segment>&, int);
+
+    const Encoding& getEncoding() const { return *encoding_; }
+    int getNumChars() const { return num_chars_; }
+    const BitBuffer& getData() const { return data_; }
+   private:
+    // Constructor
+    Segment(const Encoding&, int, BitBuffer);
+
+    const Encoding* encoding_;
+    int num_chars_;
+    BitBuffer data_;
+  }; // Segment
+
+  // ECI assignment number for UTF-8.
+  static const int kEciUtf8 = 26;
+
+  // Mask value that tries every mask and keeps the best one.
+  static const int kAutoMask = -1;
+
+  // What remask() looks for among the masks that score well enough.
+  enum class MaskObjective {
+    kPenalty = 0, // Best score, the standard choice
+    kDarkBlocks,  // Fewest dark blocks, for less heat or engraving
+    kDarkRuns,    // Fewest runs of dark blocks in the rows, each is a start
+                  // and stop of a print head or laser
+  }; // MaskObjective
+
+  // QR Code constructors. 'max_height' limits the height of rMQR codes, the
+  // smallest rectangle that fits is used. Everything the code allocates,
+  // while it is made and after, comes from 'resource'.
+  QRCode(std::string, ErrCor err = ErrCor::kLow, int msk = 0, 
+         SymbolType type = SymbolType::kQR, int max_height = 0, 
+         std::pmr::memory_resource* resource = 
+             std::pmr::get_default_resource());
+  QRCode(const std::pmr::vector<Segment>&, ErrCor err = ErrCor::kLow, 
+         int msk = 0, SymbolType type = SymbolType::kQR, int max_height = 0, 
+         std::pmr::memory_resource* resource = 
+             std::pmr::get_default_resource());
 
   int getEncoding() { return kEncoding_->getEncodingMode(); }
-  int getBitsPerChar() { return kEncoding_->getBitsPerChar(version_); }
-  int getVersion() { return version_; }
-  int getSize() { return size_; }
-  int getMask() { return mask_; }
+  int getBitsPerChar();
+  int getVersion() const { return version_; }
+  SymbolType getSymbolType() const { return symbol_; }
+  int getSize() const { return size_; }
+  int getHeight() const { return height_; }
+  int getMask() const { return mask_; }
   std::string getText() { return plain_text_; }
+  ErrCor getErrCor() const { return correctionLevel_; }
+  bool getBlock(int x, int y) const { return blocks_[y][x]; }
+
+  // Returns the number of data codewords for a version and error correction
+  // level.
+  static constexpr int getTotalCodewords(int, ErrCor);
+
+  // Chooses the mask again, whatever mask the code was made with. Of the
+  // masks scoring within 'tolerance' percent of the best score, the one best
+  // for 'objective' is kept, ties going to the better score. rMQR codes have
+  // only one mask and are left as they are.
+  void remask(MaskObjective, int tolerance = 10);
 
   void printQR();         
   void printData();       
 
+  // Binary PBM (P4) and 1 bit BMP images of the code, each block 'scale'
+  // pixels square with 'quiet_zone' light blocks around it. The rows are
+  // already packed bits in both formats, so each row of blocks is drawn
+  // once and copied for the rest.
+
+  // Length of the image in bytes, such as the size of a file to map.
+  std::size_t getPbmLength(int scale = 1, int quiet_zone = 4) const;
+  std::size_t getBmpLength(int scale = 1, int quiet_zone = 4) const;
+
+  // Writes the image into the buffer and returns its length. Throws if the
+  // buffer is too small.
+  std::size_t writePbm(std::span<std::uint8_t>, int scale = 1,
+                       int quiet_zone = 4) const;
+  std::size_t writeBmp(std::span<std::uint8_t>, int scale = 1,
+                       int quiet_zone = 4) const;
+
+  // Writes the image to the file descriptor with writev(), every row of
+  // pixels pointing at its row of blocks, so nothing is copied to scale it.
+  void writePbm(int, int scale = 1, int quiet_zone = 4) const;
+  void writeBmp(int, int scale = 1, int quiet_zone = 4) const;
+
  private:
-  void determineEncoding(std::string_view);
-  std::vector<int> determineAlignmentPos() const;
-  int getTotalModules(int);
-  int getTotalCodewords(int, ErrCor);
-  int getCapacity(int, ErrCor);
-  void setVersionAndErrorLevel(int, int, ErrCor);
-
-  // Functions to determine type of text given.
-  bool isNumeric(std::string_view);
-  bool isAlphanumeric(std::string_view);
-  bool isByte(std::string_view);
-  bool isKanji(std::string_view);
-
-  // Functions that return capacities for each encoding mode and version.
-  int numericCapacity(int);
-  int alphanumbericCapacity(int);
-  int byteCapacity(int);
-  int kanjiCapacity(int);
+  friend class StaticQRCode;
+  template <int> friend class BasicQRCode;
+  friend class CompactQRCode;
+  friend class PackedQRCode;
+
+  // Draws only the function blocks of a QR code of the version, with the
+  // format blocks for level L and mask 0. Used for the CompactQRCode 
+  // templates.
+  QRCode(int, std::pmr::memory_resource* resource = 
+                  std::pmr::get_default_resource());
+
+  void determineEncoding(const std::pmr::vector<Segment>&);
+  static constexpr int getTotalModules(int);
+  void setVersionAndErrorLevel(const std::pmr::vector<Segment>&, ErrCor);
+  bool setMicroVersionAndErrorLevel(const std::pmr::vector<Segment>&, ErrCor);
+  void setRectMicroVersionAndErrorLevel(const std::pmr::vector<Segment>&, 
+                                        ErrCor, int);
+  static int getRectMicroDataCodewords(int, ErrCor);
+
+  // Functions to determine type of text given, the others are in
+  // StaticQRCode.
+  static bool isKanji(std::string_view);
 
   // Functions that set blocks and draws blocks.
   void setFuncBlocks(int, int, bool); 
   void setFinderBlocks(int, int);     
   void setAlignmentBlocks(int, int);  
-  void drawAlignmentBlocks();         
   void drawPatterns();                
+  void drawRectMicroPatterns();
   void drawCodewords();               
   void drawFormat(int);               
   void drawVersion();                 
   void mask(int);                     
+  int chooseMask(MaskObjective objective = MaskObjective::kPenalty, 
+                 int tolerance = 0);
+  long penaltyScore() const;
+  int microMaskScore() const;
+  long objectiveScore(MaskObjective) const;
 
   // Encoding functions
-  std::vector<std::uint8_t> encodeText(std::string_view);                   
-  std::vector<std::uint8_t> generateEDC(const std::vector<std::uint8_t>&, int);   
-  std::vector<std::uint8_t> addEDCInterleave(const std::vector<std::uint8_t>&);   
-
-  // Reed Solomon Math 
-  void rsGenerateLogExp();                                             
-  std::uint8_t reedSolomonMult(std::uint8_t, std::uint8_t);            
-  std::uint8_t reedSolomonDiv(std::uint8_t, std::uint8_t);             
-  std::vector<std::uint8_t> rsPolyMult(const std::vector<std::uint8_t>&, 
-                                       const std::vector<std::uint8_t>&);  
-  std::vector<std::uint8_t> rsPolyDiv(const std::vector<std::uint8_t>&, 
-                                      const std::vector<std::uint8_t>&); 
-  std::vector<std::uint8_t> rsGeneratePoly(int);                       
-
-  int formatBits(ErrCor); 
+  std::pmr::vector<std::uint8_t> encodeSegments(
+      const std::pmr::vector<Segment>&);
+  std::pmr::vector<std::uint8_t> generateEDC(
+      const std::pmr::vector<std::uint8_t>&, int);
+  std::pmr::vector<std::uint8_t> addEDCInterleave(
+      const std::pmr::vector<std::uint8_t>&);
   
+  SymbolType symbol_;                         // QR, Micro QR or rMQR code
   int version_;                               // Version number of QR code
-  int size_;                                  // Height and Witdh of QR code
+  int size_;                                  // Width of QR code
+  int height_;                                // Height, same as the width 
+                                              // unless it is a rMQR code
   int mask_;                                  // Mask pattern used
-  std::string plain_text_;                    // Original text
+  std::string plain_text_;                    // Original text, if given
   ErrCor correctionLevel_;                    // Correction level for QR Code
-  std::vector<std::vector<bool> > blocks_;    // Blocks that make up the QR code 
-  std::vector<std::vector<bool> > funcBlock_; // Blocks that will not be masked
-  std::vector<std::uint8_t> data_;            // Text encoded into bytes + EDC
-  std::vector<std::uint8_t> rsLog_;           // Log values for RS algorithm
-  std::vector<std::uint8_t> rsExp_;           // Exp values for RS algorithm
-  const Encoding* kEncoding_;                 // Encoding method used
-  static const std::string kAlphanumericChar_;              
-  static const std::int8_t kEC_codewords_per_block_[4][41]; 
-  static const std::int8_t kErr_corr_blocks_[4][41];        
+  std::pmr::memory_resource* resource_;       // Allocates everything below
+  std::pmr::vector<std::pmr::vector<bool> > blocks_;    // Blocks of the code
+  std::pmr::vector<std::pmr::vector<bool> > funcBlock_; // Blocks not masked
+  std::pmr::vector<std::uint8_t> data_;       // Text encoded into bytes + EDC
+  const Encoding* kEncoding_;                 // Encoding of the data
+  static const std::int16_t kMicro_data_bits_[4][5];
+  static const std::int8_t kMicro_EC_codewords_[4][5];
+  static const std::int8_t kMicro_mask_pattern_[4];
+  static const std::uint8_t kRMQR_height_[33];
+  static const std::uint8_t kRMQR_width_[33];
+  static const std::uint8_t kRMQR_codewords_[33];
+  static const std::int8_t kRMQR_EC_codewords_per_block_[2][33];
+  static const std::int8_t kRMQR_err_corr_blocks_[2][33];
+
+  // Supported alphanumeric char set.
+  static constexpr std::string_view kAlphanumericChar_ = 
+      "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+
+  // The values for error correction code words per block and the number of
+  // error correction blocks can be found at: 
+  // https://www.thonky.com/qr-code-tutorial/error-correction-table
+  // They are defined here so compile time codes (qr_static.h) can use them.
+
+  // Error correction codewords per block
+  static constexpr std::int8_t kEC_codewords_per_block_[4][41] = {
+    // Version: (index[0] is a placeholder)
+    //    1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40  Error Correction
+    {-1,  7, 10, 15, 20, 26, 18, 20, 24, 30, 18, 20, 24, 26, 30, 22, 24, 28, 30, 28, 28, 28, 28, 30, 30, 26, 28, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}, // Low
+    {-1, 10, 16, 26, 18, 24, 16, 18, 22, 22, 26, 30, 22, 22, 24, 24, 28, 28, 26, 26, 26, 26, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28, 28}, // Medium
+    {-1, 13, 22, 18, 26, 18, 24, 18, 22, 20, 24, 28, 26, 24, 20, 30, 24, 28, 28, 26, 30, 28, 30, 30, 30, 30, 28, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}, // Quartile
+    {-1, 17, 28, 22, 16, 22, 28, 26, 26, 24, 28, 24, 28, 22, 24, 24, 30, 28, 28, 26, 28, 30, 24, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30, 30}, // High
+  };
+
+  // Number of error correction blocks
+  static constexpr std::int8_t kErr_corr_blocks_[4][41] = {
+    // Version: (index[0] is a placeholder)
+    //   1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40  Error Correction
+    {-1, 1, 1, 1, 1, 1, 2, 2, 2, 2,  4,  4,  4,  4,  4,  6,  6,  6,  6,  7,  8,  8,  9,  9, 10, 12, 12, 12, 13, 14, 15, 16, 17, 18, 19, 19, 20, 21, 22, 24, 25}, // Low
+    {-1, 1, 1, 1, 2, 2, 4, 4, 4, 5,  5,  5,  8,  9,  9, 10, 10, 11, 13, 14, 16, 17, 17, 18, 20, 21, 23, 25, 26, 28, 29, 31, 33, 35, 37, 38, 40, 43, 45, 47, 49}, // Medium
+    {-1, 1, 1, 2, 2, 4, 4, 6, 6, 8,  8,  8, 10, 12, 16, 12, 17, 16, 18, 21, 20, 23, 23, 25, 27, 29, 34, 34, 35, 38, 40, 43, 45, 48, 51, 53, 56, 59, 62, 65, 68}, // Quartile
+    {-1, 1, 1, 2, 4, 4, 4, 5, 6, 8,  8, 11, 11, 16, 16, 18, 16, 19, 21, 25, 25, 25, 34, 30, 32, 35, 37, 40, 42, 45, 48, 51, 54, 57, 60, 63, 66, 70, 74, 77, 81}, // High
+  };
 }; // QRCode
 
+// Returns total modules for the QRCode based on version.
+constexpr int QRCode::getTotalModules(int version) {
+  if (version == 1) {
+    return 21 * 21 - 3 * 8 * 8 - 2 * 15 - 1 - 2 * 5;
+  }
+  
+  int alignBlocks = (version / 7) + 2;
+  int size = version * 4 + 17;
+
+  return size * size - 3 * 8 * 8 
+         - (alignBlocks * alignBlocks - 3) * 5 * 5 - 2 * (version * 4 + 1) 
+         + (alignBlocks - 2) * 5 * 2 - 2 * 15 - 1 
+         - (version > 6 ? 2 * 3 * 6 : 0);
+}
+
+// Returns total codewords per block depending on version and error 
+// correction level.
+constexpr int QRCode::getTotalCodewords(int version, ErrCor error_level) {
+  return (getTotalModules(version) >> 3) 
+         - (kErr_corr_blocks_[static_cast<int>(error_level)][version] 
+         * kEC_codewords_per_block_[static_cast<int>(error_level)][version]);
+}
+
 #endif // QR_H_
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <stdexcept>
+
+#include "encoder.h"
+#include "qr_atlas.h"
+#include "qr_image.h"
+#include "qr_output.h"
+
+// Bytes in a cache line, rows of pixels start on one.
+static const std::size_t kCacheLine = 64;
+
+// Bytes of the packed rows of a version 40 code.
+static const std::size_t kMaxBlockBytes = 177 * 23;
+
+// Bytes of the raw rows written at a time.
+static const std::size_t kRawBatch = 1 << 20;
+
+QRAtlas::QRAtlas(std::span<const std::string_view> payloads,
+                 const AtlasLayout& layout, ThreadPool* pool)
+    : layout_(layout), pool_(pool), rows_(0), tile_size_(0), tile_pitch_(0),
+      width_(0), height_(0), stride_(0), pixels_(nullptr) {
+  if (payloads.empty()) {
+    throw std::logic_error("No payloads.");
+  }
+  if (layout.columns < 1) {
+    throw std::logic_error("Invalid number of columns.");
+  }
+  if (layout.max_version < 1 || layout.max_version > 40) {
+    throw std::logic_error("Invalid version.");
+  }
+  if (layout.mask < QRCode::kAutoMask || layout.mask > 7) {
+    throw std::logic_error("Invalid mask.");
+  }
+  if (layout.err < QRCode::ErrCor::kLow || layout.err > QRCode::ErrCor::kHigh) {
+    throw std::logic_error("Invalid ECL");
+  }
+  if (pool_ == nullptr) {
+    pool_ = &ThreadPool::getDefault();
+  }
+
+  // A smaller code gets a wider quiet zone, so every tile is the same size.
+  // Versions are 4 blocks apart, the extra blocks split evenly.
+  upscalers_.reserve(layout.max_version);
+  for (int version = 1; version <= layout.max_version; ++version) {
+    upscalers_.emplace_back(layout.scale,
+                            layout.quiet_zone
+                            + 2 * (layout.max_version - version),
+                            layout.invert);
+  }
+  tile_size_ = (4 * layout.max_version + 17 + 2 * layout.quiet_zone)
+               * layout.scale;
+  tile_pitch_ = (tile_size_ + 7) / 8 * 8;
+  rows_ = static_cast<int>((payloads.size() + layout.columns - 1)
+                           / layout.columns);
+  width_ = (layout.columns - 1) * tile_pitch_ + tile_size_;
+  height_ = rows_ * tile_size_;
+  stride_ = ((static_cast<std::size_t>(width_) + 7) / 8 + kCacheLine - 1)
+            / kCacheLine * kCacheLine;
+
+  // The pixels are not cleared here, each row of tiles is filled by the
+  // thread that draws it.
+  const std::size_t length = stride_ * height_;
+  storage_ = std::make_unique_for_overwrite<std::uint8_t[]>(length
+                                                            + kCacheLine - 1);
+  const std::uintptr_t address =
+      reinterpret_cast<std::uintptr_t>(storage_.get());
+  pixels_ = storage_.get() + (kCacheLine - address % kCacheLine) % kCacheLine;
+
+  std::vector<std::future<void> > pending;
+  pending.reserve(rows_);
+  for (int row = 0; row < rows_; ++row) {
+    pending.push_back(pool_->submit([this, payloads, row]() {
+      drawRow(payloads, row);
+    }));
+  }
+
+  // Every row is waited for before an error is passed on, the tasks use the
+  // atlas and the payloads.
+  std::exception_ptr error;
+  for (auto& row : pending) {
+    try {
+      row.get();
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// The codes are written into a buffer on the stack and drawn from there, so
+// nothing is allocated for each code.
+void QRAtlas::drawRow(std::span<const std::string_view> payloads, int row) {
+  const std::size_t band = static_cast<std::size_t>(tile_size_) * stride_;
+  std::uint8_t* first = pixels_ + row * band;
+  std::memset(first, layout_.invert ? 0x00 : 0xFF, band);
+
+  EncodeOptions options;
+  options.err = layout_.err;
+  options.mask = layout_.mask;
+  options.max_version = layout_.max_version;
+  std::uint8_t blocks[kMaxBlockBytes];
+  const std::size_t end = stride_ * height_;
+  for (int column = 0; column < layout_.columns; ++column) {
+    const std::size_t index =
+        static_cast<std::size_t>(row) * layout_.columns + column;
+    if (index >= payloads.size()) {
+      break;
+    }
+    EncodeResult result = Encoder::encodeInto(payloads[index], options,
+                                              blocks);
+    if (!result) {
+      throw std::logic_error("String too long!");
+    }
+    QRImage image(std::span<const std::uint8_t>(
+                      blocks, static_cast<std::size_t>(result.stride)
+                              * result.size),
+                  result.size, result.size);
+    const std::size_t offset = row * band + column * (tile_pitch_ / 8);
+    upscalers_[result.version - 1].draw(
+        image, Upscaler::Format::k1Bit,
+        std::span<std::uint8_t>(pixels_ + offset, end - offset), stride_);
+  }
+}
+
+std::vector<std::uint8_t> QRAtlas::encodePng(
+    PngWriter::Compression compression) const {
+  return PngWriter::encodeRows(getData(), width_, height_, stride_,
+                               compression, pool_);
+}
+
+void QRAtlas::writePng(int fd, PngWriter::Compression compression) const {
+  QROutput::writeAll(fd, encodePng(compression));
+}
+
+// Rows are gathered into batches so large images take few writes.
+void QRAtlas::writeRaw(int fd) const {
+  const std::size_t bytes = (static_cast<std::size_t>(width_) + 7) / 8;
+  const int batch = static_cast<int>(std::max<std::size_t>(1,
+                                                           kRawBatch / bytes));
+  std::vector<std::uint8_t> rows;
+  rows.reserve(batch * bytes);
+  for (int y = 0; y < height_; y += batch) {
+    rows.clear();
+    for (int i = y; i < std::min(height_, y + batch); ++i) {
+      rows.insert(rows.end(), pixels_ + i * stride_,
+                  pixels_ + i * stride_ + bytes);
+    }
+    QROutput::writeAll(fd, rows);
+  }
+}
@@ -0,0 +1,90 @@
+#ifndef QR_ATLAS_H_
+#define QR_ATLAS_H_
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "qr.h"
+#include "qr_png.h"
+#include "qr_upscale.h"
+#include "thread_pool.h"
+
+// Grid of an atlas and the codes in it.
+struct AtlasLayout {
+  int columns = 10;                          // Tiles in each row of the grid
+  int max_version = 10;                      // Largest version, sets the tiles
+  int scale = 4;                             // Pixels in the width of a block
+  int quiet_zone = 4;                        // Light blocks around each code
+  QRCode::ErrCor err = QRCode::ErrCor::kLow; // Lowest error correction level
+  int mask = 0;                              // Mask, or QRCode::kAutoMask
+  bool invert = false;                       // Dark blocks are white
+}; // AtlasLayout
+
+// One 1 bit image of many QR codes in a grid, such as a sheet of labels. The
+// tiles are all sized for 'max_version', smaller codes are centered in
+// theirs. Each row of tiles is made and drawn on the pool at the same time
+// as the others, straight into the image, which is allocated once. Every
+// row of pixels starts on a cache line, so no two threads write to the same
+// line.
+class QRAtlas {
+ public:
+  // Makes a code for each payload, left to right and then top to bottom.
+  // Throws if a payload does not fit in 'max_version'.
+  explicit QRAtlas(std::span<const std::string_view>,
+                   const AtlasLayout& layout = AtlasLayout(),
+                   ThreadPool* pool = nullptr);
+
+  int getColumns() const { return layout_.columns; }
+  int getRows() const { return rows_; }
+
+  // Size of a tile and of the image in pixels. Tiles start every
+  // getTilePitch() pixels across, a whole number of bytes.
+  int getTileSize() const { return tile_size_; }
+  int getTilePitch() const { return tile_pitch_; }
+  int getWidth() const { return width_; }
+  int getHeight() const { return height_; }
+
+  // Bytes between rows, a multiple of 64, and the rows. Light pixels are 1,
+  // as in PNG, unless inverted.
+  std::size_t getStride() const { return stride_; }
+  std::span<const std::uint8_t> getRow(int y) const {
+    return std::span<const std::uint8_t>(pixels_ + y * stride_,
+                                         (width_ + 7) / 8);
+  }
+  std::span<const std::uint8_t> getData() const {
+    return std::span<const std::uint8_t>(pixels_, stride_ * height_);
+  }
+  bool getPixel(int x, int y) const {
+    return ((pixels_[y * stride_ + (x >> 3)] >> (7 - (x & 7))) & 1) != 0;
+  }
+
+  // Returns the image as a PNG, stripes of rows compressed on the pool.
+  std::vector<std::uint8_t> encodePng(
+      PngWriter::Compression compression = PngWriter::Compression::kRle) const;
+  void writePng(int, PngWriter::Compression compression =
+                         PngWriter::Compression::kRle) const;
+
+  // Writes the rows without the padding, (getWidth() + 7) / 8 bytes each,
+  // the layout of QRBitmap.
+  void writeRaw(int) const;
+
+ private:
+  void drawRow(std::span<const std::string_view>, int);
+
+  AtlasLayout layout_;                      // Grid and codes
+  ThreadPool* pool_;                        // Pool for drawing and PNGs
+  int rows_;                                // Rows of tiles
+  int tile_size_;                           // Pixels across a tile
+  int tile_pitch_;                          // Pixels from tile to tile
+  int width_;                               // Pixels across the image
+  int height_;                              // Pixels down the image
+  std::size_t stride_;                      // Bytes between rows
+  std::vector<Upscaler> upscalers_;         // Upscaler for each version
+  std::unique_ptr<std::uint8_t[]> storage_; // Image and alignment padding
+  std::uint8_t* pixels_;                    // Aligned start of the image
+}; // QRAtlas
+
+#endif // QR_ATLAS_H_
@@ -0,0 +1,513 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fcntl.h>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "encoder.h"
+#include "qr_batch.h"
+#include "qr_image.h"
+#include "qr_output.h"
+
+// Bytes read at a time. Each read that ends a payload makes a group of the
+// payloads it finishes.
+static const std::size_t kReadLength = 1 << 16;
+
+// Bytes of a mapped file in each chunk. A chunk is made of the payloads
+// that start in it.
+static const std::size_t kChunkLength = 1 << 14;
+
+// Bytes of the packed rows of a version 40 code.
+static const std::size_t kMaxBlockBytes = 177 * 23;
+
+// Payloads and the codes made for them by one task.
+struct BatchRunner::Group {
+  std::uint64_t first = 0;         // Line number of the first payload
+  std::string text;                // Payloads read from a pipe
+  std::string output;              // Codes, unless they go to a directory
+  std::string errors;              // Messages for payloads that failed
+  std::uint64_t codes = 0;         // Codes made
+  std::uint64_t failed = 0;        // Payloads that failed
+  std::uint64_t bytes_written = 0; // Bytes of the codes
+}; // Group
+
+// Returns the first delimiter in the text, or 'last'.
+static const char* findDelimiter(const char* first, const char* last,
+                                 char delimiter) {
+  const void* found = std::memchr(first, delimiter, last - first);
+  return found == nullptr ? last : static_cast<const char*>(found);
+}
+
+// Number of delimiters in the text. Matches are added up 16 bytes at a
+// time in a byte for each lane, and the lanes summed every 255 steps before
+// they can overflow.
+static std::uint64_t countDelimiters(const char* first, const char* last,
+                                     char delimiter) {
+  std::uint64_t count = 0;
+#if defined(__SSE2__)
+  const __m128i wanted = _mm_set1_epi8(delimiter);
+  while (last - first >= 16) {
+    const std::ptrdiff_t steps = std::min<std::ptrdiff_t>((last - first) / 16,
+                                                          255);
+    __m128i lanes = _mm_setzero_si128();
+    for (std::ptrdiff_t i = 0; i < steps; ++i, first += 16) {
+      lanes = _mm_sub_epi8(lanes, _mm_cmpeq_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(first)), wanted));
+    }
+    const __m128i sums = _mm_sad_epu8(lanes, _mm_setzero_si128());
+    count += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+  }
+#endif
+  return count + std::count(first, last, delimiter);
+}
+
+// A file mapped for reading, unmapped when it goes out of scope.
+class MappedFile {
+ public:
+  MappedFile(int fd, std::size_t length)
+      : data_(::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0)),
+        length_(length) {
+    if (data_ == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    ::madvise(data_, length, MADV_SEQUENTIAL);
+  }
+  ~MappedFile() { ::munmap(data_, length_); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  std::string_view getText() const {
+    return std::string_view(static_cast<const char*>(data_), length_);
+  }
+
+ private:
+  void* data_;         // Start of the mapping
+  std::size_t length_; // Bytes mapped
+}; // MappedFile
+
+static void appendNumber(std::string& out, std::uint64_t value, int width) {
+  std::string digits = std::to_string(value);
+  if (static_cast<int>(digits.size()) < width) {
+    out.append(width - digits.size(), '0');
+  }
+  out += digits;
+}
+
+BatchRunner::BatchRunner(const BatchOptions& options)
+    : options_(options), pool_(options.threads),
+      terminal_(options.quiet_zone),
+      svg_(options.scale, options.quiet_zone),
+      png_(options.scale, options.quiet_zone),
+      tiff_(options.scale, options.quiet_zone),
+      zpl_(options.scale, options.quiet_zone) {
+  if (options.threads < 0) {
+    throw std::logic_error("Invalid number of threads.");
+  }
+  if (options.mask < QRCode::kAutoMask || options.mask > 7) {
+    throw std::logic_error("Invalid mask.");
+  }
+  if (options.tolerance < 0) {
+    throw std::logic_error("Invalid tolerance.");
+  }
+  if (options.format < BatchFormat::kNone
+      || options.format > BatchFormat::kZpl) {
+    throw std::logic_error("Invalid format.");
+  }
+  // Images written one after another to a stream could not be split.
+  if ((options.format == BatchFormat::kPng
+       || options.format == BatchFormat::kTiff)
+      && options.directory.empty()) {
+    throw std::logic_error("PNG and TIFF codes need a directory.");
+  }
+}
+
+std::string_view BatchRunner::getExtension(BatchFormat format) {
+  switch (format) {
+    case BatchFormat::kTerminal: return ".txt";
+    case BatchFormat::kSvg:      return ".svg";
+    case BatchFormat::kPng:      return ".png";
+    case BatchFormat::kTiff:     return ".tif";
+    case BatchFormat::kZpl:      return ".zpl";
+    default:                     return "";
+  }
+}
+
+BatchSummary BatchRunner::run(int in, int out) {
+  struct stat status;
+  if (::fstat(in, &status) == 0 && S_ISREG(status.st_mode)
+      && status.st_size > 0) {
+    MappedFile file(in, static_cast<std::size_t>(status.st_size));
+    return runMapped(file.getText(), out);
+  }
+  return runStream(in, out);
+}
+
+// Writes a group that is done and adds it to the summary.
+void BatchRunner::finishGroup(Group& group, int out,
+                              BatchSummary& summary) const {
+  if (!group.output.empty()) {
+    QROutput::writeAll(out, group.output);
+  }
+  if (!group.errors.empty()) {
+    QROutput::writeAll(2, group.errors);
+  }
+  summary.codes += group.codes;
+  summary.failed += group.failed;
+  summary.bytes_written += group.bytes_written;
+}
+
+// Each worker claims the next chunk, counts its payloads so the chunk after
+// it knows its first line number, and makes its codes straight from the
+// mapping. The calling thread writes the chunks in order as they are done.
+// Workers stay at most a few chunks ahead of the writing, which keeps the
+// output that is waiting small.
+BatchSummary BatchRunner::runMapped(std::string_view text, int out) {
+  const auto start = std::chrono::steady_clock::now();
+  const char delimiter = options_.delimiter;
+  const std::size_t count = (text.size() + kChunkLength - 1) / kChunkLength;
+  const int workers = pool_.getNumThreads();
+  const std::size_t ahead = 2 * static_cast<std::size_t>(workers) + 2;
+
+  // A chunk starts after the first delimiter from the byte before its
+  // nominal start, so the payload a boundary falls in belongs to the chunk
+  // it starts in.
+  auto getStart = [&](std::size_t chunk) -> std::size_t {
+    if (chunk == 0) {
+      return 0;
+    }
+    if (chunk >= count) {
+      return text.size();
+    }
+    const char* last = text.data() + text.size();
+    const char* found = findDelimiter(text.data() + chunk * kChunkLength - 1,
+                                      last, delimiter);
+    return found == last ? text.size() : found - text.data() + 1;
+  };
+
+  std::vector<Group> groups(count);
+  std::vector<std::uint64_t> end_lines(count, 0);
+  std::vector<bool> done(count, false);
+  std::size_t next = 0;
+  std::size_t written = 0;
+  std::exception_ptr error;
+  std::mutex mutex;
+  std::condition_variable changed;
+
+  auto work = [&]() {
+    for (;;) {
+      std::size_t chunk;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() {
+          return next >= count || next < written + ahead;
+        });
+        if (next >= count) {
+          return;
+        }
+        chunk = next++;
+      }
+
+      Group& group = groups[chunk];
+      const std::size_t first = getStart(chunk);
+      const std::size_t last = std::max(first, getStart(chunk + 1));
+      const std::uint64_t lines = countDelimiters(text.data() + first,
+                                                  text.data() + last,
+                                                  delimiter);
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() {
+          return chunk == 0 || end_lines[chunk - 1] != 0 || error;
+        });
+        if (error) {
+          return;
+        }
+        group.first = chunk == 0 ? 1 : end_lines[chunk - 1];
+        end_lines[chunk] = group.first + lines;
+      }
+      changed.notify_all();
+
+      try {
+        makeGroup(text.substr(first, last - first), group);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = count;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        done[chunk] = true;
+      }
+      changed.notify_all();
+    }
+  };
+
+  std::vector<std::future<void> > tasks;
+  tasks.reserve(workers);
+  for (int i = 0; i < workers; ++i) {
+    tasks.push_back(pool_.submit(work));
+  }
+
+  BatchSummary summary;
+  summary.bytes_read = text.size();
+  try {
+    for (std::size_t chunk = 0; chunk < count; ++chunk) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return done[chunk] || error; });
+        if (error) {
+          break;
+        }
+      }
+      finishGroup(groups[chunk], out, summary);
+      groups[chunk] = Group();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        written = chunk + 1;
+      }
+      changed.notify_all();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error) {
+      error = std::current_exception();
+    }
+    next = count;
+  }
+
+  // The workers use the groups and the mapping, so every one is waited for
+  // before an error is passed on.
+  changed.notify_all();
+  for (auto& task : tasks) {
+    task.wait();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  summary.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return summary;
+}
+
+// Groups are read while earlier ones are made, up to a few for each worker,
+// and the oldest is written as soon as it is done so the output stays in
+// order.
+BatchSummary BatchRunner::runStream(int in, int out) {
+  const auto start = std::chrono::steady_clock::now();
+  const std::size_t most_pending =
+      2 * static_cast<std::size_t>(pool_.getNumThreads()) + 2;
+  BatchSummary summary;
+  std::deque<std::pair<std::unique_ptr<Group>, std::future<void> > > pending;
+
+  auto finishOldest = [&]() {
+    std::unique_ptr<Group> group = std::move(pending.front().first);
+    std::future<void> done = std::move(pending.front().second);
+    pending.pop_front();
+    done.get();
+    finishGroup(*group, out, summary);
+  };
+
+  auto submit = [&](std::string text, std::uint64_t first) {
+    auto group = std::make_unique<Group>();
+    group->first = first;
+    group->text = std::move(text);
+    Group* task = group.get();
+    pending.emplace_back(std::move(group), pool_.submit([this, task]() {
+      makeGroup(task->text, *task);
+    }));
+  };
+
+  // Every task is waited for before an error is passed on, the tasks use the
+  // groups and the runner.
+  try {
+    std::string buffer;
+    std::uint64_t line = 1;
+    bool done = false;
+    while (!done) {
+      const std::size_t length = buffer.size();
+      buffer.resize(length + kReadLength);
+      const ssize_t count = ::read(in, buffer.data() + length, kReadLength);
+      if (count < 0) {
+        buffer.resize(length);
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category(), "read");
+      }
+      buffer.resize(length + count);
+      summary.bytes_read += count;
+      done = count == 0;
+
+      // The last payload may not end in a delimiter.
+      const std::size_t end = done ? buffer.size()
+                                   : buffer.rfind(options_.delimiter) + 1;
+      if (end == 0) {
+        continue;
+      }
+      std::string text = buffer.substr(0, end);
+      buffer.erase(0, end);
+      const std::uint64_t first = line;
+      line += countDelimiters(text.data(), text.data() + text.size(),
+                              options_.delimiter);
+      while (pending.size() >= most_pending) {
+        finishOldest();
+      }
+      submit(std::move(text), first);
+    }
+    while (!pending.empty()) {
+      finishOldest();
+    }
+  } catch (...) {
+    for (auto& group : pending) {
+      group.second.wait();
+    }
+    throw;
+  }
+
+  summary.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  return summary;
+}
+
+// Codes are made with Encoder::encodeInto() into a buffer on the stack,
+// straight from the text, unless the mask is chosen for another objective,
+// which needs a QRCode.
+void BatchRunner::makeGroup(std::string_view text, Group& group) const {
+  EncodeOptions encode;
+  encode.err = options_.err;
+  encode.mask = options_.mask;
+  std::uint8_t blocks[kMaxBlockBytes];
+  std::string code;
+  std::string path;
+
+  std::uint64_t line = group.first - 1;
+  const char* last = text.data() + text.size();
+  for (const char* next = text.data(); next < last;) {
+    const char* end = findDelimiter(next, last, options_.delimiter);
+    std::string_view payload(next, end - next);
+    next = end + 1;
+    ++line;
+    if (options_.delimiter == '\n' && !payload.empty()
+        && payload.back() == '\r') {
+      payload.remove_suffix(1);
+    }
+
+    int size = 0;
+    if (options_.objective == QRCode::MaskObjective::kPenalty) {
+      EncodeResult result = Encoder::encodeInto(payload, encode, blocks);
+      size = result.size;
+      if (!result) {
+        group.errors += "line ";
+        appendNumber(group.errors, line, 0);
+        group.errors += ": String too long!\n";
+        ++group.failed;
+        continue;
+      }
+    } else {
+      try {
+        QRCode qr(std::string(payload), options_.err, 0);
+        qr.remask(options_.objective, options_.tolerance);
+        size = qr.getSize();
+        const int stride = (size + 7) / 8;
+        std::fill(blocks, blocks + stride * size, 0);
+        for (int y = 0; y < size; ++y) {
+          for (int x = 0; x < size; ++x) {
+            if (qr.getBlock(x, y)) {
+              blocks[y * stride + x / 8] |= 0x80 >> (x % 8);
+            }
+          }
+        }
+      } catch (const std::logic_error& error) {
+        group.errors += "line ";
+        appendNumber(group.errors, line, 0);
+        group.errors += ": ";
+        group.errors += error.what();
+        group.errors += '\n';
+        ++group.failed;
+        continue;
+      }
+    }
+    ++group.codes;
+    if (options_.format == BatchFormat::kNone) {
+      continue;
+    }
+
+    const QRImage image(std::span<const std::uint8_t>(
+                            blocks, static_cast<std::size_t>((size + 7) / 8)
+                                    * size),
+                        size, size);
+    render(image, code);
+    group.bytes_written += code.size();
+    if (options_.directory.empty()) {
+      group.output += code;
+      continue;
+    }
+
+    path = options_.directory;
+    path += '/';
+    appendNumber(path, line, 8);
+    path += getExtension(options_.format);
+    const int fd = ::open(path.c_str(),
+                          O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    try {
+      QROutput::writeAll(fd, code);
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+    ::close(fd);
+  }
+}
+
+// Replaces the contents of 'out' with the code in the format of the batch.
+void BatchRunner::render(const QRImage& image, std::string& out) const {
+  switch (options_.format) {
+    case BatchFormat::kTerminal:
+      out = terminal_.render(image);
+      break;
+    case BatchFormat::kSvg:
+      svg_.render(image, out);
+      break;
+    case BatchFormat::kPng: {
+      out.resize(png_.getMaxLength(image));
+      out.resize(png_.write(image, std::span<std::uint8_t>(
+                                       reinterpret_cast<std::uint8_t*>(
+                                           out.data()), out.size())));
+      break;
+    }
+    case BatchFormat::kTiff: {
+      std::vector<std::uint8_t> tiff;
+      tiff_.encode(image, tiff);
+      out.assign(tiff.begin(), tiff.end());
+      break;
+    }
+    case BatchFormat::kZpl:
+      zpl_.render(image, out);
+      break;
+    default:
+      out.clear();
+      break;
+  }
+}
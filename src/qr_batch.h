@@ -0,0 +1,91 @@
+#ifndef QR_BATCH_H_
+#define QR_BATCH_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "qr.h"
+#include "qr_png.h"
+#include "qr_svg.h"
+#include "qr_terminal.h"
+#include "qr_tiff.h"
+#include "qr_zpl.h"
+#include "thread_pool.h"
+
+// What is written for each code of a batch.
+enum class BatchFormat {
+  kNone = 0, // Nothing, the codes are only made
+  kTerminal, // Half block characters, as TerminalRenderer draws them
+  kSvg,
+  kPng,
+  kTiff,
+  kZpl,
+}; // BatchFormat
+
+// How a batch is read, made and written.
+struct BatchOptions {
+  char delimiter = '\n';                     // Ends each payload
+  QRCode::ErrCor err = QRCode::ErrCor::kLow; // Lowest error correction level
+  int mask = QRCode::kAutoMask;              // Mask, or QRCode::kAutoMask
+  QRCode::MaskObjective objective =          // Chooses the mask with remask()
+      QRCode::MaskObjective::kPenalty;       // unless kPenalty
+  int tolerance = 10;                        // Penalty tolerance, percent
+  BatchFormat format = BatchFormat::kTerminal;
+  int scale = 4;                             // Pixels in the width of a block
+  int quiet_zone = 4;                        // Light blocks around each code
+  std::string directory;                     // A file for each code if set,
+                                             // needed for PNG and TIFF
+  int threads = 0;                           // Workers, 0 for each CPU
+}; // BatchOptions
+
+// Counts of a finished batch.
+struct BatchSummary {
+  std::uint64_t codes = 0;         // Codes made
+  std::uint64_t failed = 0;        // Payloads that did not fit in a code
+  std::uint64_t bytes_read = 0;    // Bytes of payloads and delimiters
+  std::uint64_t bytes_written = 0; // Bytes of output
+  double seconds = 0;              // From the first read to the last write
+}; // BatchSummary
+
+// Makes a code for each payload of a stream, such as one per line, on a
+// pool of workers. A file is mapped, and each worker claims the next chunk
+// of the mapping when it is free, so the payloads are read in place and
+// slow chunks do not hold up the others. A pipe is read in groups instead,
+// each made by one task while later groups are read. The output is written
+// in the order of the input, either one stream of every code or a file for
+// each code in a directory, named by its line number. Payloads that do not
+// fit are reported on stderr and skipped.
+class BatchRunner {
+ public:
+  explicit BatchRunner(const BatchOptions& options = BatchOptions());
+
+  BatchRunner(const BatchRunner&) = delete;
+  BatchRunner& operator=(const BatchRunner&) = delete;
+
+  // Reads payloads from 'in' until the end, and writes the codes to 'out'
+  // unless they go to a directory. 'in' is mapped if it is a file.
+  BatchSummary run(int in, int out);
+
+  // Extension of the files of a format, such as ".png".
+  static std::string_view getExtension(BatchFormat);
+
+ private:
+  struct Group;
+
+  BatchSummary runMapped(std::string_view, int);
+  BatchSummary runStream(int, int);
+  void makeGroup(std::string_view, Group&) const;
+  void finishGroup(Group&, int, BatchSummary&) const;
+  void render(const QRImage&, std::string&) const;
+
+  BatchOptions options_;      // How the batch is made
+  ThreadPool pool_;           // Workers
+  TerminalRenderer terminal_; // Writers for each format
+  SvgWriter svg_;
+  PngWriter png_;
+  TiffWriter tiff_;
+  ZplWriter zpl_;
+}; // BatchRunner
+
+#endif // QR_BATCH_H_
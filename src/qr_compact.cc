@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <stdexcept>
+
+#include "qr_compact.h"
+#include "qr_static.h"
+
+// Everything about a version that does not depend on the codewords. Offsets
+// are bit positions in the packed rows, y * stride * 8 + x, which fit in 16
+// bits for every version.
+struct CompactQRCode::Layout {
+  int size;                                       // Height and width
+  int stride;                                     // Bytes per row
+  std::vector<std::uint8_t> function;             // Function blocks
+  std::array<std::vector<std::uint8_t>, 8> masks; // Blocks each mask swaps
+  std::vector<std::uint16_t> placement;           // Block of each data bit
+  std::array<std::array<std::uint16_t, 15>, 2> format; // Format bits
+}; // Layout
+
+CompactQRCode::CompactQRCode(const QRCode& code) :
+    version_(static_cast<std::uint8_t>(code.version_)),
+    mask_(static_cast<std::uint8_t>(code.mask_)),
+    correctionLevel_(code.correctionLevel_),
+    codewords_(code.data_.cbegin(), code.data_.cend()) {
+  if (code.symbol_ != QRCode::SymbolType::kQR) {
+    throw std::logic_error("Only QR codes can be made compact.");
+  }
+}
+
+CompactQRCode::CompactQRCode(int version, QRCode::ErrCor err, int msk,
+                             std::span<const std::uint8_t> codewords) :
+    version_(static_cast<std::uint8_t>(version)),
+    mask_(static_cast<std::uint8_t>(msk)), correctionLevel_(err),
+    codewords_(codewords.begin(), codewords.end()) {
+  if (version < 1 || version > 40) {
+    throw std::logic_error("Invalid version.");
+  }
+  if (msk < 0 || msk > 7) {
+    throw std::logic_error("Invalid mask.");
+  }
+  if (err < QRCode::ErrCor::kLow || err > QRCode::ErrCor::kHigh) {
+    throw std::logic_error("Invalid ECL");
+  }
+  if (codewords.size()
+      != static_cast<std::size_t>(QRCode::getTotalModules(version) >> 3)) {
+    throw std::logic_error("Invalid number of codewords.");
+  }
+}
+
+// The blocks start as the data bits, then the mask is XORed and the function
+// blocks ORed in. Data bits are never on function blocks, and the format
+// blocks are left clear in the template.
+void CompactQRCode::draw(std::span<std::uint8_t> rows) const {
+  const Layout& layout = getLayout(version_);
+  const std::size_t length =
+      static_cast<std::size_t>(layout.stride * layout.size);
+  if (rows.size() < length) {
+    throw std::logic_error("Buffer too small.");
+  }
+
+  std::fill(rows.begin(), rows.begin() + length, 0);
+  const std::uint16_t* place = layout.placement.data();
+  for (std::uint8_t codeword : codewords_) {
+    for (int i = 7; i >= 0; --i, ++place) {
+      if ((codeword >> i) & 1) {
+        rows[*place >> 3] |= 0x80 >> (*place & 7);
+      }
+    }
+  }
+
+  const std::vector<std::uint8_t>& mask = layout.masks[mask_];
+  for (std::size_t i = 0; i < length; ++i) {
+    rows[i] = (rows[i] ^ mask[i]) | layout.function[i];
+  }
+
+  const int bits = StaticQRCode::formatCode(correctionLevel_, mask_);
+  for (int i = 0; i < 15; ++i) {
+    if ((bits >> i) & 1) {
+      for (const auto& copy : layout.format) {
+        rows[copy[i] >> 3] |= 0x80 >> (copy[i] & 7);
+      }
+    }
+  }
+}
+
+QRBitmap CompactQRCode::toBitmap() const {
+  QRBitmap bitmap;
+  bitmap.version_ = version_;
+  bitmap.size_ = getSize();
+  bitmap.mask_ = mask_;
+  bitmap.correctionLevel_ = correctionLevel_;
+  bitmap.rows_.resize(static_cast<std::size_t>(getStride() * getSize()));
+  draw(bitmap.rows_);
+  return bitmap;
+}
+
+// Layouts are made from the function blocks of a QRCode the first time a
+// version is drawn.
+const CompactQRCode::Layout& CompactQRCode::getLayout(int version) {
+  static std::array<Layout, 41> layouts;
+  static std::array<std::once_flag, 41> made;
+
+  std::call_once(made[version], [version]() {
+    Layout& layout = layouts[version];
+    const QRCode code(version);
+    const int size = code.size_;
+    const int stride = (size + 7) / 8;
+    auto offset = [stride](int x, int y) {
+      return static_cast<std::uint16_t>(y * stride * 8 + x);
+    };
+    layout.size = size;
+    layout.stride = stride;
+
+    // Positions of the format bits, StaticQRCode::drawFormat() sets the
+    // bits of each copy in order before the single dark block.
+    int format_bit = 0;
+    StaticQRCode::drawFormat(size, QRCode::ErrCor::kLow, 0,
+                             [&](int x, int y, bool) {
+      if (format_bit < 30) {
+        layout.format[format_bit / 15][format_bit % 15] = offset(x, y);
+        ++format_bit;
+      }
+    });
+
+    const std::size_t length = static_cast<std::size_t>(stride * size);
+    layout.function.assign(length, 0);
+    for (auto& mask : layout.masks) {
+      mask.assign(length, 0);
+    }
+    for (int y = 0; y < size; ++y) {
+      for (int x = 0; x < size; ++x) {
+        std::uint16_t bit = offset(x, y);
+        std::uint8_t value = static_cast<std::uint8_t>(0x80 >> (bit & 7));
+        if (code.funcBlock_[y][x]) {
+          if (code.blocks_[y][x]) {
+            layout.function[bit >> 3] |= value;
+          }
+          continue;
+        }
+        for (int m = 0; m < 8; ++m) {
+          if (StaticQRCode::maskBit(m, x, y)) {
+            layout.masks[m][bit >> 3] |= value;
+          }
+        }
+      }
+    }
+    for (const auto& copy : layout.format) {
+      for (std::uint16_t bit : copy) {
+        layout.function[bit >> 3] &=
+            static_cast<std::uint8_t>(~(0x80 >> (bit & 7)));
+      }
+    }
+
+    // The zig-zag order codewords are drawn in.
+    const int data_bits = QRCode::getTotalModules(version) & ~7;
+    layout.placement.reserve(static_cast<std::size_t>(data_bits));
+    StaticQRCode::forEachDataBlock(size, size - 1, true,
+                                   [&code](int x, int y) {
+      return code.funcBlock_[y][x];
+    }, [&](int x, int y) {
+      if (static_cast<int>(layout.placement.size()) < data_bits) {
+        layout.placement.push_back(offset(x, y));
+      }
+    });
+  });
+  return layouts[version];
+}
@@ -0,0 +1,48 @@
+#ifndef QR_COMPACT_H_
+#define QR_COMPACT_H_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+
+// A QR code kept as only its version, error correction level, mask and
+// interleaved codewords, at most 3706 bytes instead of the blocks of a
+// QRCode. The blocks are drawn again when they are needed, from templates of
+// the function blocks and tables of where each codeword bit goes. The
+// templates are made once for each version and shared by every code.
+class CompactQRCode {
+ public:
+  // Keeps the codewords of a QR code. Throws for Micro QR and rMQR codes.
+  explicit CompactQRCode(const QRCode&);
+
+  // Codewords kept from before, such as from getCodewords(). Throws if the
+  // version or mask is out of range, or the number of codewords is not the
+  // number in the version.
+  CompactQRCode(int, QRCode::ErrCor, int, std::span<const std::uint8_t>);
+
+  int getVersion() const { return version_; }
+  int getSize() const { return (4 * version_) + 17; }
+  int getMask() const { return mask_; }
+  QRCode::ErrCor getErrCor() const { return correctionLevel_; }
+  int getStride() const { return (getSize() + 7) / 8; }
+  std::span<const std::uint8_t> getCodewords() const { return codewords_; }
+
+  // Draws the blocks into rows packed the same as QRBitmap. Throws if the
+  // buffer is smaller than getStride() * getSize() bytes.
+  void draw(std::span<std::uint8_t>) const;
+  QRBitmap toBitmap() const;
+
+ private:
+  struct Layout;
+  static const Layout& getLayout(int);
+
+  std::uint8_t version_;                // Version number
+  std::uint8_t mask_;                   // Mask pattern used
+  QRCode::ErrCor correctionLevel_;      // Error correction level
+  std::vector<std::uint8_t> codewords_; // Interleaved data and EDC codewords
+}; // CompactQRCode
+
+#endif // QR_COMPACT_H_
@@ -0,0 +1,129 @@
+#include <array>
+
+#include "qr_deflate.h"
+
+// Base and extra bits of the deflate length codes 257 - 285, and of the
+// distance codes.
+static const std::uint16_t kLengthBase[29] = {
+  3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67,
+  83, 99, 115, 131, 163, 195, 227, 258
+};
+static const std::uint8_t kLengthExtra[29] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5,
+  5, 5, 0
+};
+static const std::uint16_t kDistanceBase[30] = {
+  1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+  769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const std::uint8_t kDistanceExtra[30] = {
+  0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11,
+  11, 12, 12, 13, 13
+};
+
+// Fixed Huffman code of each literal and length symbol, bit reversed so it
+// can be written low bit first, and its length.
+struct FixedCode {
+  std::uint16_t bits;
+  std::uint8_t length;
+}; // FixedCode
+
+static constexpr std::uint16_t reverseBits(std::uint32_t code, int length) {
+  std::uint32_t reversed = 0;
+  for (int i = 0; i < length; ++i) {
+    reversed = reversed << 1 | ((code >> i) & 1);
+  }
+  return static_cast<std::uint16_t>(reversed);
+}
+
+static constexpr std::array<FixedCode, 288> makeFixedCodes() {
+  std::array<FixedCode, 288> codes{};
+  for (int symbol = 0; symbol < 288; ++symbol) {
+    int length = symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8;
+    std::uint32_t code = symbol < 144 ? 0x30 + symbol
+                         : symbol < 256 ? 0x190 + symbol - 144
+                         : symbol < 280 ? symbol - 256
+                         : 0xC0 + symbol - 280;
+    codes[symbol] = { reverseBits(code, length),
+                      static_cast<std::uint8_t>(length) };
+  }
+  return codes;
+}
+
+static constexpr std::array<FixedCode, 288> kFixedCodes = makeFixedCodes();
+
+void Deflater::putSymbol(int symbol) {
+  putBits(kFixedCodes[symbol].bits, kFixedCodes[symbol].length);
+}
+
+void Deflater::putMatch(int length, int distance) {
+  int code = 28;
+  while (kLengthBase[code] > length) {
+    --code;
+  }
+  putSymbol(257 + code);
+  putBits(length - kLengthBase[code], kLengthExtra[code]);
+  code = 29;
+  while (kDistanceBase[code] > distance) {
+    --code;
+  }
+  putBits(reverseBits(code, 5), 5);
+  putBits(distance - kDistanceBase[code], kDistanceExtra[code]);
+}
+
+// The rows of an upscaled code repeat 'scale' times, so most rows are one
+// or two copies of the one above. Matches reach back at most 32768 bytes.
+void Deflater::putRow(const std::uint8_t* row, const std::uint8_t* above,
+                      std::size_t length) {
+  if (length > 32768) {
+    above = nullptr;
+  }
+  std::size_t i = 0;
+  while (i < length) {
+    std::size_t limit = std::min<std::size_t>(258, length - i);
+    std::size_t copy = 0;
+    if (above != nullptr) {
+      while (copy < limit && row[i + copy] == above[i + copy]) {
+        ++copy;
+      }
+    }
+    std::size_t run = 0;
+    if (i > 0 || above != nullptr) {
+      std::uint8_t last = i > 0 ? row[i - 1] : above[length - 1];
+      while (run < limit && row[i + run] == last) {
+        ++run;
+      }
+    }
+
+    if (copy >= 3 && copy >= run) {
+      putMatch(static_cast<int>(copy), static_cast<int>(length));
+      i += copy;
+    } else if (run >= 3) {
+      putMatch(static_cast<int>(run), 1);
+      i += run;
+    } else {
+      putSymbol(row[i]);
+      ++i;
+    }
+  }
+}
+
+// The sums are reduced every 5552 bytes, the
+// most that can be added before they overflow.
+std::uint32_t Deflater::adler32(std::uint32_t adler, const std::uint8_t* data,
+                                 std::size_t length) {
+  std::uint32_t a = adler & 0xFFFF;
+  std::uint32_t b = adler >> 16;
+  while (length > 0) {
+    std::size_t chunk = std::min<std::size_t>(length, 5552);
+    length -= chunk;
+    for (std::size_t i = 0; i < chunk; ++i) {
+      a += data[i];
+      b += a;
+    }
+    data += chunk;
+    a %= 65521;
+    b %= 65521;
+  }
+  return b << 16 | a;
+}
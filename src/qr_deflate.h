@@ -0,0 +1,78 @@
+#ifndef QR_DEFLATE_H_
+#define QR_DEFLATE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+// Deflate with the fixed Huffman codes, for the image writers. Each byte of
+// a row is a literal or the start of a match, either a run of the byte
+// before it or a copy of the row above, which finds most of what repeats in
+// an upscaled code. Bits go into the caller's buffer from the low bit of
+// each byte up.
+class Deflater {
+ public:
+  explicit Deflater(std::span<std::uint8_t> out) : out_(out) {}
+
+  std::size_t getPosition() const { return position_; }
+  std::uint8_t* getData(std::size_t position) {
+    return out_.data() + position;
+  }
+
+  void putByte(std::uint8_t value) {
+    if (position_ >= out_.size()) {
+      throw std::logic_error("Buffer too small.");
+    }
+    out_[position_++] = value;
+  }
+  void putBytes(const std::uint8_t* data, std::size_t length) {
+    if (out_.size() - position_ < length) {
+      throw std::logic_error("Buffer too small.");
+    }
+    std::copy(data, data + length, out_.begin() + position_);
+    position_ += length;
+  }
+
+  void putBits(std::uint32_t value, int count) {
+    bits_ |= static_cast<std::uint64_t>(value) << bit_count_;
+    bit_count_ += count;
+    while (bit_count_ >= 8) {
+      putByte(static_cast<std::uint8_t>(bits_));
+      bits_ >>= 8;
+      bit_count_ -= 8;
+    }
+  }
+  void flushBits() {
+    if (bit_count_ > 0) {
+      putBits(0, 8 - bit_count_);
+    }
+  }
+
+  // Literal or length symbol with the fixed Huffman codes, and a match of
+  // 'length' bytes 'distance' bytes back.
+  void putSymbol(int);
+  void putMatch(int length, int distance);
+
+  // Compresses a row of 'length' bytes. 'above' is the row written just
+  // before it, or null.
+  void putRow(const std::uint8_t* row, const std::uint8_t* above,
+              std::size_t length);
+
+  // Most bytes that 'length' bytes of rows take in a fixed Huffman block.
+  static std::size_t getMaxLength(std::size_t length) {
+    return (length * 9 + 17) / 8 + 1;
+  }
+
+  // Adler-32 of the zlib stream, continued from 'adler' (1 to start).
+  static std::uint32_t adler32(std::uint32_t adler, const std::uint8_t*,
+                               std::size_t);
+
+ private:
+  std::span<std::uint8_t> out_; // Buffer for the stream
+  std::size_t position_ = 0;    // Bytes written
+  std::uint64_t bits_ = 0;      // Bits not yet written
+  int bit_count_ = 0;           // Number of bits not yet written
+}; // Deflater
+
+#endif // QR_DEFLATE_H_
@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "qr_gcode.h"
+#include "qr_output.h"
+
+// Blocks across a cell of the grid used to find the nearest rectangle.
+static const int kCellBlocks = 4;
+
+// Millimeters are written with 3 decimals, the trailing zeros
+// taken off.
+static void appendNumber(std::string& out, double value) {
+  char digits[48];
+  char* end = std::to_chars(digits, digits + sizeof digits, value,
+                            std::chars_format::fixed, 3).ptr;
+  while (end[-1] == '0') {
+    --end;
+  }
+  if (end[-1] == '.') {
+    --end;
+  }
+  if (end - digits == 2 && digits[0] == '-' && digits[1] == '0') {
+    out += '0';
+    return;
+  }
+  out.append(digits, end);
+}
+
+// Position of the head in millimeters.
+struct GcodePoint {
+  double x;
+  double y;
+}; // GcodePoint
+
+// Rectangle of dark blocks, in blocks from the top left of the code.
+struct BlockRectangle {
+  int x;
+  int y;
+  int width;
+  int height;
+}; // BlockRectangle
+
+// Writes the moves of a program, leaving out the axes that do not change,
+// and adds up their lengths.
+class GcodeProgram {
+ public:
+  GcodeProgram(std::string& out, const GcodeSettings& settings)
+      : out_(out), settings_(settings), at_{0, 0}, fed_(false) {}
+
+  const GcodePoint& getPosition() const { return at_; }
+  const GcodeEstimate& getEstimate() const { return estimate_; }
+
+  void travel(const GcodePoint& to) {
+    if (to.x == at_.x && to.y == at_.y) {
+      return;
+    }
+    estimate_.travel_length += std::hypot(to.x - at_.x, to.y - at_.y);
+    ++estimate_.travels;
+    out_ += "G0";
+    move(to);
+    out_ += '\n';
+  }
+
+  void cut(const GcodePoint& to) {
+    estimate_.cut_length += std::hypot(to.x - at_.x, to.y - at_.y);
+    out_ += "G1";
+    move(to);
+    if (!fed_) {
+      out_ += " F";
+      appendNumber(out_, settings_.feed_rate);
+      fed_ = true;
+    }
+    out_ += '\n';
+  }
+
+ private:
+  void move(const GcodePoint& to) {
+    if (to.x != at_.x) {
+      out_ += " X";
+      appendNumber(out_, to.x);
+    }
+    if (to.y != at_.y) {
+      out_ += " Y";
+      appendNumber(out_, to.y);
+    }
+    at_ = to;
+  }
+
+  std::string& out_;              // Moves written so far
+  const GcodeSettings& settings_; // Feed rate
+  GcodePoint at_;                 // Position of the head
+  bool fed_;                      // The feed rate has been given
+  GcodeEstimate estimate_;        // Lengths of the moves
+}; // GcodeProgram
+
+// Each scan line starts from the end nearer the head, so the head turns back
+// at the end of a line rather than crossing the code again.
+static void engraveLines(const QRImage& image, const GcodeSettings& settings,
+                         GcodeProgram& program) {
+  const int lines = settings.lines_per_block;
+  const double pitch = settings.block_size / lines;
+  std::vector<std::pair<int, int> > runs;
+  for (int y = 0; y < image.getHeight(); ++y) {
+    runs.clear();
+    image.forEachRun(y, [&runs](int first, int length) {
+      runs.emplace_back(first, first + length);
+    });
+    if (runs.empty()) {
+      continue;
+    }
+    const double left = runs.front().first * settings.block_size;
+    const double right = runs.back().second * settings.block_size;
+    for (int i = 0; i < lines; ++i) {
+      const double line_y = ((image.getHeight() - y) * lines - i - 0.5)
+                            * pitch;
+      const double x = program.getPosition().x;
+      if (std::abs(x - left) <= std::abs(x - right)) {
+        for (auto run : runs) {
+          program.travel({run.first * settings.block_size, line_y});
+          program.cut({run.second * settings.block_size, line_y});
+        }
+      } else {
+        for (auto run = runs.rbegin(); run != runs.rend(); ++run) {
+          program.travel({run->second * settings.block_size, line_y});
+          program.cut({run->first * settings.block_size, line_y});
+        }
+      }
+    }
+  }
+}
+
+// Lines that fill a rectangle, across its shorter side so there are as few
+// as can be. The lines run 'along' between two edges, and sit 'across' from
+// the first line to the last. The lines end half a line inside the edges,
+// as the first and last lines are, so the cut steps from one line to the
+// next do not burn past the rectangle. A single line, with no steps, runs
+// from edge to edge so it is not cut to nothing.
+struct Hatch {
+  bool vertical;    // The lines run up and down
+  int count;        // Number of lines
+  double along[2];  // Ends of the lines
+  double across[2]; // Positions of the first and last lines
+
+  Hatch(const BlockRectangle& rectangle, int rows,
+        const GcodeSettings& settings) {
+    const int lines = settings.lines_per_block;
+    const double pitch = settings.block_size / lines;
+    vertical = rectangle.height > rectangle.width;
+    const double left = rectangle.x * settings.block_size;
+    const double right = (rectangle.x + rectangle.width) * settings.block_size;
+    const double top = (rows - rectangle.y) * settings.block_size;
+    const double bottom = (rows - rectangle.y - rectangle.height)
+                          * settings.block_size;
+    count = (vertical ? rectangle.width : rectangle.height) * lines;
+    const double inset = count > 1 ? pitch / 2 : 0;
+    if (vertical) {
+      along[0] = top - inset;
+      along[1] = bottom + inset;
+      across[0] = left + pitch / 2;
+      across[1] = right - pitch / 2;
+    } else {
+      along[0] = left + inset;
+      along[1] = right - inset;
+      across[0] = top - pitch / 2;
+      across[1] = bottom + pitch / 2;
+    }
+  }
+
+  GcodePoint getPoint(double a, double b) const {
+    return vertical ? GcodePoint{b, a} : GcodePoint{a, b};
+  }
+
+  // Where the lines start from corner 0 - 3, the low bit choosing the edge
+  // and the high bit the line.
+  GcodePoint getCorner(int corner) const {
+    return getPoint(along[corner & 1], across[corner >> 1]);
+  }
+}; // Hatch
+
+// Corners of the rectangles sorted into square cells of the code, so the
+// nearest corner is found by searching the cells around the head, ring by
+// ring, rather than every rectangle left.
+class CornerGrid {
+ public:
+  CornerGrid(const std::vector<Hatch>& hatches, int width, int height,
+             double cell_size)
+      : hatches_(hatches), cell_size_(cell_size),
+        columns_(static_cast<int>(width / cell_size) + 1),
+        rows_(static_cast<int>(height / cell_size) + 1),
+        cells_(static_cast<std::size_t>(columns_) * rows_),
+        done_(hatches.size(), false) {
+    for (std::size_t i = 0; i < hatches.size(); ++i) {
+      for (int corner = 0; corner < 4; ++corner) {
+        cells_[getCell(hatches[i].getCorner(corner))].push_back(
+            static_cast<int>(4 * i + corner));
+      }
+    }
+  }
+
+  // Returns the nearest corner of a rectangle not yet taken, as 4 times the
+  // rectangle plus the corner, and takes the rectangle.
+  int take(const GcodePoint& at) {
+    const int column = std::clamp(static_cast<int>(at.x / cell_size_), 0,
+                                  columns_ - 1);
+    const int row = std::clamp(static_cast<int>(at.y / cell_size_), 0,
+                               rows_ - 1);
+    int best = -1;
+    double best_distance = 0;
+    const int rings = std::max(columns_, rows_);
+    for (int ring = 0; ring < rings; ++ring) {
+      // Corners in this ring are at least ring - 1 cells away.
+      const double near = std::max(0, ring - 1) * cell_size_;
+      if (best >= 0 && best_distance <= near * near) {
+        break;
+      }
+      for (int y = row - ring; y <= row + ring; ++y) {
+        if (y < 0 || y >= rows_) {
+          continue;
+        }
+        const bool edge = y == row - ring || y == row + ring;
+        for (int x = column - ring; x <= column + ring;
+             x += edge || ring == 0 ? 1 : 2 * ring) {
+          if (x >= 0 && x < columns_) {
+            search(cells_[y * columns_ + x], at, best, best_distance);
+          }
+        }
+      }
+    }
+    done_[best / 4] = true;
+    return best;
+  }
+
+ private:
+  std::size_t getCell(const GcodePoint& point) const {
+    const int column = std::clamp(static_cast<int>(point.x / cell_size_), 0,
+                                  columns_ - 1);
+    const int row = std::clamp(static_cast<int>(point.y / cell_size_), 0,
+                               rows_ - 1);
+    return static_cast<std::size_t>(row) * columns_ + column;
+  }
+
+  // Corners of rectangles already taken are dropped as they are found.
+  void search(std::vector<int>& cell, const GcodePoint& at, int& best,
+              double& best_distance) {
+    for (std::size_t i = 0; i < cell.size();) {
+      const int entry = cell[i];
+      if (done_[entry / 4]) {
+        cell[i] = cell.back();
+        cell.pop_back();
+        continue;
+      }
+      const GcodePoint point = hatches_[entry / 4].getCorner(entry % 4);
+      const double dx = point.x - at.x;
+      const double dy = point.y - at.y;
+      const double distance = dx * dx + dy * dy;
+      if (best < 0 || distance < best_distance
+          || (distance == best_distance && entry < best)) {
+        best = entry;
+        best_distance = distance;
+      }
+      ++i;
+    }
+  }
+
+  const std::vector<Hatch>& hatches_;       // Rectangles and their corners
+  double cell_size_;                        // Millimeters across a cell
+  int columns_;                             // Cells across the code
+  int rows_;                                // Cells down the code
+  std::vector<std::vector<int> > cells_;    // Corners in each cell
+  std::vector<bool> done_;                  // Rectangles already taken
+}; // CornerGrid
+
+// The rectangles are taken nearest first, each starting from whichever of
+// its corners is nearest the head. A rectangle is filled back and forth with
+// the laser on, the steps between its lines inside the dark blocks.
+static void engraveRectangles(const QRImage& image,
+                              const GcodeSettings& settings,
+                              GcodeProgram& program) {
+  const double pitch = settings.block_size / settings.lines_per_block;
+  std::vector<Hatch> hatches;
+  image.forEachRectangle([&](int x, int y, int width, int height) {
+    hatches.emplace_back(BlockRectangle{x, y, width, height},
+                         image.getHeight(), settings);
+  });
+  CornerGrid grid(hatches, image.getWidth() * settings.block_size,
+                  image.getHeight() * settings.block_size,
+                  kCellBlocks * settings.block_size);
+
+  for (std::size_t taken = 0; taken < hatches.size(); ++taken) {
+    const int entry = grid.take(program.getPosition());
+    const Hatch& hatch = hatches[entry / 4];
+    const int corner = entry % 4;
+    const double along[2] = {hatch.along[corner & 1],
+                             hatch.along[(corner & 1) ^ 1]};
+    double across = hatch.across[corner >> 1];
+    const double step = hatch.across[1] > hatch.across[0] ? pitch : -pitch;
+    const double direction = (corner >> 1) == 0 ? step : -step;
+    program.travel(hatch.getPoint(along[0], across));
+    for (int i = 0; i < hatch.count; ++i) {
+      if (i > 0) {
+        across += direction;
+        program.cut(hatch.getPoint(along[i & 1], across));
+      }
+      program.cut(hatch.getPoint(along[(i + 1) & 1], across));
+    }
+  }
+}
+
+GcodeWriter::GcodeWriter(const GcodeSettings& settings)
+    : settings_(settings) {
+  if (settings.path < GcodePath::kLines
+      || settings.path > GcodePath::kRectangles) {
+    throw std::logic_error("Invalid path.");
+  }
+  if (!(settings.block_size > 0) || settings.lines_per_block < 1
+      || !(settings.feed_rate > 0) || !(settings.travel_rate > 0)
+      || settings.power < 0) {
+    throw std::logic_error("Invalid settings.");
+  }
+}
+
+std::string GcodeWriter::render(const QRImage& image) const {
+  std::string out;
+  render(image, out);
+  return out;
+}
+
+// The moves are written first, so the estimate can go in the header above
+// them.
+GcodeEstimate GcodeWriter::render(const QRImage& image,
+                                  std::string& out) const {
+  std::string moves;
+  GcodeProgram program(moves, settings_);
+  if (settings_.path == GcodePath::kLines) {
+    engraveLines(image, settings_, program);
+  } else {
+    engraveRectangles(image, settings_, program);
+  }
+  GcodeEstimate estimate = program.getEstimate();
+  estimate.seconds = 60 * (estimate.cut_length / settings_.feed_rate
+                           + estimate.travel_length / settings_.travel_rate);
+
+  out.clear();
+  out += "; QR code, ";
+  appendNumber(out, static_cast<double>(image.getWidth()));
+  out += " x ";
+  appendNumber(out, static_cast<double>(image.getHeight()));
+  out += " blocks of ";
+  appendNumber(out, settings_.block_size);
+  out += " mm\n; Engraving ";
+  appendNumber(out, estimate.cut_length);
+  out += " mm, moving ";
+  appendNumber(out, estimate.travel_length);
+  out += " mm in ";
+  appendNumber(out, static_cast<double>(estimate.travels));
+  out += " moves\n; Estimated time ";
+  appendNumber(out, estimate.seconds);
+  out += " s\nG21\nG90\nM4 S";
+  appendNumber(out, static_cast<double>(settings_.power));
+  out += '\n';
+  out += moves;
+  out += "M5\nM2\n";
+  return estimate;
+}
+
+GcodeEstimate GcodeWriter::write(const QRImage& image, int fd) const {
+  std::string out;
+  GcodeEstimate estimate = render(image, out);
+  QROutput::writeAll(fd, out);
+  return estimate;
+}
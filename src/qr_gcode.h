@@ -0,0 +1,57 @@
+#ifndef QR_GCODE_H_
+#define QR_GCODE_H_
+
+#include <string>
+
+#include "qr_image.h"
+
+// How the dark blocks are engraved.
+enum class GcodePath {
+  kLines = 0,  // Scan lines through each row, turning back at every line
+  kRectangles, // Rectangles of blocks, each filled back and forth
+}; // GcodePath
+
+// Size of the code and the machine that engraves it.
+struct GcodeSettings {
+  GcodePath path = GcodePath::kRectangles; // How the blocks are engraved
+  double block_size = 0.5;                 // Millimeters in a block
+  int lines_per_block = 1;                 // Scan lines in each row of blocks
+  double feed_rate = 1500;                 // Millimeters a minute engraving
+  double travel_rate = 6000;               // Millimeters a minute moving
+  int power = 1000;                        // Laser power, the S word
+}; // GcodeSettings
+
+// Time and distances of a job, estimated at full speed without the time
+// taken to speed up and slow down.
+struct GcodeEstimate {
+  double cut_length = 0;    // Millimeters moved engraving
+  double travel_length = 0; // Millimeters moved with the laser off
+  int travels = 0;          // Moves with the laser off
+  double seconds = 0;       // Time taken
+}; // GcodeEstimate
+
+// Writes G-code for a laser in GRBL's laser mode, which turns the laser off
+// for G0 moves and on for G1 moves. The code's bottom left corner is at the
+// origin. Most of the time of a job is spent moving between dark blocks, so
+// the paths are ordered to move as little as they can: scan lines turn back
+// at the end of each line, and each rectangle starts at the corner nearest
+// to where the last one ended.
+class GcodeWriter {
+ public:
+  explicit GcodeWriter(const GcodeSettings& settings = GcodeSettings());
+
+  // Returns the program for the code.
+  std::string render(const QRImage&) const;
+
+  // Replaces the contents of the string with the program, and returns the
+  // estimate for it, which is also written in the program's header.
+  GcodeEstimate render(const QRImage&, std::string&) const;
+
+  // Writes the program to the file descriptor.
+  GcodeEstimate write(const QRImage&, int) const;
+
+ private:
+  GcodeSettings settings_; // Size of the code and the machine
+}; // GcodeWriter
+
+#endif // QR_GCODE_H_
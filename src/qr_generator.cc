@@ -1,23 +1,206 @@
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iomanip>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
 
 #include "qr.h"
+#include "qr_batch.h"
+#include "qr_group.h"
 
-int main() {
+static void printUsage() {
+  std::cerr
+      << "Usage: qr_generator [-e L|M|Q|H] [-m MASK] [-t PERCENT]\n"
+      << "       qr_generator -b [-0] [-e L|M|Q|H] [-m MASK] [-t PERCENT]\n"
+      << "                    [-f FORMAT] [-s SCALE] [-q QUIET] [-j THREADS]\n"
+      << "                    [-o DIRECTORY] [FILE]\n"
+      << "  -b  Batch mode, a code for each line of FILE or stdin\n"
+      << "  -0  Payloads end with NUL instead of a newline\n"
+      << "  -e  Lowest error correction level, L by default\n"
+      << "  -m  Mask 0-7, auto (the default), dark or runs. dark and runs\n"
+      << "      choose the mask with the fewest dark blocks or runs\n"
+      << "  -t  Penalty tolerance in percent for dark and runs, 10 by default\n"
+      << "  -f  terminal (the default), svg, png, tiff, zpl or none\n"
+      << "  -s  Pixels in the width of a block, 4 by default\n"
+      << "  -q  Light blocks around each code, 4 by default\n"
+      << "  -j  Worker threads, one for each CPU by default\n"
+      << "  -o  Write each code to its own file in DIRECTORY, needed for png\n"
+      << "      and tiff\n";
+}
+
+static bool parseErrCor(std::string_view text, QRCode::ErrCor& err) {
+  if (text == "L" || text == "l") {
+    err = QRCode::ErrCor::kLow;
+  } else if (text == "M" || text == "m") {
+    err = QRCode::ErrCor::kMedium;
+  } else if (text == "Q" || text == "q") {
+    err = QRCode::ErrCor::kQuartile;
+  } else if (text == "H" || text == "h") {
+    err = QRCode::ErrCor::kHigh;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+static bool parseMask(std::string_view text, int& mask,
+                      QRCode::MaskObjective& objective) {
+  mask = QRCode::kAutoMask;
+  objective = QRCode::MaskObjective::kPenalty;
+  if (text == "dark") {
+    objective = QRCode::MaskObjective::kDarkBlocks;
+  } else if (text == "runs") {
+    objective = QRCode::MaskObjective::kDarkRuns;
+  } else if (text.size() == 1 && text[0] >= '0' && text[0] <= '7') {
+    mask = text[0] - '0';
+  } else if (text != "auto") {
+    return false;
+  }
+  return true;
+}
+
+static bool parseFormat(std::string_view text, BatchFormat& format) {
+  static const std::pair<std::string_view, BatchFormat> kFormats[] = {
+    {"none", BatchFormat::kNone}, {"terminal", BatchFormat::kTerminal},
+    {"svg", BatchFormat::kSvg},   {"png", BatchFormat::kPng},
+    {"tiff", BatchFormat::kTiff}, {"zpl", BatchFormat::kZpl},
+  };
+  for (const auto& entry : kFormats) {
+    if (text == entry.first) {
+      format = entry.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool parseNumber(const char* text, int low, int& value) {
+  char* end;
+  errno = 0;
+  long number = std::strtol(text, &end, 10);
+  if (errno != 0 || end == text || *end != '\0' || number < low
+      || number > 1 << 20) {
+    return false;
+  }
+  value = static_cast<int>(number);
+  return true;
+}
+
+// Makes every code of the input, and prints how fast on stderr.
+static int runBatch(const BatchOptions& options, const char* file) {
+  int in = 0;
+  if (file != nullptr && std::string_view(file) != "-") {
+    in = ::open(file, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+      std::cerr << "qr_generator: " << file << ": "
+                << std::system_category().message(errno) << "\n";
+      return 1;
+    }
+  }
+
+  BatchSummary summary;
+  bool ran = true;
+  try {
+    BatchRunner runner(options);
+    summary = runner.run(in, 1);
+  } catch (const std::exception& error) {
+    std::cerr << "qr_generator: " << error.what() << "\n";
+    ran = false;
+  }
+  if (in != 0) {
+    ::close(in);
+  }
+  if (!ran) {
+    return 1;
+  }
+
+  const double seconds = summary.seconds > 0 ? summary.seconds : 1e-9;
+  std::cerr << std::fixed << std::setprecision(3) << "qr_generator: "
+            << summary.codes << " codes, " << summary.failed << " failed, in "
+            << summary.seconds << " s: " << std::setprecision(0)
+            << summary.codes / seconds << " codes/s, "
+            << std::setprecision(1) << summary.bytes_read / seconds / 1e6
+            << " MB/s in, " << summary.bytes_written / seconds / 1e6
+            << " MB/s out\n";
+  return summary.failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
   std::string text;
-  int err;
-  int mask;
+  QRCode::ErrCor err = QRCode::ErrCor::kLow;
+  int mask = QRCode::kAutoMask;
+  QRCode::MaskObjective objective = QRCode::MaskObjective::kPenalty;
+  int tolerance = 10;
+  bool batch = false;
+  bool batch_only = false; // An option only for batches was given
+  BatchOptions options;
+
+  int option;
+  while ((option = ::getopt(argc, argv, "b0e:m:t:f:s:q:j:o:h")) != -1) {
+    bool valid = true;
+    switch (option) {
+      case 'b': batch = true;                                       break;
+      case '0': options.delimiter = '\0';                           break;
+      case 'e': valid = parseErrCor(optarg, err);                   break;
+      case 'm': valid = parseMask(optarg, mask, objective);         break;
+      case 't': valid = parseNumber(optarg, 0, tolerance);          break;
+      case 'f': valid = parseFormat(optarg, options.format);        break;
+      case 's': valid = parseNumber(optarg, 1, options.scale);      break;
+      case 'q': valid = parseNumber(optarg, 0, options.quiet_zone); break;
+      case 'j': valid = parseNumber(optarg, 0, options.threads);    break;
+      case 'o': options.directory = optarg;                         break;
+      default:  valid = false;                                      break;
+    }
+    if (!valid) {
+      printUsage();
+      return 2;
+    }
+    if (std::string_view("0fsqjo").find(static_cast<char>(option))
+        != std::string_view::npos) {
+      batch_only = true;
+    }
+  }
+  if (optind < argc - 1 || (!batch && (optind < argc || batch_only))) {
+    printUsage();
+    return 2;
+  }
+  if ((options.format == BatchFormat::kPng
+       || options.format == BatchFormat::kTiff)
+      && options.directory.empty()) {
+    std::cerr << "qr_generator: png and tiff codes need -o DIRECTORY\n";
+    return 2;
+  }
+
+  if (batch) {
+    options.err = err;
+    options.mask = mask;
+    options.objective = objective;
+    options.tolerance = tolerance;
+    return runBatch(options, optind < argc ? argv[optind] : nullptr);
+  }
 
   std::cout << "Enter text to be converted to QR Code: ";
   std::getline(std::cin, text);
 
-  QRCode code(text);
+  // Text too long for one QR code is split across several.
+  QRCodeGroup group(text, err, mask);
 
-  std::cout << "Version: " << code.getVersion() << " Encoding Mode: " 
-            << code.getEncoding() << " Bits Per Char: "
-            << code.getBitsPerChar() << " Mask: " << code.getMask() 
-            << " Size (H & W): " << code.getSize() << "\n";
-  
-  code.printQR();
+  for (int i = 0; i < group.getCount(); ++i) {
+    QRCode& code = group.getSymbol(i);
+    if (objective != QRCode::MaskObjective::kPenalty) {
+      code.remask(objective, tolerance);
+    }
+    std::cout << "Version: " << code.getVersion() << " Encoding Mode: " 
+              << code.getEncoding() << " Bits Per Char: "
+              << code.getBitsPerChar() << " Mask: " << code.getMask() 
+              << " Size (H & W): " << code.getSize() << "\n";
+    
+    code.printQR();
+  }
   return 0;
-}
\ No newline at end of file
+}
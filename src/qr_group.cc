@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+#include "qr_group.h"
+#include "thread_pool.h"
+
+// Structured Append header: 4 bit mode, 4 bit position, 4 bit count and the
+// 8 bit parity.
+static const int kHeaderBits = 20;
+
+// Parts being encoded, shared with the tasks that help so that a task
+// starting after every part is done still finds them.
+struct QRCodeGroup::Encoding {
+  std::vector<std::pmr::vector<QRCode::Segment> > parts;
+  QRCode::ErrCor err;
+  int msk;
+  std::vector<std::optional<QRCode> > symbols;
+  std::vector<std::exception_ptr> errors;
+  std::atomic<std::size_t> next = 0;  // Next part to claim
+  std::mutex mutex;                   // Guards 'done'
+  std::condition_variable finished;   // Signals a part is done
+  std::size_t done = 0;               // Parts encoded or failed
+
+  // Encodes parts until none are left to claim.
+  void run() {
+    for (std::size_t i; (i = next++) < parts.size();) {
+      try {
+        symbols[i].emplace(parts[i], err, msk);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++done;
+      }
+      finished.notify_all();
+    }
+  }
+}; // QRCodeGroup::Encoding
+
+QRCodeGroup::QRCodeGroup(std::string_view text, QRCode::ErrCor err, int msk,
+                         int max_version, ThreadPool* pool) : parity_(0) {
+  if (max_version < 1 || max_version > 40) {
+    throw std::logic_error("Invalid version");
+  }
+  for (const auto& ch : text) {
+    parity_ ^= static_cast<std::uint8_t>(ch);
+  }
+
+  // Numeric and alphanumeric text is split on whole groups of characters so
+  // no bits are wasted on a short group in the middle of the message.
+  const std::pmr::vector<QRCode::Segment> whole =
+      QRCode::Segment::makeSegments(text);
+  int mode = whole.back().getEncoding().getEncodingMode();
+  int unit = mode == 1 ? 3 : mode == 2 ? 2 : 1;
+  int capacity = QRCode::getTotalCodewords(max_version, err) * 8;
+
+  // Find the fewest symbols that hold every part.
+  std::vector<std::pmr::vector<QRCode::Segment> > parts;
+  for (int count = 1; count <= kMaxSymbols && parts.empty(); ++count) {
+    const std::vector<std::size_t> bounds = splitText(text, count, unit);
+    for (int i = 0; i < count; ++i) {
+      std::pmr::vector<QRCode::Segment> part = QRCode::Segment::makeSegments(
+          text.substr(bounds.at(i), bounds.at(i + 1) - bounds.at(i)));
+      int bits = QRCode::Segment::getTotalBits(part, max_version);
+      if (bits < 0 || bits + (count > 1 ? kHeaderBits : 0) > capacity) {
+        parts.clear();
+        break;
+      }
+      if (count > 1) {
+        part.insert(part.begin(), QRCode::Segment::makeStructuredAppend(
+            i, count, parity_));
+      }
+      parts.push_back(std::move(part));
+    }
+  }
+  if (parts.empty()) {
+    throw std::logic_error("String too long!");
+  }
+
+  // Encode the symbols at the same time. The calling thread claims parts
+  // like the tasks do rather than waiting for them, so this cannot deadlock
+  // when run in a task of the same pool, and a single part is encoded here.
+  auto encoding = std::make_shared<Encoding>();
+  encoding->parts = std::move(parts);
+  encoding->err = err;
+  encoding->msk = msk;
+  encoding->symbols.resize(encoding->parts.size());
+  encoding->errors.resize(encoding->parts.size());
+  if (encoding->parts.size() > 1) {
+    if (pool == nullptr) {
+      pool = &ThreadPool::getDefault();
+    }
+    const std::size_t helpers = std::min<std::size_t>(
+        encoding->parts.size() - 1, pool->getNumThreads());
+    for (std::size_t i = 0; i < helpers; ++i) {
+      try {
+        pool->submit([encoding]() { encoding->run(); });
+      } catch (...) {
+        break; // The parts not taken by a task are encoded here
+      }
+    }
+  }
+  encoding->run();
+  {
+    std::unique_lock<std::mutex> lock(encoding->mutex);
+    encoding->finished.wait(lock, [&encoding]() {
+      return encoding->done == encoding->parts.size();
+    });
+  }
+
+  symbols_.reserve(encoding->parts.size());
+  for (std::size_t i = 0; i < encoding->parts.size(); ++i) {
+    if (encoding->errors[i]) {
+      std::rethrow_exception(encoding->errors[i]);
+    }
+    symbols_.push_back(std::move(*encoding->symbols[i]));
+  }
+}
+
+// Prints every symbol in order, separated by a blank line.
+void QRCodeGroup::printQR() {
+  for (std::size_t i = 0; i < symbols_.size(); ++i) {
+    if (i > 0) {
+      std::cout << "\n";
+    }
+    symbols_.at(i).printQR();
+  }
+}
+
+// Returns the offsets where each of the 'count' parts start, followed by
+// the length of the text. The parts are as close to equal as possible
+// while keeping groups of 'unit' characters and UTF-8 sequences whole.
+std::vector<std::size_t> QRCodeGroup::splitText(std::string_view text,
+                                                int count, int unit) {
+  std::vector<std::size_t> bounds(1, 0);
+  std::size_t units = (text.length() + unit - 1) / unit;
+  for (int i = 1; i < count; ++i) {
+    std::size_t pos = std::min(units * i / count * unit, text.length());
+    while (pos < text.length()
+           && (static_cast<unsigned char>(text[pos]) & 0xC0) == 0x80) {
+      ++pos;
+    }
+    bounds.push_back(std::max(pos, bounds.back()));
+  }
+  bounds.push_back(text.length());
+  return bounds;
+}
@@ -0,0 +1,43 @@
+#ifndef QR_GROUP_H_
+#define QR_GROUP_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "qr.h"
+
+class ThreadPool;
+
+// A message split across up to 16 QR codes with Structured Append. Each
+// symbol holds its position, the number of symbols and the parity of the
+// whole message so a reader can put the message back together.
+class QRCodeGroup {
+ public:
+  static const int kMaxSymbols = 16;
+
+  // Splits the text into the fewest symbols that fit within 'max_version',
+  // with the parts close in size so the symbols have similar versions. The
+  // symbols are encoded by the calling thread helped by tasks on 'pool', or
+  // the default pool if none is given. It does not wait on the tasks, so
+  // it may be called from a task of the same pool.
+  QRCodeGroup(std::string_view, QRCode::ErrCor err = QRCode::ErrCor::kLow,
+              int msk = 0, int max_version = 40, ThreadPool* pool = nullptr);
+
+  int getCount() const { return static_cast<int>(symbols_.size()); }
+  QRCode& getSymbol(int index) { return symbols_.at(index); }
+  std::uint8_t getParity() const { return parity_; }
+
+  void printQR();
+
+ private:
+  struct Encoding;
+
+  static std::vector<std::size_t> splitText(std::string_view, int, int);
+
+  std::vector<QRCode> symbols_; // Symbols in Structured Append order
+  std::uint8_t parity_;         // XOR of every byte of the message
+}; // QRCodeGroup
+
+#endif // QR_GROUP_H_
@@ -0,0 +1,115 @@
+#ifndef QR_IMAGE_H_
+#define QR_IMAGE_H_
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "encoder.h"
+#include "qr_packed.h"
+
+// Blocks of a code as packed rows, the layout of QRBitmap and PackedQRCode,
+// for the image writers. The rows are not copied, so the bitmap or buffer
+// they come from must outlive the image.
+class QRImage {
+ public:
+  QRImage(std::span<const std::uint8_t> rows, int width, int height)
+      : rows_(rows), width_(width), height_(height) {
+    if (width < 1 || height < 1
+        || rows.size() < static_cast<std::size_t>(getStride() * height)) {
+      throw std::logic_error("Invalid image.");
+    }
+  }
+  QRImage(const QRBitmap& bitmap)
+      : QRImage(bitmap.getData(), bitmap.getSize(), bitmap.getSize()) {}
+  QRImage(const PackedQRCode& code)
+      : QRImage(code.getData(), code.getSize(), code.getHeight()) {}
+
+  int getWidth() const { return width_; }
+  int getHeight() const { return height_; }
+  int getStride() const { return (width_ + 7) / 8; }
+  const std::uint8_t* getRow(int y) const {
+    return rows_.data() + y * getStride();
+  }
+  bool getBlock(int x, int y) const {
+    return ((getRow(y)[x >> 3] >> (7 - (x & 7))) & 1) != 0;
+  }
+
+  // Calls 'visit' with the first block and the length of each run of dark
+  // blocks in the row. The runs are found 64 blocks at a time by counting
+  // leading zeros and ones, rather than testing each block.
+  template <typename Visitor>
+  void forEachRun(int y, Visitor&& visit) const {
+    int x = 0;
+    while (x < width_) {
+      std::uint64_t bits = getBits(x, y);
+      if (bits == 0) {
+        x += 64 - (x & 7);
+        continue;
+      }
+      x += std::countl_zero(bits);
+      int first = x;
+      int ones;
+      do {
+        ones = std::countl_one(getBits(x, y));
+        x += ones;
+      } while (ones == 64 - ((x - ones) & 7));
+      visit(first, x - first);
+    }
+  }
+
+  // Calls 'visit' with the left, top, width and height of rectangles that
+  // cover the dark blocks once each. Each run of blocks not yet covered is
+  // taken in turn from the top, then grown down while the rows below are
+  // dark across it. Codes have about three rectangles for every four runs.
+  template <typename Visitor>
+  void forEachRectangle(Visitor&& visit) const {
+    std::vector<std::uint8_t> left(rows_.begin(),
+                                   rows_.begin() + getStride() * height_);
+    const QRImage rest(left, width_, height_);
+    for (int y = 0; y < height_; ++y) {
+      rest.forEachRun(y, [&](int first, int length) {
+        int bottom = y + 1;
+        while (bottom < height_ && rest.isDark(first, length, bottom)) {
+          for (int x = first; x < first + length; ++x) {
+            left[bottom * getStride() + (x >> 3)] &= ~(0x80 >> (x & 7));
+          }
+          ++bottom;
+        }
+        visit(first, y, length, bottom - y);
+      });
+    }
+  }
+
+ private:
+  // Up to 64 blocks of the row from block 'x' on, the first in the high bit.
+  // At least 57 blocks are read, and blocks past the end of the row are 0.
+  std::uint64_t getBits(int x, int y) const {
+    const std::uint8_t* row = getRow(y);
+    std::uint64_t bits = 0;
+    for (int i = 0, byte = x >> 3; i < 8; ++i, ++byte) {
+      bits = bits << 8 | (byte < getStride() ? row[byte] : 0);
+    }
+    bits <<= x & 7;
+    int left = width_ - x;
+    return left >= 64 ? bits : bits & ~(~std::uint64_t{0} >> left);
+  }
+
+  // Whether 'length' blocks of the row from block 'x' on are all dark.
+  bool isDark(int x, int length, int y) const {
+    for (; length > 57; x += 57, length -= 57) {
+      if (std::countl_one(getBits(x, y)) < 57) {
+        return false;
+      }
+    }
+    return std::countl_one(getBits(x, y)) >= length;
+  }
+
+  std::span<const std::uint8_t> rows_; // Packed rows
+  int width_;                          // Blocks in a row
+  int height_;                         // Number of rows
+}; // QRImage
+
+#endif // QR_IMAGE_H_
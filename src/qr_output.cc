@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+#include "qr_output.h"
+
+void QROutput::writeAll(int fd, std::span<const std::uint8_t> data) {
+  const std::uint8_t* next = data.data();
+  std::size_t left = data.size();
+  while (left > 0) {
+    ssize_t written = ::write(fd, next, left);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "write");
+    }
+    next += written;
+    left -= static_cast<std::size_t>(written);
+  }
+}
+
+void QROutput::writeAll(int fd, std::string_view text) {
+  writeAll(fd, std::span<const std::uint8_t>(
+                   reinterpret_cast<const std::uint8_t*>(text.data()),
+                   text.size()));
+}
+
+// The buffers are copied, so the ones only partly written can be moved on.
+void QROutput::writeAll(int fd, std::span<const iovec> buffers) {
+  std::vector<iovec> pending(buffers.begin(), buffers.end());
+  std::size_t first = 0;
+  while (first < pending.size()) {
+    int count = static_cast<int>(std::min<std::size_t>(pending.size() - first,
+                                                       IOV_MAX));
+    ssize_t written = ::writev(fd, pending.data() + first, count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "writev");
+    }
+    std::size_t left = static_cast<std::size_t>(written);
+    while (first < pending.size() && left >= pending[first].iov_len) {
+      left -= pending[first].iov_len;
+      ++first;
+    }
+    if (left > 0) {
+      pending[first].iov_base = static_cast<char*>(pending[first].iov_base)
+                                + left;
+      pending[first].iov_len -= left;
+    }
+  }
+}
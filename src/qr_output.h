@@ -0,0 +1,22 @@
+#ifndef QR_OUTPUT_H_
+#define QR_OUTPUT_H_
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <sys/uio.h>
+
+// Writing the output of the image writers to files.
+class QROutput {
+ public:
+  // Writes all of the bytes to the file descriptor. write() can write less
+  // than asked, so the rest is written after, and interrupted calls are
+  // retried. Throws std::system_error if a write fails.
+  static void writeAll(int, std::span<const std::uint8_t>);
+  static void writeAll(int, std::string_view);
+
+  // Writes every buffer in order with writev(), at most IOV_MAX at a time.
+  static void writeAll(int, std::span<const iovec>);
+}; // QROutput
+
+#endif // QR_OUTPUT_H_
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "qr_packed.h"
+
+PackedQRCode::PackedQRCode(std::span<const std::uint8_t> data) : data_(data) {
+  if (data.size() < static_cast<std::size_t>(kHeaderSize)
+      || data[0] != 'Q' || data[1] != 'R' || data[2] != 'B') {
+    throw std::logic_error("Not a packed QR code.");
+  }
+  if (data[3] != kFormatVersion) {
+    throw std::logic_error("Unsupported packed QR code format.");
+  }
+
+  // Each symbol type has its own range of versions and a size that follows
+  // from the version. rMQR codes only have the medium and high levels.
+  int version = getVersion();
+  bool valid = data[6] <= static_cast<int>(QRCode::ErrCor::kHigh)
+               && getSize() > 0 && getHeight() > 0;
+  switch (getSymbolType()) {
+    case QRCode::SymbolType::kQR:
+      valid = valid && version >= 1 && version <= 40 && getMask() <= 7
+              && getSize() == (4 * version) + 17 && getHeight() == getSize();
+      break;
+    case QRCode::SymbolType::kMicro:
+      valid = valid && version >= 1 && version <= 4 && getMask() <= 3
+              && getSize() == (2 * version) + 9 && getHeight() == getSize();
+      break;
+    case QRCode::SymbolType::kRectMicro:
+      valid = valid && version >= 1 && version <= 32 && getMask() == 0
+              && getSize() == QRCode::kRMQR_width_[version]
+              && getHeight() == QRCode::kRMQR_height_[version]
+              && (getErrCor() == QRCode::ErrCor::kMedium
+                  || getErrCor() == QRCode::ErrCor::kHigh);
+      break;
+    default:
+      valid = false;
+  }
+  if (!valid) {
+    throw std::logic_error("Invalid packed QR code header.");
+  }
+  if (data.size() < getLength()) {
+    throw std::logic_error("Packed QR code is cut short.");
+  }
+}
+
+QRCode::SymbolType PackedQRCode::getSymbolType() const {
+  return static_cast<QRCode::SymbolType>(data_[4]);
+}
+
+QRCode::ErrCor PackedQRCode::getErrCor() const {
+  return static_cast<QRCode::ErrCor>(data_[6]);
+}
+
+std::size_t PackedQRCode::getLength(int width, int height) {
+  return static_cast<std::size_t>(kHeaderSize + (width + 7) / 8 * height);
+}
+
+void PackedQRCode::writeHeader(std::span<std::uint8_t> out,
+                               QRCode::SymbolType type, int version,
+                               QRCode::ErrCor err, int mask, int quiet_zone,
+                               int width, int height) {
+  if (quiet_zone < 0 || quiet_zone > 255) {
+    throw std::logic_error("Invalid quiet zone.");
+  }
+  if (out.size() < getLength(width, height)) {
+    throw std::logic_error("Buffer too small.");
+  }
+  out[0] = 'Q';
+  out[1] = 'R';
+  out[2] = 'B';
+  out[3] = kFormatVersion;
+  out[4] = static_cast<std::uint8_t>(type);
+  out[5] = static_cast<std::uint8_t>(version);
+  out[6] = static_cast<std::uint8_t>(err);
+  out[7] = static_cast<std::uint8_t>(mask);
+  out[8] = static_cast<std::uint8_t>(quiet_zone);
+  out[9] = static_cast<std::uint8_t>(width);
+  out[10] = static_cast<std::uint8_t>(height);
+  out[11] = 0;
+}
+
+// The rows of a bitmap are already packed, so they are copied as they are.
+std::size_t PackedQRCode::write(const QRBitmap& bitmap,
+                                std::span<std::uint8_t> out, int quiet_zone) {
+  writeHeader(out, QRCode::SymbolType::kQR, bitmap.getVersion(),
+              bitmap.getErrCor(), bitmap.getMask(), quiet_zone,
+              bitmap.getSize(), bitmap.getSize());
+  std::span<const std::uint8_t> rows = bitmap.getData();
+  std::copy(rows.begin(), rows.end(), out.begin() + kHeaderSize);
+  return kHeaderSize + rows.size();
+}
+
+std::size_t PackedQRCode::write(const QRCode& code,
+                                std::span<std::uint8_t> out, int quiet_zone) {
+  writeHeader(out, code.getSymbolType(), code.getVersion(), code.getErrCor(),
+              code.getMask(), quiet_zone, code.getSize(), code.getHeight());
+  const int stride = (code.getSize() + 7) / 8;
+  for (int y = 0; y < code.getHeight(); ++y) {
+    std::uint8_t* row = out.data() + kHeaderSize + y * stride;
+    std::fill(row, row + stride, 0);
+    for (int x = 0; x < code.getSize(); ++x) {
+      row[x >> 3] |= static_cast<std::uint8_t>(code.getBlock(x, y))
+                     << (7 - (x & 7));
+    }
+  }
+  return getLength(code.getSize(), code.getHeight());
+}
+
+std::vector<std::uint8_t> PackedQRCode::serialize(const QRBitmap& bitmap,
+                                                  int quiet_zone) {
+  std::vector<std::uint8_t> out(getLength(bitmap.getSize(),
+                                          bitmap.getSize()));
+  write(bitmap, out, quiet_zone);
+  return out;
+}
+
+std::vector<std::uint8_t> PackedQRCode::serialize(const QRCode& code,
+                                                  int quiet_zone) {
+  std::vector<std::uint8_t> out(getLength(code.getSize(), code.getHeight()));
+  write(code, out, quiet_zone);
+  return out;
+}
@@ -0,0 +1,78 @@
+#ifndef QR_PACKED_H_
+#define QR_PACKED_H_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+
+// A QR code serialized as a 12 byte header followed by the blocks, 1 bit per
+// block. The rows are packed the same as QRBitmap, the leftmost block in the
+// high bit of the first byte and each row starting on a byte boundary. A
+// version 40 code takes 4083 bytes.
+//
+// Header: 'Q' 'R' 'B' format version (1), symbol type, version, error
+// correction level, mask, quiet zone, width, height, 0.
+//
+// A PackedQRCode reads the code in place, the rows are spans of the buffer
+// it was made from, which must outlive it.
+class PackedQRCode {
+ public:
+  static const int kHeaderSize = 12;
+  static const int kFormatVersion = 1;
+
+  // Reads a serialized code. Throws if the header is invalid or the buffer
+  // is too short for the rows.
+  explicit PackedQRCode(std::span<const std::uint8_t>);
+
+  QRCode::SymbolType getSymbolType() const;
+  int getVersion() const { return data_[5]; }
+  QRCode::ErrCor getErrCor() const;
+  int getMask() const { return data_[7]; }
+  int getQuietZone() const { return data_[8]; }
+  int getSize() const { return data_[9]; }
+  int getHeight() const { return data_[10]; }
+  int getStride() const { return (getSize() + 7) / 8; }
+
+  // The packed rows, without the header.
+  std::span<const std::uint8_t> getRow(int y) const {
+    return data_.subspan(
+        static_cast<std::size_t>(kHeaderSize + y * getStride()),
+        getStride());
+  }
+  std::span<const std::uint8_t> getData() const {
+    return data_.subspan(kHeaderSize, getLength() - kHeaderSize);
+  }
+  bool getBlock(int x, int y) const {
+    return ((data_[kHeaderSize + y * getStride() + x / 8] >> (7 - x % 8))
+            & 1) != 0;
+  }
+
+  // Bytes used by the code, the header and rows.
+  std::size_t getLength() const { return getLength(getSize(), getHeight()); }
+  static std::size_t getLength(int, int);
+
+  // Writes a code into the buffer, with the quiet zone recorded in the
+  // header. Returns the number of bytes written, throws if the buffer is
+  // too short.
+  static std::size_t write(const QRBitmap&, std::span<std::uint8_t>,
+                           int quiet_zone = 4);
+  static std::size_t write(const QRCode&, std::span<std::uint8_t>,
+                           int quiet_zone = 4);
+
+  // The same, into a new buffer of the right length.
+  static std::vector<std::uint8_t> serialize(const QRBitmap&,
+                                             int quiet_zone = 4);
+  static std::vector<std::uint8_t> serialize(const QRCode&,
+                                             int quiet_zone = 4);
+
+ private:
+  static void writeHeader(std::span<std::uint8_t>, QRCode::SymbolType, int,
+                          QRCode::ErrCor, int, int, int, int);
+
+  std::span<const std::uint8_t> data_; // Header and rows
+}; // PackedQRCode
+
+#endif // QR_PACKED_H_
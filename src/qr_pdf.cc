@@ -0,0 +1,228 @@
+#include <charconv>
+#include <stdexcept>
+
+#include "qr_output.h"
+#include "qr_pdf.h"
+
+// Bytes buffered before they are written.
+static const std::size_t kFlushLength = 1 << 16;
+
+static void appendNumber(std::string& out, std::uint64_t value) {
+  char digits[24];
+  char* end = std::to_chars(digits, digits + sizeof digits, value).ptr;
+  out.append(digits, end);
+}
+
+// PDF numbers have no exponent, so points are written with 3 decimals and
+// the trailing zeros taken off.
+static void appendNumber(std::string& out, double value) {
+  char digits[48];
+  char* end = std::to_chars(digits, digits + sizeof digits, value,
+                            std::chars_format::fixed, 3).ptr;
+  while (end[-1] == '0') {
+    --end;
+  }
+  if (end[-1] == '.') {
+    --end;
+  }
+  if (end - digits == 2 && digits[0] == '-' && digits[1] == '0') {
+    out += '0';
+    return;
+  }
+  out.append(digits, end);
+}
+
+PdfWriter::PdfWriter(int fd, Style style, double page_width,
+                     double page_height)
+    : fd_(fd), style_(style), page_width_(page_width),
+      page_height_(page_height), written_(0), xref_(3, 0), in_page_(false),
+      finished_(false) {
+  if (!(page_width > 0) || !(page_height > 0)) {
+    throw std::logic_error("Invalid page size.");
+  }
+  buffer_ += "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n";
+}
+
+void PdfWriter::beginPage() {
+  if (finished_) {
+    throw std::logic_error("PDF already finished.");
+  }
+  if (in_page_) {
+    endPage();
+  }
+  in_page_ = true;
+}
+
+// A path flips the page so blocks are drawn in whole numbers from the top
+// left of the code. An image is written as an object of its own straight
+// away, its rows are the packed rows of the code.
+void PdfWriter::draw(const QRImage& image, double x, double y,
+                     double block_size) {
+  if (!in_page_) {
+    throw std::logic_error("No page started.");
+  }
+  if (!(block_size > 0)) {
+    throw std::logic_error("Invalid block size.");
+  }
+
+  content_ += "q ";
+  if (style_ == Style::kPath) {
+    appendNumber(content_, block_size);
+    content_ += " 0 0 ";
+    appendNumber(content_, -block_size);
+    content_ += ' ';
+    appendNumber(content_, x);
+    content_ += ' ';
+    appendNumber(content_, page_height_ - y);
+    content_ += " cm\n";
+    for (int row = 0; row < image.getHeight(); ++row) {
+      image.forEachRun(row, [this, row](int first, int length) {
+        appendNumber(content_, static_cast<std::uint64_t>(first));
+        content_ += ' ';
+        appendNumber(content_, static_cast<std::uint64_t>(row));
+        content_ += ' ';
+        appendNumber(content_, static_cast<std::uint64_t>(length));
+        content_ += " 1 re\n";
+      });
+    }
+    content_ += "f Q\n";
+    return;
+  }
+
+  const std::size_t length = static_cast<std::size_t>(image.getStride())
+                             * image.getHeight();
+  const int number = beginObject();
+  buffer_ += "<< /Type /XObject /Subtype /Image /Width ";
+  appendNumber(buffer_, static_cast<std::uint64_t>(image.getWidth()));
+  buffer_ += " /Height ";
+  appendNumber(buffer_, static_cast<std::uint64_t>(image.getHeight()));
+  buffer_ += " /ColorSpace /DeviceGray /BitsPerComponent 1 /Decode [1 0]"
+             " /Length ";
+  appendNumber(buffer_, static_cast<std::uint64_t>(length));
+  buffer_ += " >>\nstream\n";
+  buffer_.append(reinterpret_cast<const char*>(image.getRow(0)), length);
+  buffer_ += "\nendstream\n";
+  endObject();
+
+  resources_ += " /I";
+  appendNumber(resources_, static_cast<std::uint64_t>(number));
+  resources_ += ' ';
+  appendNumber(resources_, static_cast<std::uint64_t>(number));
+  resources_ += " 0 R";
+
+  const double width = image.getWidth() * block_size;
+  const double height = image.getHeight() * block_size;
+  appendNumber(content_, width);
+  content_ += " 0 0 ";
+  appendNumber(content_, height);
+  content_ += ' ';
+  appendNumber(content_, x);
+  content_ += ' ';
+  appendNumber(content_, page_height_ - y - height);
+  content_ += " cm /I";
+  appendNumber(content_, static_cast<std::uint64_t>(number));
+  content_ += " Do Q\n";
+}
+
+void PdfWriter::endPage() {
+  if (!in_page_) {
+    throw std::logic_error("No page started.");
+  }
+  const int contents = beginObject();
+  buffer_ += "<< /Length ";
+  appendNumber(buffer_, static_cast<std::uint64_t>(content_.size()));
+  buffer_ += " >>\nstream\n";
+  buffer_ += content_;
+  buffer_ += "endstream\n";
+  endObject();
+
+  pages_.push_back(beginObject());
+  buffer_ += "<< /Type /Page /Parent 2 0 R /MediaBox [0 0 ";
+  appendNumber(buffer_, page_width_);
+  buffer_ += ' ';
+  appendNumber(buffer_, page_height_);
+  buffer_ += "] /Resources << /XObject <<";
+  buffer_ += resources_;
+  buffer_ += " >> >> /Contents ";
+  appendNumber(buffer_, static_cast<std::uint64_t>(contents));
+  buffer_ += " 0 R >>\n";
+  endObject();
+
+  content_.clear();
+  resources_.clear();
+  in_page_ = false;
+  flush();
+}
+
+// The page tree and catalog take the object numbers kept for them at the
+// start. Each cross-reference entry is exactly 20 bytes.
+void PdfWriter::finish() {
+  if (finished_) {
+    throw std::logic_error("PDF already finished.");
+  }
+  if (in_page_) {
+    endPage();
+  }
+
+  xref_[2] = written_ + buffer_.size();
+  buffer_ += "2 0 obj\n<< /Type /Pages /Kids [";
+  for (int page : pages_) {
+    buffer_ += ' ';
+    appendNumber(buffer_, static_cast<std::uint64_t>(page));
+    buffer_ += " 0 R";
+    if (buffer_.size() >= kFlushLength) {
+      flush();
+    }
+  }
+  buffer_ += " ] /Count ";
+  appendNumber(buffer_, static_cast<std::uint64_t>(pages_.size()));
+  buffer_ += " >>\nendobj\n";
+  xref_[1] = written_ + buffer_.size();
+  buffer_ += "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n";
+
+  const std::uint64_t start = written_ + buffer_.size();
+  buffer_ += "xref\n0 ";
+  appendNumber(buffer_, static_cast<std::uint64_t>(xref_.size()));
+  buffer_ += "\n0000000000 65535 f \n";
+  for (std::size_t i = 1; i < xref_.size(); ++i) {
+    char entry[24];
+    char* end = std::to_chars(entry, entry + sizeof entry, xref_[i]).ptr;
+    if (end - entry > 10) {
+      throw std::logic_error("PDF too large.");
+    }
+    buffer_.append(10 - (end - entry), '0');
+    buffer_.append(entry, end);
+    buffer_ += " 00000 n \n";
+    if (buffer_.size() >= kFlushLength) {
+      flush();
+    }
+  }
+  buffer_ += "trailer\n<< /Size ";
+  appendNumber(buffer_, static_cast<std::uint64_t>(xref_.size()));
+  buffer_ += " /Root 1 0 R >>\nstartxref\n";
+  appendNumber(buffer_, start);
+  buffer_ += "\n%%EOF\n";
+  finished_ = true;
+  flush();
+}
+
+int PdfWriter::beginObject() {
+  const int number = static_cast<int>(xref_.size());
+  xref_.push_back(written_ + buffer_.size());
+  appendNumber(buffer_, static_cast<std::uint64_t>(number));
+  buffer_ += " 0 obj\n";
+  return number;
+}
+
+void PdfWriter::endObject() {
+  buffer_ += "endobj\n";
+  if (buffer_.size() >= kFlushLength) {
+    flush();
+  }
+}
+
+void PdfWriter::flush() {
+  QROutput::writeAll(fd_, buffer_);
+  written_ += buffer_.size();
+  buffer_.clear();
+}
@@ -0,0 +1,66 @@
+#ifndef QR_PDF_H_
+#define QR_PDF_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "qr_image.h"
+
+// Writes codes to a PDF as it goes, one page at a time, to a file
+// descriptor. Each page is written when it ends, and only the offsets of
+// the objects are kept for the cross-reference table, so a job of any
+// number of codes takes a few bytes of memory for each page and code.
+class PdfWriter {
+ public:
+  // How each code is drawn.
+  enum class Style {
+    kPath = 0, // Filled rectangles, one for each run of dark blocks in a row
+    kImage,    // 1 bit image, one pixel for each block
+  }; // Style
+
+  // Pages are 'page_width' by 'page_height' points, US Letter by default.
+  // The header is written straight away.
+  explicit PdfWriter(int fd, Style style = Style::kPath,
+                     double page_width = 612, double page_height = 792);
+
+  PdfWriter(const PdfWriter&) = delete;
+  PdfWriter& operator=(const PdfWriter&) = delete;
+
+  int getPageCount() const { return static_cast<int>(pages_.size()); }
+
+  // Starts a page, ending the one before it.
+  void beginPage();
+
+  // Draws a code with its top left block at 'x', 'y' points from the top
+  // left of the page, each block 'block_size' points square. The quiet zone
+  // is left to the caller's spacing. Throws if no page was started.
+  void draw(const QRImage&, double x, double y, double block_size);
+
+  // Writes the page. Throws if no page was started.
+  void endPage();
+
+  // Ends the last page and writes the page tree, cross-reference table and
+  // trailer. Nothing can be drawn afterwards.
+  void finish();
+
+ private:
+  int beginObject();
+  void endObject();
+  void flush();
+
+  int fd_;                           // Output
+  Style style_;                      // How codes are drawn
+  double page_width_;                // Size of each page in points
+  double page_height_;
+  std::string buffer_;               // Bytes not yet written
+  std::uint64_t written_;            // Bytes written before 'buffer_'
+  std::vector<std::uint64_t> xref_;  // Offset of each object, 0 is unused
+  std::vector<int> pages_;           // Object number of each page
+  bool in_page_;                     // A page has been started
+  bool finished_;                    // The trailer has been written
+  std::string content_;              // Content stream of the page
+  std::string resources_;            // Images used on the page
+}; // PdfWriter
+
+#endif // QR_PDF_H_
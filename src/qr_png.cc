@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <future>
+#include <stdexcept>
+
+#include "qr_deflate.h"
+#include "qr_output.h"
+#include "qr_png.h"
+
+// CRC-32 of the PNG chunks, reflected polynomial 0xEDB88320. Table 'k'
+// gives the CRC of a byte followed by 'k' zero bytes, so four bytes are
+// done at a time.
+static constexpr std::array<std::array<std::uint32_t, 256>, 4> 
+makeCrcTables() {
+  std::array<std::array<std::uint32_t, 256>, 4> tables{};
+  for (std::uint32_t n = 0; n < 256; ++n) {
+    std::uint32_t c = n;
+    for (int k = 0; k < 8; ++k) {
+      c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    }
+    tables[0][n] = c;
+  }
+  for (int k = 1; k < 4; ++k) {
+    for (std::uint32_t n = 0; n < 256; ++n) {
+      std::uint32_t c = tables[k - 1][n];
+      tables[k][n] = tables[0][c & 0xFF] ^ (c >> 8);
+    }
+  }
+  return tables;
+}
+
+static constexpr std::array<std::array<std::uint32_t, 256>, 4> kCrcTables =
+    makeCrcTables();
+
+static std::uint32_t crc32(const std::uint8_t* data, std::size_t length) {
+  std::uint32_t crc = 0xFFFFFFFFu;
+  for (; length >= 4; length -= 4, data += 4) {
+    crc ^= static_cast<std::uint32_t>(data[0]) 
+           | static_cast<std::uint32_t>(data[1]) << 8
+           | static_cast<std::uint32_t>(data[2]) << 16
+           | static_cast<std::uint32_t>(data[3]) << 24;
+    crc = kCrcTables[3][crc & 0xFF] ^ kCrcTables[2][(crc >> 8) & 0xFF]
+          ^ kCrcTables[1][(crc >> 16) & 0xFF] ^ kCrcTables[0][crc >> 24];
+  }
+  for (; length > 0; --length, ++data) {
+    crc = kCrcTables[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+// Adler-32 of two pieces of data joined, from the Adler-32 of each and the
+// length of the second. Each byte of the second piece adds the first
+// piece's sum to the second sum.
+static std::uint32_t adler32Combine(std::uint32_t first, std::uint32_t second,
+                                    std::size_t length) {
+  const std::uint64_t kModulus = 65521;
+  const std::uint64_t rem = length % kModulus;
+  const std::uint64_t a1 = first & 0xFFFF;
+  std::uint64_t a = (a1 + (second & 0xFFFF) + kModulus - 1) % kModulus;
+  std::uint64_t b = ((first >> 16) + (second >> 16) + rem * a1 + kModulus
+                     - rem) % kModulus;
+  return static_cast<std::uint32_t>(b << 16 | a);
+}
+
+// Bytes of the image going into the caller's buffer, with the chunks of
+// the PNG around the deflate stream.
+class PngBuffer : public Deflater {
+ public:
+  explicit PngBuffer(std::span<std::uint8_t> out) : Deflater(out) {}
+
+  void put32(std::uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      putByte(static_cast<std::uint8_t>(value >> shift));
+    }
+  }
+  void setAt32(std::size_t position, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      getData(position)[i] = static_cast<std::uint8_t>(value >> (24 - 8 * i));
+    }
+  }
+
+  // Fills in the length of the chunk at 'start' and adds its CRC.
+  void endChunk(std::size_t start) {
+    setAt32(start, static_cast<std::uint32_t>(getPosition() - start - 8));
+    put32(crc32(getData(start + 4), getPosition() - start - 4));
+  }
+}; // PngBuffer
+
+static const std::uint8_t kSignature[8] = {
+  0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'
+};
+
+// Writes the signature and the IHDR chunk, 1 bit grayscale with no
+// interlacing.
+static void putHeader(PngBuffer& out, std::uint32_t width,
+                      std::uint32_t height) {
+  out.putBytes(kSignature, sizeof kSignature);
+  std::size_t chunk = out.getPosition();
+  out.put32(0);
+  out.putBytes(reinterpret_cast<const std::uint8_t*>("IHDR"), 4);
+  out.put32(width);
+  out.put32(height);
+  out.putByte(1);
+  out.putByte(0);
+  out.putByte(0);
+  out.putByte(0);
+  out.putByte(0);
+  out.endChunk(chunk);
+}
+
+static void putEnd(PngBuffer& out) {
+  std::size_t chunk = out.getPosition();
+  out.put32(0);
+  out.putBytes(reinterpret_cast<const std::uint8_t*>("IEND"), 4);
+  out.endChunk(chunk);
+}
+
+// Compresses 'count' rows of 'bytes' bytes of pixels, 'stride' bytes apart,
+// as blocks that are not final and end on a byte boundary, so stripes made
+// on different threads can be joined. Returns the Adler-32 of the
+// scanlines.
+static std::uint32_t deflateStripe(PngBuffer& out, const std::uint8_t* pixels,
+                                   std::size_t bytes, std::size_t stride,
+                                   int count,
+                                   PngWriter::Compression compression) {
+  const std::size_t length = bytes + 1;
+  std::vector<std::uint8_t> scanlines(2 * length);
+  const std::uint8_t* above = nullptr;
+  std::uint8_t* row = scanlines.data();
+  std::uint32_t adler = 1;
+
+  if (compression == PngWriter::Compression::kRle) {
+    out.putBits(0, 1); // Not the final block
+    out.putBits(1, 2); // Fixed Huffman codes
+  }
+  for (int y = 0; y < count; ++y, pixels += stride) {
+    row[0] = 0;
+    std::copy(pixels, pixels + bytes, row + 1);
+    adler = Deflater::adler32(adler, row, length);
+    if (compression == PngWriter::Compression::kStored) {
+      for (std::size_t i = 0; i < length;) {
+        std::size_t block = std::min<std::size_t>(length - i, 65535);
+        out.putByte(0);
+        out.putByte(static_cast<std::uint8_t>(block));
+        out.putByte(static_cast<std::uint8_t>(block >> 8));
+        out.putByte(static_cast<std::uint8_t>(~block));
+        out.putByte(static_cast<std::uint8_t>(~block >> 8));
+        out.putBytes(row + i, block);
+        i += block;
+      }
+    } else {
+      out.putRow(row, above, length);
+    }
+    above = row;
+    row = row == scanlines.data() ? scanlines.data() + length
+                                  : scanlines.data();
+  }
+
+  // An empty stored block brings the stream to a byte boundary.
+  if (compression == PngWriter::Compression::kRle) {
+    out.putSymbol(256);
+    out.putBits(0, 3);
+    out.flushBits();
+    out.put32(0x0000FFFF);
+  }
+  return adler;
+}
+
+PngWriter::PngWriter(int scale, int quiet_zone, bool invert,
+                     Compression compression)
+    : upscaler_(scale, quiet_zone, invert), compression_(compression) {}
+
+// The signature, IHDR, IDAT and IEND chunks and the zlib header take 63
+// bytes. Stored blocks add 5 bytes each, fixed Huffman codes take at most 9
+// bits for each byte.
+std::size_t PngWriter::getMaxLength(const QRImage& image) const {
+  std::size_t raw =
+      (Upscaler::getRowLength(upscaler_.getWidth(image),
+                              Upscaler::Format::k1Bit) + 1)
+      * static_cast<std::size_t>(upscaler_.getHeight(image));
+  std::size_t deflated = compression_ == Compression::kStored
+                         ? raw + 5 * ((raw + 65534) / 65535)
+                         : Deflater::getMaxLength(raw);
+  return 63 + deflated;
+}
+
+std::size_t PngWriter::write(const QRImage& image,
+                             std::span<std::uint8_t> buffer) const {
+  const int scale = upscaler_.getScale();
+  const int blocks_high = image.getHeight() + 2 * upscaler_.getQuietZone();
+  const std::uint32_t width =
+      static_cast<std::uint32_t>(upscaler_.getWidth(image));
+  const std::uint32_t height =
+      static_cast<std::uint32_t>(upscaler_.getHeight(image));
+
+  PngBuffer out(buffer);
+  putHeader(out, width, height);
+
+  std::size_t chunk = out.getPosition();
+  out.put32(0);
+  out.putBytes(reinterpret_cast<const std::uint8_t*>("IDAT"), 4);
+  out.putByte(0x78);
+  out.putByte(0x01);
+
+  // Each scanline is a filter type of 0 and the pixels, 1 for white. A
+  // scanline is made for each row of blocks and used 'scale' times.
+  const std::size_t length = (width + 7) / 8 + 1;
+  const std::size_t raw = length * height;
+  std::vector<std::uint8_t> scanlines(2 * length);
+  const std::uint8_t* above = nullptr;
+  std::uint8_t* row = scanlines.data();
+  std::uint32_t adler = 1;
+  std::size_t stored_left = 0;
+  std::size_t raw_left = raw;
+
+  if (compression_ == Compression::kRle) {
+    out.putBits(1, 1); // Final block
+    out.putBits(1, 2); // Fixed Huffman codes
+  }
+  for (int y = 0; y < blocks_high; ++y) {
+    row[0] = 0;
+    upscaler_.drawRow(image, Upscaler::Format::k1Bit, y, row + 1);
+    for (int repeat = 0; repeat < scale; ++repeat) {
+      adler = Deflater::adler32(adler, row, length);
+      if (compression_ == Compression::kStored) {
+        for (std::size_t i = 0; i < length;) {
+          if (stored_left == 0) {
+            stored_left = std::min<std::size_t>(raw_left, 65535);
+            out.putByte(raw_left == stored_left ? 1 : 0);
+            out.putByte(static_cast<std::uint8_t>(stored_left));
+            out.putByte(static_cast<std::uint8_t>(stored_left >> 8));
+            out.putByte(static_cast<std::uint8_t>(~stored_left));
+            out.putByte(static_cast<std::uint8_t>(~stored_left >> 8));
+          }
+          std::size_t count = std::min(stored_left, length - i);
+          out.putBytes(row + i, count);
+          i += count;
+          stored_left -= count;
+          raw_left -= count;
+        }
+      } else {
+        out.putRow(row, above, length);
+      }
+      above = row;
+    }
+    row = row == scanlines.data() ? scanlines.data() + length
+                                  : scanlines.data();
+  }
+  if (compression_ == Compression::kRle) {
+    out.putSymbol(256); // End of block
+    out.flushBits();
+  }
+  out.put32(adler);
+  out.endChunk(chunk);
+  putEnd(out);
+  return out.getPosition();
+}
+
+void PngWriter::write(const QRImage& image, int fd) const {
+  QROutput::writeAll(fd, encode(image));
+}
+
+std::vector<std::uint8_t> PngWriter::encode(const QRImage& image) const {
+  std::vector<std::uint8_t> png(getMaxLength(image));
+  png.resize(write(image, png));
+  return png;
+}
+
+// Each stripe is an IDAT chunk of its own, with its CRC, so only joining
+// the chunks and the Adler-32 of the stripes is left to the caller. The
+// first chunk starts the zlib stream, and a last chunk ends it.
+std::vector<std::uint8_t> PngWriter::encodeRows(
+    std::span<const std::uint8_t> pixels, int width, int height,
+    std::size_t stride, Compression compression, ThreadPool* pool) {
+  const std::size_t bytes = (static_cast<std::size_t>(width) + 7) / 8;
+  if (width < 1 || height < 1 || stride < bytes
+      || pixels.size() < stride * (height - 1) + bytes) {
+    throw std::logic_error("Invalid image.");
+  }
+  if (pool == nullptr) {
+    pool = &ThreadPool::getDefault();
+  }
+  const int stripe_rows = std::max(
+      16, (height + 4 * pool->getNumThreads() - 1)
+          / (4 * pool->getNumThreads()));
+  const int stripes = (height + stripe_rows - 1) / stripe_rows;
+
+  struct Stripe {
+    std::vector<std::uint8_t> chunk; // IDAT chunk of the stripe
+    std::uint32_t adler;             // Adler-32 of its scanlines
+    std::size_t length;              // Length of its scanlines
+  }; // Stripe
+  std::vector<std::future<Stripe> > pending;
+  pending.reserve(stripes);
+  for (int i = 0; i < stripes; ++i) {
+    pending.push_back(pool->submit([=]() {
+      const int first = i * stripe_rows;
+      const int count = std::min(stripe_rows, height - first);
+      const std::size_t raw = (bytes + 1) * count;
+      Stripe stripe;
+      stripe.length = raw;
+      stripe.chunk.resize(64 + raw + raw / 8
+                          + 5 * count * ((bytes + 65535) / 65535));
+      PngBuffer out(stripe.chunk);
+      out.put32(0);
+      out.putBytes(reinterpret_cast<const std::uint8_t*>("IDAT"), 4);
+      if (i == 0) {
+        out.putByte(0x78);
+        out.putByte(0x01);
+      }
+      stripe.adler = deflateStripe(out, pixels.data() + first * stride, bytes,
+                                   stride, count, compression);
+      out.endChunk(0);
+      stripe.chunk.resize(out.getPosition());
+      return stripe;
+    }));
+  }
+
+  // Every stripe is waited for before an error is passed on, the tasks read
+  // the caller's pixels.
+  std::vector<Stripe> done;
+  done.reserve(stripes);
+  std::exception_ptr error;
+  for (auto& stripe : pending) {
+    try {
+      done.push_back(stripe.get());
+    } catch (...) {
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  std::size_t total = 128;
+  std::uint32_t adler = 1;
+  for (const auto& stripe : done) {
+    total += stripe.chunk.size();
+    adler = adler32Combine(adler, stripe.adler, stripe.length);
+  }
+  std::vector<std::uint8_t> png(total);
+  PngBuffer out(png);
+  putHeader(out, static_cast<std::uint32_t>(width),
+            static_cast<std::uint32_t>(height));
+  for (const auto& stripe : done) {
+    out.putBytes(stripe.chunk.data(), stripe.chunk.size());
+  }
+
+  // An empty final block and the Adler-32 end the stream.
+  std::size_t chunk = out.getPosition();
+  out.put32(0);
+  out.putBytes(reinterpret_cast<const std::uint8_t*>("IDAT"), 4);
+  out.putBits(1, 1);
+  out.putBits(1, 2);
+  out.putSymbol(256);
+  out.flushBits();
+  out.put32(adler);
+  out.endChunk(chunk);
+  putEnd(out);
+  png.resize(out.getPosition());
+  return png;
+}
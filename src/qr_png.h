@@ -0,0 +1,54 @@
+#ifndef QR_PNG_H_
+#define QR_PNG_H_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "qr_image.h"
+#include "qr_upscale.h"
+#include "thread_pool.h"
+
+// Writes codes as 1 bit grayscale PNG images, without any image library.
+// The scanlines are drawn by an Upscaler, each row of blocks once, and
+// compressed as they are made.
+class PngWriter {
+ public:
+  // How the image data is deflated.
+  enum class Compression {
+    kStored = 0, // Stored blocks, no compression
+    kRle,        // Fixed Huffman codes with runs and repeated scanlines
+  }; // Compression
+
+  // Each block is 'scale' pixels square, with 'quiet_zone' light blocks
+  // around the code. 'invert' draws dark blocks white on black.
+  explicit PngWriter(int scale = 4, int quiet_zone = 4, bool invert = false,
+                     Compression compression = Compression::kRle);
+
+  // Largest number of bytes the image can take, a buffer of this length is
+  // always large enough for write().
+  std::size_t getMaxLength(const QRImage&) const;
+
+  // Writes the image into the buffer and returns its length. Throws if the
+  // buffer is too small.
+  std::size_t write(const QRImage&, std::span<std::uint8_t>) const;
+
+  // Writes the image to the file descriptor.
+  void write(const QRImage&, int) const;
+
+  // Returns the image.
+  std::vector<std::uint8_t> encode(const QRImage&) const;
+
+  // Returns an image that is already drawn, 'height' rows of 'width' 1 bit
+  // pixels 'stride' bytes apart, such as an atlas. Stripes of rows are
+  // compressed on the pool at the same time, each in its own IDAT chunk.
+  static std::vector<std::uint8_t> encodeRows(
+      std::span<const std::uint8_t>, int width, int height, std::size_t stride,
+      Compression compression = Compression::kRle, ThreadPool* pool = nullptr);
+
+ private:
+  Upscaler upscaler_;       // Draws the scanlines
+  Compression compression_; // How the image data is deflated
+}; // PngWriter
+
+#endif // QR_PNG_H_
@@ -0,0 +1,962 @@
+#ifndef QR_STATIC_H_
+#define QR_STATIC_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "qr.h"
+
+// Constexpr encoding, Reed Solomon, placement and mask functions. QRCode and
+// BasicQRCode are both made with them. Nothing is allocated, so a QR code for
+// text known when building can be made by the compiler. Only QR codes
+// (versions 1-40) can be made here, the text is encoded the same way as
+// QRCode::Segment::makeSegments().
+class StaticQRCode {
+ public:
+  // Text given as a template argument, see makeStaticQRCode().
+  template <std::size_t N>
+  struct Text {
+    constexpr Text(const char (&text)[N]) {
+      for (std::size_t i = 0; i < N; ++i) {
+        data[i] = text[i];
+      }
+    }
+    constexpr std::string_view view() const {
+      return std::string_view(data, N - 1);
+    }
+
+    char data[N];
+  }; // Text
+
+  // Functions to determine type of text given. isByte() and isUtf8() check
+  // 16 characters at a time with SSE2 when they are not run by the compiler.
+  static constexpr bool isNumeric(std::string_view);
+  static constexpr bool isAlphanumeric(std::string_view);
+  static constexpr bool isByte(std::string_view);
+  static constexpr bool isUtf8(std::string_view);
+
+  // Encoding mode of the text, and the character count length for a version.
+  static constexpr int getEncodingMode(std::string_view);
+  static constexpr int getBitsPerChar(int, int);
+
+  // Bits used by the text in a version, including a UTF-8 ECI segment if one
+  // is needed, or -1 if there are too many characters for the version.
+  static constexpr int getTotalBits(std::string_view, int);
+
+  // Smallest version that fits the text, and the highest error correction
+  // level that fits it without increasing the version. findVersion() looks
+  // up to 'max_version' and returns 0 instead of throwing.
+  static constexpr int findVersion(std::string_view, QRCode::ErrCor,
+                                   int max_version = 40);
+  static constexpr int chooseVersion(std::string_view, QRCode::ErrCor);
+  static constexpr QRCode::ErrCor chooseErrCor(std::string_view, int,
+                                               QRCode::ErrCor);
+
+  // Appends the low 'len' bits of the value to the bytes at bit 'length'.
+  static constexpr void appendBits(std::uint8_t*, int&, std::uint32_t, int);
+
+  // Passes the data bits of text in numeric (1), alphanumeric (2) or byte
+  // (4) mode to append(value, length), a group at a time. The text must only
+  // hold characters of the mode.
+  template <typename Appender>
+  static constexpr void encodeText(int, std::string_view, Appender&&);
+
+  // Reed Solomon Math. A generator polynomial of degree 'n' is written as
+  // its 'n' coefficients after the leading term, and the EDC is the
+  // remainder of dividing the data codewords by it.
+  static constexpr std::uint8_t reedSolomonMult(std::uint8_t, std::uint8_t);
+  static constexpr void rsGeneratePoly(int, std::uint8_t*);
+  static constexpr void generateEDC(const std::uint8_t*, int,
+                                    const std::uint8_t*, int, std::uint8_t*);
+
+  // Mask pattern, penalty score of a 'width' x 'height' code and format
+  // bits. formatCode() adds the error correction bits to 5 bits of format
+  // data, or gives the 15 format bits of a QR code. versionCode() adds them
+  // to 6 bits of version data.
+  static constexpr bool maskBit(int, int, int);
+  template <typename Bitmap>
+  static constexpr long penaltyScore(const Bitmap&, int, int);
+  static constexpr int formatBits(QRCode::ErrCor);
+  static constexpr int formatCode(int);
+  static constexpr int formatCode(QRCode::ErrCor, int);
+  static constexpr long versionCode(int);
+
+  // Draw blocks with set(x, y, dark). A finder and its separator are cut off
+  // at the edges of a 'width' x 'height' code. drawPatterns() draws every
+  // function block of a QR code version. drawFormat() draws the format
+  // blocks of a QR code of the size, setting the 15 bits of each copy in
+  // order.
+  template <typename Setter>
+  static constexpr void drawFinder(int, int, int, int, Setter&&);
+  template <typename Setter>
+  static constexpr void drawAlignment(int, int, Setter&&);
+  template <typename Setter>
+  static constexpr void drawPatterns(int, QRCode::ErrCor, int, Setter&&);
+  template <typename Setter>
+  static constexpr void drawFormat(int, QRCode::ErrCor, int, Setter&&);
+  template <typename Setter>
+  static constexpr void drawVersion(int, Setter&&);
+
+  // Calls visit(x, y) for each block of a code 'height' blocks high that is
+  // not a function block, in the zig-zag order codewords are drawn in. The
+  // pairs of columns start at 'right', and column 6 is skipped if it holds
+  // the QR code timing blocks.
+  template <typename IsFunction, typename Visitor>
+  static constexpr void forEachDataBlock(int, int, bool, IsFunction&&,
+                                         Visitor&&);
+
+  // Makes the BasicQRCode for the smallest version that fits the text and
+  // passes it to 'visitor', returning what it returns. The code is made on
+  // the stack, the version picks which specialization is used.
+  template <typename Visitor>
+  static decltype(auto) visit(std::string_view, QRCode::ErrCor, int,
+                              Visitor&&);
+
+  // The same with a given version. Throws if the version is not 1 to 40 or
+  // the text does not fit it.
+  template <typename Visitor>
+  static decltype(auto) visit(int, std::string_view, QRCode::ErrCor, int,
+                              Visitor&&);
+
+  static constexpr int kMaxAlignments = 7;  // Most alignment rows or columns
+
+ private:
+  template <typename Visitor, int... Versions>
+  static decltype(auto) visitVersion(int, std::string_view, QRCode::ErrCor,
+                                     int, Visitor&,
+                                     std::integer_sequence<int, Versions...>);
+
+  static constexpr std::array<std::uint8_t, 256> rsGenerateExp();
+  static constexpr std::array<std::uint8_t, 256> rsGenerateLog();
+
+  static const std::array<std::uint8_t, 256> kRsExp_; // Exp values for RS
+  static const std::array<std::uint8_t, 256> kRsLog_; // Log values for RS
+}; // StaticQRCode
+
+// A QR code of a version known at compile time. The blocks are kept in fixed
+// size arrays and every function is constexpr, so the code can be made while
+// compiling or at run time without allocating.
+template <int Version>
+class BasicQRCode {
+  static_assert(Version >= 1 && Version <= 40, "Invalid version");
+
+ public:
+  static constexpr int kSize = (4 * Version) + 17;
+  static constexpr int kTotalCodewords = QRCode::getTotalModules(Version) >> 3;
+
+  // Blocks of the code, indexed by row then column.
+  using Bitmap = std::array<std::array<bool, kSize>, kSize>;
+
+  // Constructor, throws if the text does not fit in the version. In a
+  // constant expression the throw is a compile error.
+  constexpr BasicQRCode(std::string_view,
+                        QRCode::ErrCor err = QRCode::ErrCor::kLow,
+                        int msk = 0);
+
+  constexpr int getVersion() const { return Version; }
+  constexpr int getSize() const { return kSize; }
+  constexpr int getMask() const { return mask_; }
+  constexpr QRCode::ErrCor getErrCor() const { return correctionLevel_; }
+  constexpr bool getBlock(int x, int y) const { return blocks_[y][x]; }
+  constexpr const Bitmap& getBlocks() const { return blocks_; }
+
+ private:
+  using Codewords = std::array<std::uint8_t, kTotalCodewords>;
+
+  // Functions that set blocks and draws blocks.
+  constexpr void setFuncBlocks(int, int, bool);
+  constexpr void drawPatterns();
+  constexpr void drawFormat(int);
+  constexpr void drawCodewords(const Codewords&);
+  constexpr void mask(int);
+  template <int Mask>
+  constexpr void applyMask();
+  constexpr int chooseMask();
+
+  // Encoding functions. The error correction level is a template argument so
+  // the block structure is known when compiling.
+  constexpr Codewords encodeText(std::string_view) const;
+  constexpr Codewords addEDCInterleave(const Codewords&) const;
+  template <int Ecl>
+  constexpr Codewords addEDCInterleave(const Codewords&) const;
+
+  Bitmap blocks_{};                 // Blocks that make up the QR code
+  Bitmap funcBlock_{};              // Blocks that will not be masked
+  int mask_ = 0;                    // Mask pattern used
+  QRCode::ErrCor correctionLevel_;  // Correction level for QR Code
+}; // BasicQRCode
+
+// Makes the blocks of a QR code for the text while compiling, for example:
+//   constexpr auto kSupport = makeStaticQRCode<"https://example.com">();
+// The version is the smallest that fits, the mask is chosen by penalty score
+// unless one is given. Large versions with automatic masks may need a higher
+// -fconstexpr-ops-limit.
+template <StaticQRCode::Text kText,
+          QRCode::ErrCor kErr = QRCode::ErrCor::kLow,
+          int kMask = QRCode::kAutoMask>
+consteval auto makeStaticQRCode() {
+  constexpr int kVersion = StaticQRCode::chooseVersion(kText.view(), kErr);
+  return BasicQRCode<kVersion>(kText.view(), kErr, kMask).getBlocks();
+}
+
+// ---------------------- StaticQRCode Class ----------------------
+constexpr bool StaticQRCode::isNumeric(std::string_view text) {
+  for (const auto& ch : text) {
+    if (ch < '0' || ch > '9') {
+      return false;
+    }
+  }
+  return true;
+}
+
+constexpr bool StaticQRCode::isAlphanumeric(std::string_view text) {
+  for (const auto& ch : text) {
+    if (QRCode::kAlphanumericChar_.find(ch) == std::string_view::npos) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ASCII text can be put in byte mode without an ECI, since it is the same
+// in ISO-8859-1.
+constexpr bool StaticQRCode::isByte(std::string_view text) {
+  std::size_t i = 0;
+
+#if defined(__SSE2__)
+  // Check 16 characters at a time, the high bit of each is gathered into
+  // a mask which is only zero when all of them are ASCII.
+  if (!std::is_constant_evaluated()) {
+    for (; text.length() - i >= 16; i += 16) {
+      __m128i chunk = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(text.data() + i));
+      if (_mm_movemask_epi8(chunk) != 0) {
+        return false;
+      }
+    }
+  }
+#endif
+
+  for (; i < text.length(); ++i) {
+    if (static_cast<unsigned char>(text[i]) > 0x7F) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Checks that the text is well formed UTF-8, rejecting overlong forms,
+// surrogates and values past U+10FFFF.
+constexpr bool StaticQRCode::isUtf8(std::string_view text) {
+  std::size_t i = 0;
+  while (i < text.length()) {
+#if defined(__SSE2__)
+    // Skip over runs of ASCII 16 characters at a time.
+    if (!std::is_constant_evaluated() && text.length() - i >= 16
+        && _mm_movemask_epi8(_mm_loadu_si128(
+               reinterpret_cast<const __m128i*>(text.data() + i))) == 0) {
+      i += 16;
+      continue;
+    }
+#endif
+    unsigned char ch = static_cast<unsigned char>(text[i]);
+    if (ch < 0x80) {
+      ++i;
+      continue;
+    }
+
+    // Find the length of the sequence and the range of the second byte.
+    std::size_t length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+    if (ch >= 0xC2 && ch <= 0xDF) {
+      length = 2;
+    } else if (ch >= 0xE0 && ch <= 0xEF) {
+      length = 3;
+      if (ch == 0xE0) low = 0xA0;
+      if (ch == 0xED) high = 0x9F;
+    } else if (ch >= 0xF0 && ch <= 0xF4) {
+      length = 4;
+      if (ch == 0xF0) low = 0x90;
+      if (ch == 0xF4) high = 0x8F;
+    } else {
+      return false;
+    }
+
+    if (text.length() - i < length
+        || static_cast<unsigned char>(text[i + 1]) < low
+        || static_cast<unsigned char>(text[i + 1]) > high) {
+      return false;
+    }
+    for (std::size_t j = 2; j < length; ++j) {
+      unsigned char next = static_cast<unsigned char>(text[i + j]);
+      if (next < 0x80 || next > 0xBF) {
+        return false;
+      }
+    }
+    i += length;
+  }
+  return true;
+}
+
+constexpr int StaticQRCode::getEncodingMode(std::string_view text) {
+  return isNumeric(text) ? 1 : isAlphanumeric(text) ? 2 : 4;
+}
+
+constexpr int StaticQRCode::getBitsPerChar(int mode, int version) {
+  constexpr int kBitsPerChar[3][3] = {
+    // Version 1-9, 10-26, 27-40
+    { 10, 12, 14 }, // Numeric
+    {  9, 11, 13 }, // Alphanumeric
+    {  8, 16, 16 }, // Byte
+  };
+  int range = version < 10 ? 0 : version < 27 ? 1 : 2;
+  return kBitsPerChar[mode == 1 ? 0 : mode == 2 ? 1 : 2][range];
+}
+
+constexpr int StaticQRCode::getTotalBits(std::string_view text,
+                                         int version) {
+  int mode = getEncodingMode(text);
+  int count_bits = getBitsPerChar(mode, version);
+  int num_chars = static_cast<int>(text.length());
+  if (num_chars >= (1L << count_bits)) {
+    return -1;
+  }
+
+  // Numeric groups of three digits use 10 bits, alphanumeric pairs 11 bits.
+  int data_bits = mode == 1 ? num_chars / 3 * 10
+                              + (num_chars % 3 == 0 ? 0 : num_chars % 3 * 3 + 1)
+                  : mode == 2 ? num_chars / 2 * 11 + num_chars % 2 * 6
+                  : num_chars * 8;
+  int eci_bits = !isByte(text) && isUtf8(text) ? 4 + 8 : 0;
+  return eci_bits + 4 + count_bits + data_bits;
+}
+
+constexpr int StaticQRCode::findVersion(std::string_view text,
+                                        QRCode::ErrCor min_err_cor,
+                                        int max_version) {
+  for (int i = 1; i <= max_version && i <= 40; ++i) {
+    int used_bits = getTotalBits(text, i);
+    if (used_bits >= 0
+        && QRCode::getTotalCodewords(i, min_err_cor) * 8 >= used_bits) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+constexpr int StaticQRCode::chooseVersion(std::string_view text,
+                                          QRCode::ErrCor min_err_cor) {
+  int version = findVersion(text, min_err_cor);
+  if (version == 0) {
+    throw std::logic_error("String too long!");
+  }
+  return version;
+}
+
+constexpr QRCode::ErrCor StaticQRCode::chooseErrCor(
+    std::string_view text, int version, QRCode::ErrCor min_err_cor) {
+  int used_bits = getTotalBits(text, version);
+  for (int j = static_cast<int>(QRCode::ErrCor::kHigh);
+       used_bits >= 0 && j >= static_cast<int>(min_err_cor); --j) {
+    QRCode::ErrCor level = static_cast<QRCode::ErrCor>(j);
+    if (QRCode::getTotalCodewords(version, level) * 8 >= used_bits) {
+      return level;
+    }
+  }
+  throw std::logic_error("String too long!");
+}
+
+constexpr void StaticQRCode::appendBits(std::uint8_t* bytes, int& length,
+                                        std::uint32_t val, int len) {
+  for (int i = len - 1; i >= 0; --i, ++length) {
+    if (((val >> i) & 1) != 0) {
+      bytes[length >> 3] |= static_cast<std::uint8_t>(0x80 >> (length & 7));
+    }
+  }
+}
+
+// Numbers are split into groups of three digits of 10 bits, alphanumeric
+// characters into pairs of 11 bits mapped to their alphanumeric codes, and
+// bytes take 8 bits each.
+template <typename Appender>
+constexpr void StaticQRCode::encodeText(int mode, std::string_view text,
+                                        Appender&& append) {
+  if (mode == 1) {
+    for (std::size_t i = 0; i < text.length(); i += 3) {
+      std::uint32_t group = 0;
+      int digits = 0;
+      for (; digits < 3 && i + digits < text.length(); ++digits) {
+        group = group * 10 + (text[i + digits] - '0');
+      }
+      append(group, digits * 3 + 1);
+    }
+  } else if (mode == 2) {
+    for (std::size_t i = 0; i < text.length(); i += 2) {
+      std::uint32_t group =
+          static_cast<std::uint32_t>(QRCode::kAlphanumericChar_.find(text[i]));
+      if (i + 1 < text.length()) {
+        group = group * 45 + static_cast<std::uint32_t>(
+            QRCode::kAlphanumericChar_.find(text[i + 1]));
+        append(group, 11);
+      } else {
+        append(group, 6);
+      }
+    }
+  } else {
+    for (const auto& ch : text) {
+      append(static_cast<unsigned char>(ch), 8);
+    }
+  }
+}
+
+constexpr std::uint8_t StaticQRCode::reedSolomonMult(std::uint8_t x,
+                                                     std::uint8_t y) {
+  return x && y ? kRsExp_[(kRsLog_[x] + kRsLog_[y]) % 255] : 0;
+}
+
+// Generates the polynomial (x - 2^0)(x - 2^1)...(x - 2^(degree - 1)),
+// without its leading term.
+constexpr void StaticQRCode::rsGeneratePoly(int degree,
+                                            std::uint8_t* generator) {
+  for (int i = 0; i < degree; ++i) {
+    generator[i] = 0;
+  }
+  generator[degree - 1] = 1;
+  std::uint8_t root = 1;
+  for (int i = 0; i < degree; ++i) {
+    for (int j = 0; j < degree; ++j) {
+      generator[j] = reedSolomonMult(generator[j], root);
+      if (j + 1 < degree) {
+        generator[j] ^= generator[j + 1];
+      }
+    }
+    root = reedSolomonMult(root, 2);
+  }
+}
+
+// Writes the 'degree' error correction codewords for 'len' data codewords
+// to 'edc', dividing the data by the generator one codeword at a time.
+constexpr void StaticQRCode::generateEDC(const std::uint8_t* data, int len,
+                                         const std::uint8_t* generator,
+                                         int degree, std::uint8_t* edc) {
+  for (int i = 0; i < degree; ++i) {
+    edc[i] = 0;
+  }
+  for (int i = 0; i < len; ++i) {
+    std::uint8_t factor = data[i] ^ edc[0];
+    for (int j = 0; j + 1 < degree; ++j) {
+      edc[j] = edc[j + 1] ^ reedSolomonMult(generator[j], factor);
+    }
+    edc[degree - 1] = reedSolomonMult(generator[degree - 1], factor);
+  }
+}
+
+// Exponent and logarithmic tables for GF(256). More info can be found here:
+// https://en.wikiversity.org/wiki/Reed%E2%80%93Solomon_codes_for_coders#Multiplication
+constexpr std::array<std::uint8_t, 256> StaticQRCode::rsGenerateExp() {
+  std::array<std::uint8_t, 256> exp{};
+  for (int i = 0, val = 1; i < 256; ++i) {
+    exp[i] = static_cast<std::uint8_t>(val);
+    val = val > 127 ? ((val << 1) ^ 285) : (val << 1);
+  }
+  return exp;
+}
+
+constexpr std::array<std::uint8_t, 256> StaticQRCode::rsGenerateLog() {
+  std::array<std::uint8_t, 256> log{};
+  for (int i = 0, val = 1; i < 255; ++i) {
+    log[val] = static_cast<std::uint8_t>(i);
+    val = val > 127 ? ((val << 1) ^ 285) : (val << 1);
+  }
+  return log;
+}
+
+constexpr std::array<std::uint8_t, 256> StaticQRCode::kRsExp_ =
+    StaticQRCode::rsGenerateExp();
+constexpr std::array<std::uint8_t, 256> StaticQRCode::kRsLog_ =
+    StaticQRCode::rsGenerateLog();
+
+// The mask pattern algorithms can be found here:
+// https://www.thonky.com/qr-code-tutorial/mask-patterns
+constexpr bool StaticQRCode::maskBit(int mask, int x, int y) {
+  switch (mask) {
+    case 0: return (x + y) % 2 == 0;
+    case 1: return y % 2 == 0;
+    case 2: return x % 3 == 0;
+    case 3: return (x + y) % 3 == 0;
+    case 4: return (x / 3 + y / 2) % 2 == 0;
+    case 5: return x * y % 2 + x * y % 3 == 0;
+    case 6: return (x * y % 2 + x * y % 3) % 2 == 0;
+    case 7: return ((x + y) % 2 + x * y % 3) % 2 == 0;
+    default: throw std::logic_error("Invalid mask value.");
+  }
+}
+
+// Penalty score from the four rules in the QR Code specification, of the
+// blocks indexed by row then column.
+template <typename Bitmap>
+constexpr long StaticQRCode::penaltyScore(const Bitmap& blocks, int width,
+                                          int height) {
+  long penalty = 0;
+
+  // Rule 1 adds 3 for five blocks of the same color in a row or column, and 1
+  // more for each block after. Rule 3 adds 40 for each pattern that looks like
+  // a finder (dark, light, 3 dark, light, dark) with 4 light blocks before or
+  // after it. 'pass' 0 checks rows, 'pass' 1 checks columns.
+  for (int pass = 0; pass < 2; ++pass) {
+    int lines = pass == 0 ? height : width;
+    int length = pass == 0 ? width : height;
+    for (int i = 0; i < lines; ++i) {
+      int run = 0;
+      bool run_color = false;
+      int window = 0;
+      for (int j = 0; j < length; ++j) {
+        bool block = pass == 0 ? blocks[i][j] : blocks[j][i];
+        if (j > 0 && block == run_color) {
+          ++run;
+          if (run == 5) {
+            penalty += 3;
+          } else if (run > 5) {
+            ++penalty;
+          }
+        } else {
+          run = 1;
+          run_color = block;
+        }
+
+        window = ((window << 1) | (block ? 1 : 0)) & 0x7FF;
+        if (j >= 10 && (window == 0x5D0 || window == 0x05D)) {
+          penalty += 40;
+        }
+      }
+    }
+  }
+
+  // Rule 2 adds 3 for each 2x2 square of the same color.
+  int dark = 0;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      bool block = blocks[y][x];
+      dark += block ? 1 : 0;
+      if (x > 0 && y > 0 && block == blocks[y][x - 1]
+          && block == blocks[y - 1][x] && block == blocks[y - 1][x - 1]) {
+        penalty += 3;
+      }
+    }
+  }
+
+  // Rule 4 adds 10 for every 5% the dark blocks are away from 50%.
+  long total = static_cast<long>(width) * height;
+  long balance = dark * 100L - total * 50;
+  penalty += (balance < 0 ? -balance : balance) / (total * 5) * 10;
+  return penalty;
+}
+
+// Returns a value from 0 to 3 depending on error correction level.
+constexpr int StaticQRCode::formatBits(QRCode::ErrCor errorCorrectionLevel) {
+  switch (errorCorrectionLevel) {
+    case QRCode::ErrCor::kLow      : return 1;
+    case QRCode::ErrCor::kMedium   : return 0;
+    case QRCode::ErrCor::kQuartile : return 3;
+    case QRCode::ErrCor::kHigh     : return 2;
+    default: throw std::logic_error("Invalid ECL");
+  }
+}
+
+// Divides the 5 data bits by the polynomial x^10 + x^8 + x^5 + x^4 + x^2 +
+// x + 1, and puts the remainder after them.
+constexpr int StaticQRCode::formatCode(int data) {
+  int remainder = data;
+  for (int i = 0; i < 10; ++i) {
+    remainder = (remainder << 1) ^ ((remainder >> 9) * 0x537);
+  }
+  return data << 10 | remainder;
+}
+
+// The error correction level and mask, XORed with 21522.
+constexpr int StaticQRCode::formatCode(QRCode::ErrCor errorCorrectionLevel,
+                                       int mask) {
+  return formatCode(formatBits(errorCorrectionLevel) << 3 | mask) ^ 0x5412;
+}
+
+// The 6 data bits followed by the 12 bit remainder of dividing them by
+// x^12 + x^11 + x^10 + x^9 + x^8 + x^5 + x^2 + 1.
+constexpr long StaticQRCode::versionCode(int data) {
+  int remainder = data;
+  for (int i = 0; i < 12; ++i) {
+    remainder = (remainder << 1) ^ ((remainder >> 11) * 0x1F25);
+  }
+  return static_cast<long>(data) << 12 | remainder;
+}
+
+// Finder blocks centered on (x, y), with the light separator around them.
+template <typename Setter>
+constexpr void StaticQRCode::drawFinder(int x, int y, int width, int height,
+                                        Setter&& set) {
+  for (int distance_y = -4; distance_y <= 4; ++distance_y) {
+    for (int distance_x = -4; distance_x <= 4; ++distance_x) {
+      int distance = std::max(distance_x < 0 ? -distance_x : distance_x,
+                              distance_y < 0 ? -distance_y : distance_y);
+      int block_x = x + distance_x;
+      int block_y = y + distance_y;
+      if (0 <= block_x && block_x < width && 0 <= block_y
+          && block_y < height) {
+        set(block_x, block_y, distance != 2 && distance != 4);
+      }
+    }
+  }
+}
+
+template <typename Setter>
+constexpr void StaticQRCode::drawAlignment(int x, int y, Setter&& set) {
+  for (int distance_y = -2; distance_y <= 2; ++distance_y) {
+    for (int distance_x = -2; distance_x <= 2; ++distance_x) {
+      int distance = std::max(distance_x < 0 ? -distance_x : distance_x,
+                              distance_y < 0 ? -distance_y : distance_y);
+      set(x + distance_x, y + distance_y, distance != 1);
+    }
+  }
+}
+
+// Draws all timing blocks, finder blocks, aligment blocks, format blocks,
+// and version blocks.
+template <typename Setter>
+constexpr void StaticQRCode::drawPatterns(int version,
+                                          QRCode::ErrCor errorCorrectionLevel,
+                                          int mask, Setter&& set) {
+  const int size = (4 * version) + 17;
+
+  // Timing blocks are in row 6 and column 6, alternating dark and light.
+  for (int i = 0; i < size; ++i) {
+    set(i, 6, i % 2 == 0);
+    set(6, i, i % 2 == 0);
+  }
+
+  drawFinder(3, 3, size, size, set);
+  drawFinder(size - 4, 3, size, size, set);
+  drawFinder(3, size - 4, size, size, set);
+
+  // Alignment blocks go wherever two alignment tracks cross, except on the
+  // finders. The step between tracks is rounded up to an even number,
+  // version 32 is the only exception to the rule.
+  if (version > 1) {
+    int intervals = version / 7 + 1;
+    int distance = 4 * version + 4;
+    int step = version == 32 ? 26
+               : (distance + 2 * intervals - 1) / (2 * intervals) * 2;
+    int tracks[kMaxAlignments] = { 6 };
+    for (int i = 0; i < intervals; ++i) {
+      tracks[i + 1] = distance + 6 - (intervals - 1 - i) * step;
+    }
+    for (int i = 0; i <= intervals; ++i) {
+      for (int j = 0; j <= intervals; ++j) {
+        if (!((i == 0 && j == 0) || (i == 0 && j == intervals)
+            || (i == intervals && j == 0))) {
+          drawAlignment(tracks[i], tracks[j], set);
+        }
+      }
+    }
+  }
+
+  drawFormat(size, errorCorrectionLevel, mask, set);
+  drawVersion(version, set);
+}
+
+// One copy of the format bits goes around the top left finder, skipping the
+// timing blocks. The other is split between the top right and bottom left
+// finders, next to the single dark block.
+template <typename Setter>
+constexpr void StaticQRCode::drawFormat(int size,
+                                        QRCode::ErrCor errorCorrectionLevel,
+                                        int mask, Setter&& set) {
+  int bits = formatCode(errorCorrectionLevel, mask);
+  for (int i = 0; i <= 5; ++i) {
+    set(8, i, ((bits >> i) & 1) != 0);
+  }
+  set(8, 7, ((bits >> 6) & 1) != 0);
+  set(8, 8, ((bits >> 7) & 1) != 0);
+  set(7, 8, ((bits >> 8) & 1) != 0);
+  for (int i = 9; i < 15; ++i) {
+    set(14 - i, 8, ((bits >> i) & 1) != 0);
+  }
+
+  for (int i = 0; i < 8; ++i) {
+    set(size - 1 - i, 8, ((bits >> i) & 1) != 0);
+  }
+  for (int i = 8; i < 15; ++i) {
+    set(8, size - 15 + i, ((bits >> i) & 1) != 0);
+  }
+  set(8, size - 8, true);
+}
+
+// Places the 18 version bits of versions 7 - 40 in a 6x3 rectangle above the
+// bottom left finder, and a 3x6 rectangle left of the top right finder.
+template <typename Setter>
+constexpr void StaticQRCode::drawVersion(int version, Setter&& set) {
+  if (version < 7) {
+    return;
+  }
+  const int size = (4 * version) + 17;
+  long version_bits = versionCode(version);
+  for (int i = 0; i < 18; ++i) {
+    set(size - 11 + i % 3, i / 3, ((version_bits >> i) & 1) != 0);
+    set(i / 3, size - 11 + i % 3, ((version_bits >> i) & 1) != 0);
+  }
+}
+
+// Starting from the bottom right corner, goes up and down two columns at a
+// time.
+template <typename IsFunction, typename Visitor>
+constexpr void StaticQRCode::forEachDataBlock(int height, int right,
+                                              bool timing,
+                                              IsFunction&& isFunction,
+                                              Visitor&& visit) {
+  bool up = true;
+  for (; right >= 1; right -= 2, up = !up) {
+    if (right == 6 && timing) {
+      right = 5;
+    }
+    for (int vert = 0; vert < height; ++vert) {
+      for (int j = 0; j < 2; ++j) {
+        int x = right - j;
+        int y = up ? height - 1 - vert : vert;
+        if (!isFunction(x, y)) {
+          visit(x, y);
+        }
+      }
+    }
+  }
+}
+
+// ---------------------- BasicQRCode Class ----------------------
+template <int Version>
+constexpr BasicQRCode<Version>::BasicQRCode(std::string_view text,
+                                            QRCode::ErrCor err, int msk):
+    correctionLevel_(StaticQRCode::chooseErrCor(text, Version, err)) {
+  if (msk != QRCode::kAutoMask && (msk < 0 || msk >= 8)) {
+    msk = 0;
+  }
+  mask_ = msk == QRCode::kAutoMask ? 0 : msk;
+  drawPatterns();
+  drawCodewords(addEDCInterleave(encodeText(text)));
+  if (msk == QRCode::kAutoMask) {
+    mask_ = chooseMask();
+    drawFormat(mask_);
+  }
+  mask(mask_);
+}
+
+template <int Version>
+constexpr void BasicQRCode<Version>::setFuncBlocks(int x, int y,
+                                                   bool isBlock) {
+  blocks_[y][x] = isBlock;
+  funcBlock_[y][x] = true;
+}
+
+template <int Version>
+constexpr void BasicQRCode<Version>::drawPatterns() {
+  StaticQRCode::drawPatterns(Version, correctionLevel_, mask_,
+                             [this](int x, int y, bool dark) {
+    setFuncBlocks(x, y, dark);
+  });
+}
+
+template <int Version>
+constexpr void BasicQRCode<Version>::drawFormat(int mask) {
+  StaticQRCode::drawFormat(kSize, correctionLevel_, mask,
+                           [this](int x, int y, bool dark) {
+    setFuncBlocks(x, y, dark);
+  });
+}
+
+template <int Version>
+constexpr void BasicQRCode<Version>::drawCodewords(const Codewords& data) {
+  int i = 0;
+  StaticQRCode::forEachDataBlock(kSize, kSize - 1, true,
+                                 [this](int x, int y) {
+    return funcBlock_[y][x];
+  }, [this, &data, &i](int x, int y) {
+    if (i < kTotalCodewords * 8) {
+      blocks_[y][x] = ((data[i >> 3] >> (7 - (i & 7))) & 1) != 0;
+      ++i;
+    }
+  });
+}
+
+// Applies a mask to the data bits. Each mask pattern has its own loop so the
+// pattern is not looked up for every block.
+template <int Version>
+constexpr void BasicQRCode<Version>::mask(int mask) {
+  switch (mask) {
+    case 0: applyMask<0>(); break;
+    case 1: applyMask<1>(); break;
+    case 2: applyMask<2>(); break;
+    case 3: applyMask<3>(); break;
+    case 4: applyMask<4>(); break;
+    case 5: applyMask<5>(); break;
+    case 6: applyMask<6>(); break;
+    case 7: applyMask<7>(); break;
+    default: throw std::logic_error("Invalid mask.");
+  }
+}
+
+template <int Version>
+template <int Mask>
+constexpr void BasicQRCode<Version>::applyMask() {
+  for (int y = 0; y < kSize; ++y) {
+    for (int x = 0; x < kSize; ++x) {
+      blocks_[y][x] = blocks_[y][x]
+                      ^ (StaticQRCode::maskBit(Mask, x, y) & !funcBlock_[y][x]);
+    }
+  }
+}
+
+// Tries each mask and returns the one with the lowest penalty score.
+template <int Version>
+constexpr int BasicQRCode<Version>::chooseMask() {
+  int best_mask = 0;
+  long best_score = 0;
+  for (int i = 0; i < 8; ++i) {
+    drawFormat(i);
+    mask(i);
+    long score = StaticQRCode::penaltyScore(blocks_, kSize, kSize);
+    if (i == 0 || score < best_score) {
+      best_mask = i;
+      best_score = score;
+    }
+    mask(i); // XOR the mask again to remove it.
+  }
+  return best_mask;
+}
+
+// Encodes the text with its mode, character count and data bits, then adds
+// the terminator and padding.
+template <int Version>
+constexpr typename BasicQRCode<Version>::Codewords
+BasicQRCode<Version>::encodeText(std::string_view text) const {
+  Codewords data{};
+  int length = 0;
+  int mode = StaticQRCode::getEncodingMode(text);
+  if (mode == 4 && !StaticQRCode::isByte(text)
+      && StaticQRCode::isUtf8(text)) {
+    StaticQRCode::appendBits(data.data(), length, 7, 4);
+    StaticQRCode::appendBits(data.data(), length, QRCode::kEciUtf8, 8);
+  }
+  StaticQRCode::appendBits(data.data(), length, mode, 4);
+  StaticQRCode::appendBits(data.data(), length,
+                           static_cast<std::uint32_t>(text.length()),
+                           StaticQRCode::getBitsPerChar(mode, Version));
+
+  StaticQRCode::encodeText(mode, text,
+                           [&data, &length](std::uint32_t value, int len) {
+    StaticQRCode::appendBits(data.data(), length, value, len);
+  });
+
+  // Add the terminator if possible, then pad to a byte and fill the rest
+  // with padding bytes.
+  int capacity = QRCode::getTotalCodewords(Version, correctionLevel_) * 8;
+  length += std::min(4, capacity - length);
+  length = (length + 7) / 8 * 8;
+  for (std::uint8_t byte = 0xEC; length < capacity; byte ^= 0xEC ^ 0x11) {
+    StaticQRCode::appendBits(data.data(), length, byte, 8);
+  }
+  return data;
+}
+
+// Splits data into blocks, appends EDC, and interleaves the codewords.
+template <int Version>
+constexpr typename BasicQRCode<Version>::Codewords
+BasicQRCode<Version>::addEDCInterleave(const Codewords& data) const {
+  switch (correctionLevel_) {
+    case QRCode::ErrCor::kLow      : return addEDCInterleave<0>(data);
+    case QRCode::ErrCor::kMedium   : return addEDCInterleave<1>(data);
+    case QRCode::ErrCor::kQuartile : return addEDCInterleave<2>(data);
+    case QRCode::ErrCor::kHigh     : return addEDCInterleave<3>(data);
+    default: throw std::logic_error("Invalid ECL");
+  }
+}
+
+template <int Version>
+template <int Ecl>
+constexpr typename BasicQRCode<Version>::Codewords
+BasicQRCode<Version>::addEDCInterleave(const Codewords& data) const {
+  constexpr int kNumBlocks = QRCode::kErr_corr_blocks_[Ecl][Version];
+  constexpr int kECCPerBlock = QRCode::kEC_codewords_per_block_[Ecl][Version];
+  constexpr int kNumShortBlocks = kNumBlocks - kTotalCodewords % kNumBlocks;
+  constexpr int kShortDataLen = kTotalCodewords / kNumBlocks - kECCPerBlock;
+  constexpr int kDataCodewords = kTotalCodewords - kNumBlocks * kECCPerBlock;
+  std::uint8_t generator[kECCPerBlock] = {};
+  StaticQRCode::rsGeneratePoly(kECCPerBlock, generator);
+
+  // Data codewords are taken from each block in turn, the last data codeword
+  // of the long blocks comes after all the others. The EDC follows.
+  Codewords result{};
+  for (int i = 0, j = 0; i < kNumBlocks; ++i) {
+    int len = kShortDataLen + (i < kNumShortBlocks ? 0 : 1);
+    for (int k = 0; k < kShortDataLen; ++k) {
+      result[k * kNumBlocks + i] = data[j + k];
+    }
+    if (i >= kNumShortBlocks) {
+      result[kShortDataLen * kNumBlocks + i - kNumShortBlocks] =
+          data[j + kShortDataLen];
+    }
+
+    std::uint8_t edc[kECCPerBlock] = {};
+    StaticQRCode::generateEDC(data.data() + j, len, generator, kECCPerBlock,
+                              edc);
+    for (int k = 0; k < kECCPerBlock; ++k) {
+      result[kDataCodewords + k * kNumBlocks + i] = edc[k];
+    }
+    j += len;
+  }
+  return result;
+}
+
+template <typename Visitor>
+decltype(auto) StaticQRCode::visit(std::string_view text, QRCode::ErrCor err,
+                                   int msk, Visitor&& visitor) {
+  return visitVersion(chooseVersion(text, err), text, err, msk, visitor,
+                      std::make_integer_sequence<int, 40>());
+}
+
+template <typename Visitor>
+decltype(auto) StaticQRCode::visit(int version, std::string_view text,
+                                   QRCode::ErrCor err, int msk,
+                                   Visitor&& visitor) {
+  return visitVersion(version, text, err, msk, visitor,
+                      std::make_integer_sequence<int, 40>());
+}
+
+// Looks up the function for the version in a table with one entry for each
+// BasicQRCode specialization.
+template <typename Visitor, int... Versions>
+decltype(auto) StaticQRCode::visitVersion(
+    int version, std::string_view text, QRCode::ErrCor err, int msk,
+    Visitor& visitor, std::integer_sequence<int, Versions...>) {
+  using Result = std::invoke_result_t<Visitor&, const BasicQRCode<1>&>;
+  using Function = Result (*)(std::string_view, QRCode::ErrCor, int,
+                              Visitor&);
+  static constexpr Function kVersions[] = {
+    [](std::string_view text, QRCode::ErrCor err, int msk,
+       Visitor& visitor) -> Result {
+      return visitor(BasicQRCode<Versions + 1>(text, err, msk));
+    }...
+  };
+  if (version < 1 || version > static_cast<int>(sizeof...(Versions))) {
+    throw std::logic_error("Invalid version.");
+  }
+  return kVersions[version - 1](text, err, msk, visitor);
+}
+
+#endif // QR_STATIC_H_
@@ -0,0 +1,264 @@
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "qr_output.h"
+#include "qr_stl.h"
+
+// Bytes of the header and triangle count, and of each triangle.
+static const std::size_t kHeaderLength = 84;
+static const std::size_t kTriangleLength = 50;
+
+// A corner of a triangle, or a normal.
+struct StlVertex {
+  float x;
+  float y;
+  float z;
+}; // StlVertex
+
+// Writes little endian triangles into the buffer.
+class StlBuffer {
+ public:
+  explicit StlBuffer(std::span<std::uint8_t> buffer)
+      : buffer_(buffer), position_(kHeaderLength), triangles_(0) {
+    if (buffer.size() < kHeaderLength) {
+      throw std::logic_error("Buffer too small.");
+    }
+  }
+
+  std::size_t getPosition() const { return position_; }
+
+  // Writes the header and the number of triangles, once they are all in.
+  void finish() {
+    static const char kHeader[] = "QR code, binary STL";
+    std::memset(buffer_.data(), ' ', 80);
+    std::memcpy(buffer_.data(), kHeader, sizeof kHeader - 1);
+    putAt32(80, triangles_);
+  }
+
+  // Rectangle of corners 'a' - 'd', counter clockwise seen from outside, as
+  // two triangles. Throws if there is no room for them.
+  void putQuad(const StlVertex& normal, const StlVertex& a,
+               const StlVertex& b, const StlVertex& c, const StlVertex& d) {
+    if (buffer_.size() - position_ < 2 * kTriangleLength) {
+      throw std::logic_error("Buffer too small.");
+    }
+    putTriangle(normal, a, b, c);
+    putTriangle(normal, a, c, d);
+  }
+
+ private:
+  void putTriangle(const StlVertex& normal, const StlVertex& a,
+                   const StlVertex& b, const StlVertex& c) {
+    for (const StlVertex* vertex : {&normal, &a, &b, &c}) {
+      putFloat(vertex->x);
+      putFloat(vertex->y);
+      putFloat(vertex->z);
+    }
+    buffer_[position_++] = 0;
+    buffer_[position_++] = 0;
+    ++triangles_;
+  }
+
+  void putFloat(float value) {
+    putAt32(position_, std::bit_cast<std::uint32_t>(value));
+    position_ += 4;
+  }
+
+  void putAt32(std::size_t at, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+      buffer_[at + i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+  }
+
+  std::span<std::uint8_t> buffer_; // Mesh
+  std::size_t position_;           // Bytes written
+  std::uint32_t triangles_;        // Triangles written
+}; // StlBuffer
+
+// Calls 'visit' with the boundary, first block and length of each run of
+// edges between a dark and a light block, across the rows. Boundary 'b' is
+// above row 'b', and 'below' is whether the dark block is in row 'b'.
+template <typename Visitor>
+static void forEachEdge(const QRImage& image, Visitor&& visit) {
+  const int stride = image.getStride();
+  std::vector<std::uint8_t> above(stride);
+  std::vector<std::uint8_t> below(stride);
+  for (int b = 0; b <= image.getHeight(); ++b) {
+    for (int i = 0; i < stride; ++i) {
+      const std::uint8_t up = b > 0 ? image.getRow(b - 1)[i] : 0;
+      const std::uint8_t down = b < image.getHeight() ? image.getRow(b)[i]
+                                                      : 0;
+      above[i] = up & ~down;
+      below[i] = down & ~up;
+    }
+    QRImage(above, image.getWidth(), 1).forEachRun(0,
+        [&](int first, int length) {
+          visit(b, first, length, false);
+        });
+    QRImage(below, image.getWidth(), 1).forEachRun(0,
+        [&](int first, int length) {
+          visit(b, first, length, true);
+        });
+  }
+}
+
+// Calls 'visit' with the normal and corners of each face of the mesh. The
+// tops of the dark blocks, and the bottoms without a plate, are the
+// rectangles of the code. The walls are the runs of edges between dark and
+// light blocks, found across the rows of the code and of its transpose, so
+// each is as long as it can be. The top of the plate is the rectangles of
+// its light blocks. The plate's bottom left corner is at the origin, with
+// the top row of the code furthest along y.
+template <typename Visitor>
+static void forEachFace(const QRImage& image, const StlSettings& settings,
+                        Visitor&& visit) {
+  const double size = settings.block_size;
+  const int quiet_zone = settings.quiet_zone;
+  const int rows = image.getHeight() + quiet_zone;
+  const float low = static_cast<float>(settings.base);
+  const float high = static_cast<float>(settings.base + settings.height);
+  auto getX = [size, quiet_zone](int x) {
+    return static_cast<float>((quiet_zone + x) * size);
+  };
+  auto getY = [size, rows](int y) {
+    return static_cast<float>((rows - y) * size);
+  };
+
+  image.forEachRectangle([&](int x, int y, int width, int height) {
+    const float x0 = getX(x), x1 = getX(x + width);
+    const float y0 = getY(y + height), y1 = getY(y);
+    visit(StlVertex{0, 0, 1}, StlVertex{x0, y0, high},
+          StlVertex{x1, y0, high}, StlVertex{x1, y1, high},
+          StlVertex{x0, y1, high});
+    if (settings.base == 0) {
+      visit(StlVertex{0, 0, -1}, StlVertex{x0, y0, 0},
+            StlVertex{x0, y1, 0}, StlVertex{x1, y1, 0},
+            StlVertex{x1, y0, 0});
+    }
+  });
+
+  forEachEdge(image, [&](int b, int first, int length, bool below) {
+    const float x0 = getX(first), x1 = getX(first + length);
+    const float y = getY(b);
+    if (below) {
+      visit(StlVertex{0, 1, 0}, StlVertex{x1, y, low}, StlVertex{x0, y, low},
+            StlVertex{x0, y, high}, StlVertex{x1, y, high});
+    } else {
+      visit(StlVertex{0, -1, 0}, StlVertex{x0, y, low},
+            StlVertex{x1, y, low}, StlVertex{x1, y, high},
+            StlVertex{x0, y, high});
+    }
+  });
+
+  // Rows of the transpose are the columns of the code.
+  const int columns = image.getWidth();
+  const int transpose_stride = (image.getHeight() + 7) / 8;
+  std::vector<std::uint8_t> transpose(
+      static_cast<std::size_t>(transpose_stride) * columns, 0);
+  for (int y = 0; y < image.getHeight(); ++y) {
+    image.forEachRun(y, [&](int first, int length) {
+      for (int x = first; x < first + length; ++x) {
+        transpose[x * transpose_stride + (y >> 3)] |= 0x80 >> (y & 7);
+      }
+    });
+  }
+  forEachEdge(QRImage(transpose, image.getHeight(), columns),
+              [&](int b, int first, int length, bool right) {
+    const float x = getX(b);
+    const float y0 = getY(first + length), y1 = getY(first);
+    if (right) {
+      visit(StlVertex{-1, 0, 0}, StlVertex{x, y1, low},
+            StlVertex{x, y0, low}, StlVertex{x, y0, high},
+            StlVertex{x, y1, high});
+    } else {
+      visit(StlVertex{1, 0, 0}, StlVertex{x, y0, low}, StlVertex{x, y1, low},
+            StlVertex{x, y1, high}, StlVertex{x, y0, high});
+    }
+  });
+
+  if (settings.base == 0) {
+    return;
+  }
+  const int width = image.getWidth() + 2 * quiet_zone;
+  const int height = image.getHeight() + 2 * quiet_zone;
+  const float x1 = static_cast<float>(width * size);
+  const float y1 = static_cast<float>(height * size);
+  visit(StlVertex{0, 0, -1}, StlVertex{0, 0, 0}, StlVertex{0, y1, 0},
+        StlVertex{x1, y1, 0}, StlVertex{x1, 0, 0});
+  visit(StlVertex{0, -1, 0}, StlVertex{0, 0, 0}, StlVertex{x1, 0, 0},
+        StlVertex{x1, 0, low}, StlVertex{0, 0, low});
+  visit(StlVertex{0, 1, 0}, StlVertex{x1, y1, 0}, StlVertex{0, y1, 0},
+        StlVertex{0, y1, low}, StlVertex{x1, y1, low});
+  visit(StlVertex{-1, 0, 0}, StlVertex{0, y1, 0}, StlVertex{0, 0, 0},
+        StlVertex{0, 0, low}, StlVertex{0, y1, low});
+  visit(StlVertex{1, 0, 0}, StlVertex{x1, 0, 0}, StlVertex{x1, y1, 0},
+        StlVertex{x1, y1, low}, StlVertex{x1, 0, low});
+
+  // The plate's light blocks, the code's rows moved in by the quiet zone.
+  const int plate_stride = (width + 7) / 8;
+  std::vector<std::uint8_t> plate(
+      static_cast<std::size_t>(plate_stride) * height, 0xFF);
+  for (int y = 0; y < image.getHeight(); ++y) {
+    std::uint8_t* row = plate.data() + (y + quiet_zone) * plate_stride;
+    image.forEachRun(y, [&](int first, int length) {
+      for (int x = quiet_zone + first; x < quiet_zone + first + length; ++x) {
+        row[x >> 3] &= ~(0x80 >> (x & 7));
+      }
+    });
+  }
+  QRImage(plate, width, height).forEachRectangle(
+      [&](int x, int y, int rectangle_width, int rectangle_height) {
+        const float x0 = getX(x - quiet_zone);
+        const float x1 = getX(x - quiet_zone + rectangle_width);
+        const float y0 = getY(y - quiet_zone + rectangle_height);
+        const float y1 = getY(y - quiet_zone);
+        visit(StlVertex{0, 0, 1}, StlVertex{x0, y0, low},
+              StlVertex{x1, y0, low}, StlVertex{x1, y1, low},
+              StlVertex{x0, y1, low});
+      });
+}
+
+StlWriter::StlWriter(const StlSettings& settings) : settings_(settings) {
+  if (!(settings.block_size > 0) || !(settings.height > 0)
+      || !(settings.base >= 0)) {
+    throw std::logic_error("Invalid size.");
+  }
+  if (settings.quiet_zone < 0) {
+    throw std::logic_error("Invalid quiet zone.");
+  }
+}
+
+std::size_t StlWriter::getLength(const QRImage& image) const {
+  std::size_t faces = 0;
+  forEachFace(image, settings_, [&faces](const StlVertex&, const StlVertex&,
+                                         const StlVertex&, const StlVertex&,
+                                         const StlVertex&) {
+    ++faces;
+  });
+  return kHeaderLength + 2 * faces * kTriangleLength;
+}
+
+std::size_t StlWriter::write(const QRImage& image,
+                             std::span<std::uint8_t> buffer) const {
+  StlBuffer out(buffer);
+  forEachFace(image, settings_, [&out](const StlVertex& normal,
+                                       const StlVertex& a, const StlVertex& b,
+                                       const StlVertex& c,
+                                       const StlVertex& d) {
+    out.putQuad(normal, a, b, c, d);
+  });
+  out.finish();
+  return out.getPosition();
+}
+
+std::vector<std::uint8_t> StlWriter::encode(const QRImage& image) const {
+  std::vector<std::uint8_t> mesh(getLength(image));
+  write(image, mesh);
+  return mesh;
+}
+
+void StlWriter::write(const QRImage& image, int fd) const {
+  QROutput::writeAll(fd, encode(image));
+}
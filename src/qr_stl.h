@@ -0,0 +1,45 @@
+#ifndef QR_STL_H_
+#define QR_STL_H_
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "qr_image.h"
+
+// Size of a printed or molded tag.
+struct StlSettings {
+  double block_size = 1; // Millimeters across a block
+  double height = 1;     // Millimeters the dark blocks stand up
+  double base = 0;       // Millimeters of plate under the code, 0 for none
+  int quiet_zone = 4;    // Blocks of plate around the code
+}; // StlSettings
+
+// Writes binary STL meshes of the dark blocks of a code, raised from the
+// plate if there is one. Only the outside of the blocks is written, and
+// each face is as large as it can be: the tops are the rectangles of the
+// code, and each wall runs the length of an edge between dark and light
+// blocks. A code takes about a third of the triangles of a box for each
+// dark block.
+class StlWriter {
+ public:
+  explicit StlWriter(const StlSettings& settings = StlSettings());
+
+  // Length of the mesh in bytes.
+  std::size_t getLength(const QRImage&) const;
+
+  // Writes the mesh into the buffer, such as one of getLength() bytes, and
+  // returns its length. Throws if the buffer is too small.
+  std::size_t write(const QRImage&, std::span<std::uint8_t>) const;
+
+  // Returns the mesh.
+  std::vector<std::uint8_t> encode(const QRImage&) const;
+
+  // Writes the mesh to the file descriptor.
+  void write(const QRImage&, int) const;
+
+ private:
+  StlSettings settings_; // Size of the tag
+}; // StlWriter
+
+#endif // QR_STL_H_
@@ -0,0 +1,74 @@
+#include <charconv>
+#include <stdexcept>
+
+#include "qr_output.h"
+#include "qr_svg.h"
+
+static void appendNumber(std::string& out, int value) {
+  char digits[12];
+  char* end = std::to_chars(digits, digits + sizeof digits, value).ptr;
+  out.append(digits, end);
+}
+
+SvgWriter::SvgWriter(int scale, int quiet_zone, bool invert)
+    : scale_(scale), quiet_zone_(quiet_zone), invert_(invert) {
+  if (scale < 1) {
+    throw std::logic_error("Invalid scale.");
+  }
+  if (quiet_zone < 0) {
+    throw std::logic_error("Invalid quiet zone.");
+  }
+}
+
+std::string SvgWriter::render(const QRImage& image) const {
+  std::string svg;
+  render(image, svg);
+  return svg;
+}
+
+// The runs are counted first so the string is only grown once. Each run
+// takes at most 28 characters, "M" x " " y "h" length "v1h-" length "z".
+void SvgWriter::render(const QRImage& image, std::string& svg) const {
+  std::size_t runs = 0;
+  for (int y = 0; y < image.getHeight(); ++y) {
+    image.forEachRun(y, [&runs](int, int) { ++runs; });
+  }
+
+  const int width = image.getWidth() + 2 * quiet_zone_;
+  const int height = image.getHeight() + 2 * quiet_zone_;
+  svg.clear();
+  svg.reserve(256 + runs * 28);
+
+  svg += "<svg xmlns=\"http://www.w3.org/2000/svg\" viewBox=\"0 0 ";
+  appendNumber(svg, width);
+  svg += ' ';
+  appendNumber(svg, height);
+  svg += "\" width=\"";
+  appendNumber(svg, width * scale_);
+  svg += "\" height=\"";
+  appendNumber(svg, height * scale_);
+  svg += "\" shape-rendering=\"crispEdges\"><rect width=\"100%\" "
+         "height=\"100%\" fill=\"";
+  svg += invert_ ? "#000" : "#fff";
+  svg += "\"/><path fill=\"";
+  svg += invert_ ? "#fff" : "#000";
+  svg += "\" d=\"";
+  for (int y = 0; y < image.getHeight(); ++y) {
+    image.forEachRun(y, [&](int x, int length) {
+      svg += 'M';
+      appendNumber(svg, x + quiet_zone_);
+      svg += ' ';
+      appendNumber(svg, y + quiet_zone_);
+      svg += 'h';
+      appendNumber(svg, length);
+      svg += "v1h-";
+      appendNumber(svg, length);
+      svg += 'z';
+    });
+  }
+  svg += "\"/></svg>\n";
+}
+
+void SvgWriter::write(const QRImage& image, int fd) const {
+  QROutput::writeAll(fd, render(image));
+}
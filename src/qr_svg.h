@@ -0,0 +1,33 @@
+#ifndef QR_SVG_H_
+#define QR_SVG_H_
+
+#include <string>
+
+#include "qr_image.h"
+
+// Writes codes as SVG images with a single path. Each run of dark blocks in
+// a row is one rectangle of the path, so the output grows with the number of
+// runs instead of the number of blocks.
+class SvgWriter {
+ public:
+  // The image is 'scale' pixels for each block, with 'quiet_zone' light
+  // blocks around the code. 'invert' draws dark blocks white on black.
+  explicit SvgWriter(int scale = 4, int quiet_zone = 4, bool invert = false);
+
+  // Returns the image.
+  std::string render(const QRImage&) const;
+
+  // Replaces the contents of the string with the image. The string keeps
+  // its memory, so reusing one string for many codes does not allocate.
+  void render(const QRImage&, std::string&) const;
+
+  // Writes the image to the file descriptor.
+  void write(const QRImage&, int) const;
+
+ private:
+  int scale_;      // Pixels in the width of a block
+  int quiet_zone_; // Light blocks around the code
+  bool invert_;    // Dark blocks are white
+}; // SvgWriter
+
+#endif // QR_SVG_H_
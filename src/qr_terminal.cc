@@ -0,0 +1,46 @@
+#include "qr_output.h"
+#include "qr_terminal.h"
+
+TerminalRenderer::TerminalRenderer(int quiet_zone, bool invert)
+    : quiet_zone_(quiet_zone), invert_(invert) {
+  if (quiet_zone < 0) {
+    throw std::logic_error("Invalid quiet zone.");
+  }
+}
+
+std::string TerminalRenderer::render(const QRImage& image) const {
+  // Glyph for the top and bottom block of a line, indexed by top * 2 +
+  // bottom.
+  static const std::string_view kGlyphs[4] = { " ", "▄", "▀", "█" };
+
+  const int width = image.getWidth() + 2 * quiet_zone_;
+  const int height = image.getHeight() + 2 * quiet_zone_;
+
+  // Blocks of a row with the quiet zone, as they are drawn. A row past the
+  // bottom of the frame is never drawn, even when inverted.
+  auto drawn = [&](int x, int y) {
+    if (y >= height) {
+      return false;
+    }
+    x -= quiet_zone_;
+    y -= quiet_zone_;
+    bool dark = x >= 0 && y >= 0 && x < image.getWidth()
+                && y < image.getHeight() && image.getBlock(x, y);
+    return dark != invert_;
+  };
+
+  std::string frame;
+  frame.reserve(static_cast<std::size_t>((width * 3 + 1) * (height + 1) / 2));
+  for (int y = 0; y < height; y += 2) {
+    for (int x = 0; x < width; ++x) {
+      frame += kGlyphs[drawn(x, y) * 2 + drawn(x, y + 1)];
+    }
+    frame += '\n';
+  }
+  return frame;
+}
+
+// For a terminal the frame goes in one write().
+void TerminalRenderer::print(const QRImage& image, int fd) const {
+  QROutput::writeAll(fd, render(image));
+}
@@ -0,0 +1,30 @@
+#ifndef QR_TERMINAL_H_
+#define QR_TERMINAL_H_
+
+#include <string>
+
+#include "qr_image.h"
+
+// Draws codes for a terminal with half block characters, two rows of blocks
+// on each line and one column per block. The whole frame is made in one
+// string and written with a single write(), instead of a stream insertion
+// for each block. QRCode::printQR() prints with it.
+class TerminalRenderer {
+ public:
+  // 'quiet_zone' light blocks are drawn around the code. Dark blocks are
+  // drawn with the block characters unless 'invert' is set, which suits
+  // terminals with a light background.
+  explicit TerminalRenderer(int quiet_zone = 4, bool invert = false);
+
+  // Returns the frame, each line ending in a newline.
+  std::string render(const QRImage&) const;
+
+  // Writes the frame to the file descriptor, throws if the write fails.
+  void print(const QRImage&, int fd = 1) const;
+
+ private:
+  int quiet_zone_; // Light blocks around the code
+  bool invert_;    // Draw light blocks instead of dark ones
+}; // TerminalRenderer
+
+#endif // QR_TERMINAL_H_
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "qr_output.h"
+#include "qr_tiff.h"
+
+// Code of a run length, the high bit written first.
+struct FaxCode {
+  std::uint16_t bits;
+  std::uint8_t length;
+}; // FaxCode
+
+// Terminating codes of white runs of 0 - 63 pixels.
+static const FaxCode kWhiteCodes[64] = {
+  {0x035, 8}, {0x007, 6}, {0x007, 4}, {0x008, 4}, {0x00B, 4}, {0x00C, 4},
+  {0x00E, 4}, {0x00F, 4}, {0x013, 5}, {0x014, 5}, {0x007, 5}, {0x008, 5},
+  {0x008, 6}, {0x003, 6}, {0x034, 6}, {0x035, 6}, {0x02A, 6}, {0x02B, 6},
+  {0x027, 7}, {0x00C, 7}, {0x008, 7}, {0x017, 7}, {0x003, 7}, {0x004, 7},
+  {0x028, 7}, {0x02B, 7}, {0x013, 7}, {0x024, 7}, {0x018, 7}, {0x002, 8},
+  {0x003, 8}, {0x01A, 8}, {0x01B, 8}, {0x012, 8}, {0x013, 8}, {0x014, 8},
+  {0x015, 8}, {0x016, 8}, {0x017, 8}, {0x028, 8}, {0x029, 8}, {0x02A, 8},
+  {0x02B, 8}, {0x02C, 8}, {0x02D, 8}, {0x004, 8}, {0x005, 8}, {0x00A, 8},
+  {0x00B, 8}, {0x052, 8}, {0x053, 8}, {0x054, 8}, {0x055, 8}, {0x024, 8},
+  {0x025, 8}, {0x058, 8}, {0x059, 8}, {0x05A, 8}, {0x05B, 8}, {0x04A, 8},
+  {0x04B, 8}, {0x032, 8}, {0x033, 8}, {0x034, 8}
+};
+// Make up codes of white runs of 64 - 1728 pixels, in steps of 64.
+static const FaxCode kWhiteMakeup[27] = {
+  {0x01B, 5}, {0x012, 5}, {0x017, 6}, {0x037, 7}, {0x036, 8}, {0x037, 8},
+  {0x064, 8}, {0x065, 8}, {0x068, 8}, {0x067, 8}, {0x0CC, 9}, {0x0CD, 9},
+  {0x0D2, 9}, {0x0D3, 9}, {0x0D4, 9}, {0x0D5, 9}, {0x0D6, 9}, {0x0D7, 9},
+  {0x0D8, 9}, {0x0D9, 9}, {0x0DA, 9}, {0x0DB, 9}, {0x098, 9}, {0x099, 9},
+  {0x09A, 9}, {0x018, 6}, {0x09B, 9}
+};
+// Terminating codes of black runs of 0 - 63 pixels.
+static const FaxCode kBlackCodes[64] = {
+  {0x037, 10}, {0x002, 3}, {0x003, 2}, {0x002, 2}, {0x003, 3}, {0x003, 4},
+  {0x002, 4}, {0x003, 5}, {0x005, 6}, {0x004, 6}, {0x004, 7}, {0x005, 7},
+  {0x007, 7}, {0x004, 8}, {0x007, 8}, {0x018, 9}, {0x017, 10}, {0x018, 10},
+  {0x008, 10}, {0x067, 11}, {0x068, 11}, {0x06C, 11}, {0x037, 11}, {0x028, 11},
+  {0x017, 11}, {0x018, 11}, {0x0CA, 12}, {0x0CB, 12}, {0x0CC, 12}, {0x0CD, 12},
+  {0x068, 12}, {0x069, 12}, {0x06A, 12}, {0x06B, 12}, {0x0D2, 12}, {0x0D3, 12},
+  {0x0D4, 12}, {0x0D5, 12}, {0x0D6, 12}, {0x0D7, 12}, {0x06C, 12}, {0x06D, 12},
+  {0x0DA, 12}, {0x0DB, 12}, {0x054, 12}, {0x055, 12}, {0x056, 12}, {0x057, 12},
+  {0x064, 12}, {0x065, 12}, {0x052, 12}, {0x053, 12}, {0x024, 12}, {0x037, 12},
+  {0x038, 12}, {0x027, 12}, {0x028, 12}, {0x058, 12}, {0x059, 12}, {0x02B, 12},
+  {0x02C, 12}, {0x05A, 12}, {0x066, 12}, {0x067, 12}
+};
+// Make up codes of black runs of 64 - 1728 pixels, in steps of 64.
+static const FaxCode kBlackMakeup[27] = {
+  {0x00F, 10}, {0x0C8, 12}, {0x0C9, 12}, {0x05B, 12}, {0x033, 12}, {0x034, 12},
+  {0x035, 12}, {0x06C, 13}, {0x06D, 13}, {0x04A, 13}, {0x04B, 13}, {0x04C, 13},
+  {0x04D, 13}, {0x072, 13}, {0x073, 13}, {0x074, 13}, {0x075, 13}, {0x076, 13},
+  {0x077, 13}, {0x052, 13}, {0x053, 13}, {0x054, 13}, {0x055, 13}, {0x05A, 13},
+  {0x05B, 13}, {0x064, 13}, {0x065, 13}
+};
+// Make up codes of runs of 1792 - 2560 pixels of either color.
+static const FaxCode kExtendedMakeup[13] = {
+  {0x008, 11}, {0x00C, 11}, {0x00D, 11}, {0x012, 12}, {0x013, 12}, {0x014, 12},
+  {0x015, 12}, {0x016, 12}, {0x017, 12}, {0x01C, 12}, {0x01D, 12}, {0x01E, 12},
+  {0x01F, 12}
+};
+
+// Bits of the image data, from the high bit of each byte down.
+class FaxBuffer {
+ public:
+  explicit FaxBuffer(std::vector<std::uint8_t>& out) : out_(out) {}
+
+  void putBits(std::uint32_t bits, int length) {
+    bits_ = bits_ << length | bits;
+    count_ += length;
+    while (count_ >= 8) {
+      out_.push_back(static_cast<std::uint8_t>(bits_ >> (count_ - 8)));
+      count_ -= 8;
+    }
+  }
+  void putBits(const FaxCode& code) { putBits(code.bits, code.length); }
+  void putOnes(std::size_t count) {
+    for (; count >= 16; count -= 16) {
+      putBits(0xFFFF, 16);
+    }
+    putBits((1u << count) - 1, static_cast<int>(count));
+  }
+  void flush() {
+    if (count_ > 0) {
+      putBits(0, 8 - count_);
+    }
+  }
+
+  // Run of white or black pixels, make up codes for the multiples of 64 and
+  // a terminating code for the rest.
+  void putRun(int length, bool black) {
+    for (; length >= 2560 + 64; length -= 2560) {
+      putBits(kExtendedMakeup[12]);
+    }
+    if (length >= 64) {
+      int multiple = length / 64;
+      putBits(multiple > 27 ? kExtendedMakeup[multiple - 28]
+              : black ? kBlackMakeup[multiple - 1]
+                      : kWhiteMakeup[multiple - 1]);
+      length -= multiple * 64;
+    }
+    putBits(black ? kBlackCodes[length] : kWhiteCodes[length]);
+  }
+
+ private:
+  std::vector<std::uint8_t>& out_; // Image data
+  std::uint64_t bits_ = 0;         // Bits not yet written, in the low bits
+  int count_ = 0;                  // Number of bits not yet written
+}; // FaxBuffer
+
+// Codes a row from the changing elements of the row and the row above, the
+// pixels where the color changes, with three of 'width' after the last.
+// 'a0' is the last pixel coded, 'a1' the next change in the row, and 'b1'
+// and 'b2' the next two changes above it to the other color.
+static void codeRow(FaxBuffer& out, const std::vector<int>& coding,
+                    const std::vector<int>& reference, int width) {
+  int a0 = -1;
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (a0 < width) {
+    const std::size_t color = i & 1;
+    while (reference[j] <= a0) {
+      ++j;
+    }
+    const std::size_t k = (j & 1) == color ? j : j + 1;
+    const int b1 = reference[k];
+    const int b2 = reference[k + 1];
+    const int a1 = coding[i];
+
+    if (b2 < a1) {
+      out.putBits(0x1, 4); // Pass
+      a0 = b2;
+    } else if (std::abs(a1 - b1) <= 3) {
+      static const FaxCode kVertical[7] = {
+        {0x2, 7}, {0x2, 6}, {0x2, 3}, {0x1, 1}, {0x3, 3}, {0x3, 6}, {0x3, 7}
+      };
+      out.putBits(kVertical[a1 - b1 + 3]);
+      a0 = a1;
+      ++i;
+    } else {
+      const int a2 = coding[i + 1];
+      out.putBits(0x1, 3); // Horizontal
+      out.putRun(a1 - std::max(a0, 0), color != 0);
+      out.putRun(a2 - a1, color == 0);
+      a0 = a2;
+      i += 2;
+    }
+  }
+}
+
+static void put16(std::vector<std::uint8_t>& out, std::uint32_t value) {
+  out.push_back(static_cast<std::uint8_t>(value));
+  out.push_back(static_cast<std::uint8_t>(value >> 8));
+}
+
+static void put32(std::vector<std::uint8_t>& out, std::uint32_t value) {
+  put16(out, value & 0xFFFF);
+  put16(out, value >> 16);
+}
+
+TiffWriter::TiffWriter(int scale, int quiet_zone, bool invert)
+    : scale_(scale), quiet_zone_(quiet_zone), invert_(invert) {
+  if (scale < 1) {
+    throw std::logic_error("Invalid scale.");
+  }
+  if (quiet_zone < 0) {
+    throw std::logic_error("Invalid quiet zone.");
+  }
+}
+
+std::vector<std::uint8_t> TiffWriter::encode(const QRImage& image) const {
+  std::vector<std::uint8_t> tiff;
+  encode(image, tiff);
+  return tiff;
+}
+
+// A little endian TIFF of one strip, the image data first and the IFD after
+// it. Dark blocks are black, 1 in the data, with a photometric
+// interpretation of white is zero, or black is zero when inverted. The
+// first row of pixels of each row of blocks is coded against the row
+// above, and the rest repeat it, each change being vertical mode 0.
+void TiffWriter::encode(const QRImage& image,
+                        std::vector<std::uint8_t>& tiff) const {
+  const int width = (image.getWidth() + 2 * quiet_zone_) * scale_;
+  const int height = (image.getHeight() + 2 * quiet_zone_) * scale_;
+  tiff.assign(8, 0);
+  tiff[0] = 'I';
+  tiff[1] = 'I';
+  tiff[2] = 42;
+
+  FaxBuffer out(tiff);
+  std::vector<int> reference(3, width);
+  std::vector<int> coding;
+  for (int y = 0; y < image.getHeight() + 2 * quiet_zone_; ++y) {
+    coding.clear();
+    const int code_y = y - quiet_zone_;
+    if (code_y >= 0 && code_y < image.getHeight()) {
+      image.forEachRun(code_y, [this, &coding](int x, int length) {
+        coding.push_back((x + quiet_zone_) * scale_);
+        coding.push_back((x + length + quiet_zone_) * scale_);
+      });
+    }
+
+    // A run that reaches the edge does not change color there.
+    if (!coding.empty() && coding.back() == width) {
+      coding.pop_back();
+    }
+    coding.insert(coding.end(), 3, width);
+    codeRow(out, coding, reference, width);
+    for (int repeat = 1; repeat < scale_; ++repeat) {
+      out.putOnes(coding.size() - 2);
+    }
+    reference.swap(coding);
+  }
+  out.putBits(0x001, 12); // End of facsimile block, two end of lines
+  out.putBits(0x001, 12);
+  out.flush();
+  const std::uint32_t length = static_cast<std::uint32_t>(tiff.size() - 8);
+  if (tiff.size() % 2 != 0) {
+    tiff.push_back(0);
+  }
+
+  const std::uint32_t ifd = static_cast<std::uint32_t>(tiff.size());
+  const std::uint32_t resolution = ifd + 2 + 12 * 12 + 4;
+  tiff[4] = static_cast<std::uint8_t>(ifd);
+  tiff[5] = static_cast<std::uint8_t>(ifd >> 8);
+  tiff[6] = static_cast<std::uint8_t>(ifd >> 16);
+  tiff[7] = static_cast<std::uint8_t>(ifd >> 24);
+
+  // Tag, type (3 short, 4 long, 5 rational) and value of each entry.
+  const std::uint32_t entries[12][3] = {
+    {256, 4, static_cast<std::uint32_t>(width)},  // Image width
+    {257, 4, static_cast<std::uint32_t>(height)}, // Image length
+    {258, 3, 1},                                  // Bits per sample
+    {259, 3, 4},                                  // CCITT Group 4
+    {262, 3, invert_ ? 1u : 0u},                  // Photometric
+    {273, 4, 8},                                  // Strip offset
+    {277, 3, 1},                                  // Samples per pixel
+    {278, 4, static_cast<std::uint32_t>(height)}, // Rows per strip
+    {279, 4, length},                             // Strip byte count
+    {282, 5, resolution},                         // X resolution
+    {283, 5, resolution},                         // Y resolution
+    {296, 3, 2},                                  // Inches
+  };
+  put16(tiff, 12);
+  for (const auto& entry : entries) {
+    put16(tiff, entry[0]);
+    put16(tiff, entry[1]);
+    put32(tiff, 1);
+    if (entry[1] == 3) {
+      put16(tiff, entry[2]);
+      put16(tiff, 0);
+    } else {
+      put32(tiff, entry[2]);
+    }
+  }
+  put32(tiff, 0); // No more IFDs
+  put32(tiff, 72);
+  put32(tiff, 1);
+}
+
+void TiffWriter::write(const QRImage& image, int fd) const {
+  QROutput::writeAll(fd, encode(image));
+}
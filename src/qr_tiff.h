@@ -0,0 +1,35 @@
+#ifndef QR_TIFF_H_
+#define QR_TIFF_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "qr_image.h"
+
+// Writes codes as bilevel TIFF images compressed with CCITT Group 4 (T.6).
+// Each row of pixels is coded against the row above it, so the rows that
+// repeat for the scale take one bit for each change of color. The changes
+// come from the runs of the packed blocks, the pixels are never drawn.
+class TiffWriter {
+ public:
+  // Each block is 'scale' pixels square, with 'quiet_zone' light blocks
+  // around the code. 'invert' draws dark blocks white on black.
+  explicit TiffWriter(int scale = 4, int quiet_zone = 4, bool invert = false);
+
+  // Returns the image.
+  std::vector<std::uint8_t> encode(const QRImage&) const;
+
+  // Replaces the contents of the vector with the image. The vector keeps
+  // its memory, so reusing one for many codes does not allocate.
+  void encode(const QRImage&, std::vector<std::uint8_t>&) const;
+
+  // Writes the image to the file descriptor.
+  void write(const QRImage&, int) const;
+
+ private:
+  int scale_;      // Pixels in the width of a block
+  int quiet_zone_; // Light blocks around the code
+  bool invert_;    // Dark blocks are white
+}; // TiffWriter
+
+#endif // QR_TIFF_H_
@@ -0,0 +1,184 @@
+#include <cstring>
+#include <stdexcept>
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "qr_upscale.h"
+
+// Flips 'count' bits of a packed row starting at bit 'first'. Whole bytes
+// are flipped at once.
+static void flipBits(std::uint8_t* row, std::size_t first, std::size_t count) {
+  for (; count > 0 && (first & 7) != 0; ++first, --count) {
+    row[first >> 3] ^= static_cast<std::uint8_t>(0x80 >> (first & 7));
+  }
+  for (; count >= 8; first += 8, count -= 8) {
+    row[first >> 3] ^= 0xFF;
+  }
+  for (; count > 0; ++first, --count) {
+    row[first >> 3] ^= static_cast<std::uint8_t>(0x80 >> (first & 7));
+  }
+}
+
+#if defined(__BMI2__)
+// Bits of a byte at every 'scale'th bit, which a multiply by 'scale' ones
+// then fills in.
+static std::uint64_t spreadMask(int scale) {
+  std::uint64_t mask = 0;
+  for (int i = 0; i < 8; ++i) {
+    mask |= std::uint64_t{1} << (i * scale);
+  }
+  return mask;
+}
+#endif
+
+Upscaler::Upscaler(int scale, int quiet_zone, bool invert)
+    : scale_(scale), quiet_zone_(quiet_zone), invert_(invert), spread_{} {
+  if (scale < 1 || scale > 1024) {
+    throw std::logic_error("Invalid scale.");
+  }
+  if (quiet_zone < 0) {
+    throw std::logic_error("Invalid quiet zone.");
+  }
+
+  // Without PDEP, the spread bits of each byte come from a table. Only 1 bit
+  // rows at scales under 8 are spread, 8 bytes hold their 8 blocks.
+#if !defined(__BMI2__)
+  if (scale < 8) {
+    const std::uint64_t ones = (std::uint64_t{1} << scale) - 1;
+    for (int byte = 0; byte < 256; ++byte) {
+      std::uint64_t bits = 0;
+      for (int i = 0; i < 8; ++i) {
+        if ((byte >> i) & 1) {
+          bits |= ones << (i * scale);
+        }
+      }
+      spread_[byte] = bits;
+    }
+  }
+#endif
+}
+
+// The row starts light, and only the dark blocks are drawn. Codes look like
+// noise, so testing each block would mispredict a branch for most of them.
+// Small scales are drawn without branching on the blocks, and large scales
+// fill each run of dark blocks.
+void Upscaler::drawRow(const QRImage& image, Format format, int y,
+                       std::uint8_t* row) const {
+  const std::size_t length = getRowLength(getWidth(image), format);
+  const std::uint8_t light = invert_ ? 0x00 : 0xFF;
+  std::memset(row, light, length);
+
+  const int code_y = y - quiet_zone_;
+  if (code_y < 0 || code_y >= image.getHeight()) {
+    return;
+  }
+  if (format == Format::k1Bit && scale_ <= 56) {
+    spreadRow(image, code_y, row);
+    return;
+  } else if (format == Format::k8Bit && scale_ <= 8) {
+    expandRow(image, code_y, row, length);
+    return;
+  }
+  image.forEachRun(code_y, [&](int x, int count) {
+    std::size_t first = static_cast<std::size_t>((x + quiet_zone_) * scale_);
+    std::size_t pixels = static_cast<std::size_t>(count * scale_);
+    if (format == Format::k1Bit) {
+      flipBits(row, first, pixels);
+    } else {
+      std::memset(row + first, static_cast<std::uint8_t>(~light), pixels);
+    }
+  });
+}
+
+// The spread bits are XORed into the light row through an accumulator, which
+// never holds more than 7 + 56 bits. Under a scale of 8 a byte of blocks is
+// spread at a time, otherwise each block is.
+void Upscaler::spreadRow(const QRImage& image, int y,
+                         std::uint8_t* row) const {
+  const std::uint8_t* blocks = image.getRow(y);
+  const std::size_t offset = static_cast<std::size_t>(quiet_zone_ * scale_);
+  const std::uint64_t ones = (std::uint64_t{1} << scale_) - 1;
+  std::uint8_t* out = row + (offset >> 3);
+  std::uint64_t pending = 0;
+  int count = static_cast<int>(offset & 7);
+
+  if (scale_ < 8) {
+    const int bytes = image.getStride();
+    const int last_bits = image.getWidth() - 8 * (bytes - 1);
+#if defined(__BMI2__)
+    const std::uint64_t mask = spreadMask(scale_);
+#endif
+    for (int i = 0; i < bytes; ++i) {
+#if defined(__BMI2__)
+      std::uint64_t bits = _pdep_u64(blocks[i], mask) * ones;
+#else
+      std::uint64_t bits = spread_[blocks[i]];
+#endif
+      int length = 8 * scale_;
+
+      // Only the blocks in the image are drawn from the last byte.
+      if (i == bytes - 1 && last_bits < 8) {
+        bits >>= (8 - last_bits) * scale_;
+        length = last_bits * scale_;
+      }
+      pending = pending << length | bits;
+      count += length;
+      for (; count >= 8; count -= 8) {
+        *out++ ^= static_cast<std::uint8_t>(pending >> (count - 8));
+      }
+    }
+  } else {
+    for (int x = 0; x < image.getWidth(); ++x) {
+      std::uint64_t block = (blocks[x >> 3] >> (7 - (x & 7))) & 1;
+      pending = pending << scale_ | (ones & (0 - block));
+      count += scale_;
+      for (; count >= 8; count -= 8) {
+        *out++ ^= static_cast<std::uint8_t>(pending >> (count - 8));
+      }
+    }
+  }
+  if (count > 0) {
+    *out ^= static_cast<std::uint8_t>(pending << (8 - count));
+  }
+}
+
+// Each block is stored as 8 bytes, the bytes past 'scale' are written over by
+// the blocks after it. Near the end of the row the blocks are set one byte
+// at a time, and the right quiet zone is made light again.
+void Upscaler::expandRow(const QRImage& image, int y, std::uint8_t* row,
+                         std::size_t length) const {
+  const std::uint8_t* blocks = image.getRow(y);
+  const std::uint64_t light = invert_ ? 0 : ~std::uint64_t{0};
+  std::size_t position = static_cast<std::size_t>(quiet_zone_ * scale_);
+  for (int x = 0; x < image.getWidth(); ++x, position += scale_) {
+    std::uint64_t block = (blocks[x >> 3] >> (7 - (x & 7))) & 1;
+    std::uint64_t pixels = light ^ (0 - block);
+    if (position + 8 <= length) {
+      std::memcpy(row + position, &pixels, 8);
+    } else {
+      std::memset(row + position, static_cast<std::uint8_t>(pixels), scale_);
+    }
+  }
+  std::memset(row + position, static_cast<std::uint8_t>(light),
+              length - position);
+}
+
+void Upscaler::draw(const QRImage& image, Format format,
+                    std::span<std::uint8_t> out, std::size_t stride) const {
+  const std::size_t length = getRowLength(getWidth(image), format);
+  const std::size_t height = static_cast<std::size_t>(getHeight(image));
+  if (stride < length || out.size() < stride * (height - 1) + length) {
+    throw std::logic_error("Buffer too small.");
+  }
+
+  const int rows = image.getHeight() + 2 * quiet_zone_;
+  for (int y = 0; y < rows; ++y) {
+    std::uint8_t* first = out.data() + static_cast<std::size_t>(y) * scale_
+                                       * stride;
+    drawRow(image, format, y, first);
+    for (int copy = 1; copy < scale_; ++copy) {
+      std::memcpy(first + copy * stride, first, length);
+    }
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef QR_UPSCALE_H_
+#define QR_UPSCALE_H_
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+#include "qr_image.h"
+
+// Expands each block of a code to 'scale' pixels square, with a quiet zone,
+// into 1 bit or 8 bit rows. Light pixels are 1 (0xFF) and dark pixels 0,
+// the same as PNG and BMP grayscale, unless inverted. Each row of blocks is
+// drawn once and copied for the other rows of its pixels.
+class Upscaler {
+ public:
+  // Pixel formats.
+  enum class Format {
+    k1Bit = 0, // 8 pixels in each byte, the leftmost in the high bit
+    k8Bit,     // 1 pixel in each byte
+  }; // Format
+
+  Upscaler(int scale, int quiet_zone, bool invert = false);
+
+  int getScale() const { return scale_; }
+  int getQuietZone() const { return quiet_zone_; }
+
+  // Size of the image in pixels, with the quiet zone.
+  int getWidth(const QRImage& image) const {
+    return (image.getWidth() + 2 * quiet_zone_) * scale_;
+  }
+  int getHeight(const QRImage& image) const {
+    return (image.getHeight() + 2 * quiet_zone_) * scale_;
+  }
+
+  // Bytes in a row of 'width' pixels.
+  static std::size_t getRowLength(int width, Format format) {
+    return format == Format::k1Bit ? static_cast<std::size_t>(width + 7) / 8
+                                   : static_cast<std::size_t>(width);
+  }
+
+  // Draws one row of pixels for the 'y'th row of blocks, counting the rows
+  // of the quiet zone, into a row of getRowLength() bytes.
+  void drawRow(const QRImage&, Format, int, std::uint8_t*) const;
+
+  // Draws the whole image into rows 'stride' bytes apart, such as part of a
+  // larger framebuffer. Throws if the stride or the buffer is too small.
+  void draw(const QRImage&, Format, std::span<std::uint8_t>,
+            std::size_t) const;
+
+ private:
+  void spreadRow(const QRImage&, int, std::uint8_t*) const;
+  void expandRow(const QRImage&, int, std::uint8_t*, std::size_t) const;
+
+  int scale_;                             // Pixels in the width of a block
+  int quiet_zone_;                        // Light blocks around the code
+  bool invert_;                           // Dark pixels are 1
+  std::array<std::uint64_t, 256> spread_; // Bits of each byte 'scale' times
+}; // Upscaler
+
+#endif // QR_UPSCALE_H_
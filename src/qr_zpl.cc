@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <vector>
+
+#include "qr_deflate.h"
+#include "qr_output.h"
+#include "qr_zpl.h"
+
+static const char kHexDigits[] = "0123456789ABCDEF";
+
+static void appendNumber(std::string& out, std::size_t value) {
+  char digits[24];
+  char* end = std::to_chars(digits, digits + sizeof digits, value).ptr;
+  out.append(digits, end);
+}
+
+// ACS repeat count of a run, 'z' for each 400 and the rest as a multiple of
+// 20, 'g' - 'y', and 1 - 19, 'G' - 'Y'.
+static void appendCount(std::string& out, std::size_t count) {
+  for (; count > 400; count -= 400) {
+    out += 'z';
+  }
+  if (count >= 20) {
+    out += static_cast<char>('g' + count / 20 - 1);
+    count %= 20;
+  }
+  if (count > 0) {
+    out += static_cast<char>('G' + count - 1);
+  }
+}
+
+// A row as hex digits, each run of 3 or more of a digit given a count. A
+// run of 0 or F to the end of the row is ',' or '!'.
+static void appendAcsRow(std::string& out, const std::uint8_t* row,
+                         std::size_t length) {
+  const std::size_t digits = 2 * length;
+  auto digit = [row](std::size_t i) {
+    return kHexDigits[(row[i / 2] >> (i % 2 == 0 ? 4 : 0)) & 0xF];
+  };
+  std::size_t i = 0;
+  while (i < digits) {
+    const char value = digit(i);
+    std::size_t run = 1;
+    while (i + run < digits && digit(i + run) == value) {
+      ++run;
+    }
+    if (i + run == digits && (value == '0' || value == 'F')) {
+      out += value == '0' ? ',' : '!';
+      return;
+    }
+    if (run >= 3) {
+      appendCount(out, run);
+      out += value;
+    } else {
+      out.append(run, value);
+    }
+    i += run;
+  }
+}
+
+// Base64 and the CRC-16 (polynomial 0x1021, starting from 0) of the Base64
+// text, as a Z64 field.
+static void appendZ64Field(std::string& out, const std::uint8_t* data,
+                           std::size_t length) {
+  static const char kBase64[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  out += ":Z64:";
+  const std::size_t start = out.size();
+  for (std::size_t i = 0; i < length; i += 3) {
+    std::uint32_t group = static_cast<std::uint32_t>(data[i]) << 16;
+    if (i + 1 < length) {
+      group |= static_cast<std::uint32_t>(data[i + 1]) << 8;
+    }
+    if (i + 2 < length) {
+      group |= data[i + 2];
+    }
+    out += kBase64[group >> 18];
+    out += kBase64[(group >> 12) & 0x3F];
+    out += i + 1 < length ? kBase64[(group >> 6) & 0x3F] : '=';
+    out += i + 2 < length ? kBase64[group & 0x3F] : '=';
+  }
+
+  std::uint16_t crc = 0;
+  for (std::size_t i = start; i < out.size(); ++i) {
+    crc ^= static_cast<std::uint16_t>(static_cast<std::uint8_t>(out[i]) << 8);
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = static_cast<std::uint16_t>(crc & 0x8000 ? (crc << 1) ^ 0x1021
+                                                    : crc << 1);
+    }
+  }
+  out += ':';
+  for (int shift = 12; shift >= 0; shift -= 4) {
+    out += kHexDigits[(crc >> shift) & 0xF];
+  }
+}
+
+// Printed dots are 1, so the upscaler draws dark blocks as 1.
+ZplWriter::ZplWriter(int scale, int quiet_zone, Compression compression)
+    : upscaler_(scale, quiet_zone, true), compression_(compression) {}
+
+std::string ZplWriter::render(const QRImage& image) const {
+  std::string zpl;
+  render(image, zpl);
+  return zpl;
+}
+
+// The field is placed at the label's origin, its quiet zone included.
+void ZplWriter::render(const QRImage& image, std::string& zpl) const {
+  const std::size_t length = Upscaler::getRowLength(
+      upscaler_.getWidth(image), Upscaler::Format::k1Bit);
+  const std::size_t total = length * upscaler_.getHeight(image);
+  zpl.clear();
+  zpl += "^XA\n^FO0,0^GFA,";
+  appendNumber(zpl, total);
+  zpl += ',';
+  appendNumber(zpl, total);
+  zpl += ',';
+  appendNumber(zpl, length);
+  zpl += ',';
+  if (compression_ == Compression::kAcs) {
+    appendAcs(image, zpl);
+  } else {
+    appendZ64(image, zpl);
+  }
+  zpl += "^FS\n^XZ\n";
+}
+
+void ZplWriter::write(const QRImage& image, int fd) const {
+  QROutput::writeAll(fd, render(image));
+}
+
+// Each row of blocks is drawn once. The first of its rows of dots is a ':'
+// too if it matches the row above, as the rows of the quiet zone do.
+void ZplWriter::appendAcs(const QRImage& image, std::string& zpl) const {
+  const std::size_t length = Upscaler::getRowLength(
+      upscaler_.getWidth(image), Upscaler::Format::k1Bit);
+  std::vector<std::uint8_t> rows(2 * length);
+  std::uint8_t* row = rows.data();
+  std::uint8_t* above = rows.data() + length;
+  const int blocks_high = image.getHeight() + 2 * upscaler_.getQuietZone();
+  for (int y = 0; y < blocks_high; ++y) {
+    upscaler_.drawRow(image, Upscaler::Format::k1Bit, y, row);
+    if (y > 0 && std::equal(row, row + length, above)) {
+      zpl += ':';
+    } else {
+      appendAcsRow(zpl, row, length);
+    }
+    zpl.append(upscaler_.getScale() - 1, ':');
+    std::swap(row, above);
+  }
+}
+
+// The rows of dots are deflated as a zlib stream, each row of blocks drawn
+// once and repeated.
+void ZplWriter::appendZ64(const QRImage& image, std::string& zpl) const {
+  const std::size_t length = Upscaler::getRowLength(
+      upscaler_.getWidth(image), Upscaler::Format::k1Bit);
+  const std::size_t total = length * upscaler_.getHeight(image);
+  std::vector<std::uint8_t> stream(6 + Deflater::getMaxLength(total));
+  std::vector<std::uint8_t> rows(2 * length);
+  std::uint8_t* row = rows.data();
+  const std::uint8_t* above = nullptr;
+  std::uint32_t adler = 1;
+
+  Deflater out(stream);
+  out.putByte(0x78);
+  out.putByte(0x01);
+  out.putBits(1, 1); // Final block
+  out.putBits(1, 2); // Fixed Huffman codes
+  const int blocks_high = image.getHeight() + 2 * upscaler_.getQuietZone();
+  for (int y = 0; y < blocks_high; ++y) {
+    upscaler_.drawRow(image, Upscaler::Format::k1Bit, y, row);
+    for (int repeat = 0; repeat < upscaler_.getScale(); ++repeat) {
+      adler = Deflater::adler32(adler, row, length);
+      out.putRow(row, above, length);
+      above = row;
+    }
+    row = row == rows.data() ? rows.data() + length : rows.data();
+  }
+  out.putSymbol(256); // End of block
+  out.flushBits();
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out.putByte(static_cast<std::uint8_t>(adler >> shift));
+  }
+  appendZ64Field(zpl, stream.data(), out.getPosition());
+}
+
+// Field data is sent through ^FH, every byte that ZPL would read as a
+// command, or that is not printable, given as '_' and two hex digits.
+std::string ZplWriter::renderNative(std::string_view text,
+                                    QRCode::ErrCor err, int mask,
+                                    int magnification) {
+  static const char kLevels[] = "LMQH";
+  if (magnification < 1 || magnification > 10) {
+    throw std::logic_error("Invalid magnification.");
+  }
+  if (mask < 0 || mask > 7) {
+    throw std::logic_error("Invalid mask.");
+  }
+  if (err < QRCode::ErrCor::kLow || err > QRCode::ErrCor::kHigh) {
+    throw std::logic_error("Invalid ECL");
+  }
+  const char level = kLevels[static_cast<int>(err)];
+
+  std::string zpl = "^XA\n^FO0,0^BQN,2,";
+  appendNumber(zpl, static_cast<std::size_t>(magnification));
+  zpl += ',';
+  zpl += level;
+  zpl += ',';
+  zpl += static_cast<char>('0' + mask);
+  zpl += "^FH^FD";
+  zpl += level;
+  zpl += "A,";
+  for (char ch : text) {
+    const std::uint8_t byte = static_cast<std::uint8_t>(ch);
+    if (byte < 0x20 || byte >= 0x7F || ch == '^' || ch == '~' || ch == '_') {
+      zpl += '_';
+      zpl += kHexDigits[byte >> 4];
+      zpl += kHexDigits[byte & 0xF];
+    } else {
+      zpl += ch;
+    }
+  }
+  zpl += "^FS\n^XZ\n";
+  return zpl;
+}
@@ -0,0 +1,53 @@
+#ifndef QR_ZPL_H_
+#define QR_ZPL_H_
+
+#include <string>
+#include <string_view>
+
+#include "qr.h"
+#include "qr_image.h"
+#include "qr_upscale.h"
+
+// Writes labels in ZPL for thermal printers. A code is sent either as a ^GF
+// graphic field of its exact blocks, one dot for each pixel, or as the
+// printer's own ^BQ QR code command.
+class ZplWriter {
+ public:
+  // How a graphic field is compressed.
+  enum class Compression {
+    kAcs = 0, // Hex digits with repeat counts, ':' for a repeated row
+    kZ64,     // Deflate, then Base64 with a CRC
+  }; // Compression
+
+  // Each block is 'scale' dots square, with 'quiet_zone' blank blocks
+  // around the code.
+  explicit ZplWriter(int scale = 4, int quiet_zone = 4,
+                     Compression compression = Compression::kAcs);
+
+  // Returns a label with the code as a graphic field.
+  std::string render(const QRImage&) const;
+
+  // Replaces the contents of the string with the label. The string keeps
+  // its memory, so reusing one string for many codes does not allocate.
+  void render(const QRImage&, std::string&) const;
+
+  // Writes the label to the file descriptor.
+  void write(const QRImage&, int) const;
+
+  // Returns a label with a ^BQ command, the printer making the code from the
+  // text with the error correction level and mask. The mask must be given,
+  // 0 - 7, such as the one the encoder chose: ^BQ does not choose one and
+  // uses mask 7 if none is sent. 'magnification' is the dots in a block,
+  // 1 - 10.
+  static std::string renderNative(std::string_view, QRCode::ErrCor, int mask,
+                                  int magnification = 4);
+
+ private:
+  void appendAcs(const QRImage&, std::string&) const;
+  void appendZ64(const QRImage&, std::string&) const;
+
+  Upscaler upscaler_;       // Draws the rows of dots
+  Compression compression_; // How the graphic field is compressed
+}; // ZplWriter
+
+#endif // QR_ZPL_H_
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+#include "qr_packed.h"
+#include "qr_stl.h"
+
+static int failures = 0;
+
+static void check(bool passed, std::string_view what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << "\n";
+    ++failures;
+  }
+}
+
+static bool near(double value, double expected) {
+  return std::abs(value - expected) <= 1e-4 * std::max(1.0, expected);
+}
+
+struct Vector {
+  double x;
+  double y;
+  double z;
+}; // Vector
+
+static Vector operator-(const Vector& a, const Vector& b) {
+  return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+static Vector cross(const Vector& a, const Vector& b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
+          a.x * b.y - a.y * b.x};
+}
+
+static double dot(const Vector& a, const Vector& b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// What the faces of a mesh add up to. A closed mesh with its faces turned
+// outward has the volume it encloses, and the area facing each way is the
+// area of the shape seen from that side.
+struct Mesh {
+  std::uint32_t triangles = 0;
+  double volume = 0;
+  double area[6] = {}; // Facing +x, -x, +y, -y, +z, -z
+}; // Mesh
+
+static float readFloat(const std::vector<std::uint8_t>& stl, std::size_t at) {
+  std::uint32_t bits = 0;
+  for (int i = 3; i >= 0; --i) {
+    bits = bits << 8 | stl[at + i];
+  }
+  return std::bit_cast<float>(bits);
+}
+
+// Reads a binary STL. Every normal must be an axis and agree with the
+// winding of its triangle.
+static Mesh readStl(const std::vector<std::uint8_t>& stl) {
+  if (stl.size() < 84) {
+    throw std::runtime_error("No STL header.");
+  }
+  Mesh mesh;
+  mesh.triangles = stl[80] | stl[81] << 8 | stl[82] << 16
+                   | static_cast<std::uint32_t>(stl[83]) << 24;
+  if (stl.size() != 84 + 50 * static_cast<std::size_t>(mesh.triangles)) {
+    throw std::runtime_error("Length does not match the triangle count.");
+  }
+  for (std::uint32_t t = 0; t < mesh.triangles; ++t) {
+    const std::size_t at = 84 + 50 * static_cast<std::size_t>(t);
+    Vector v[4];
+    for (int i = 0; i < 4; ++i) {
+      v[i] = {readFloat(stl, at + 12 * i), readFloat(stl, at + 12 * i + 4),
+              readFloat(stl, at + 12 * i + 8)};
+    }
+    const Vector normal = v[0];
+    const Vector turn = cross(v[2] - v[1], v[3] - v[1]);
+    const double twice_area = std::sqrt(dot(turn, turn));
+    if (twice_area == 0 || !near(dot(turn, normal), twice_area)
+        || !near(dot(normal, normal), 1)) {
+      throw std::runtime_error("Normal does not match the winding.");
+    }
+    int axis = normal.x != 0 ? 0 : normal.y != 0 ? 2 : 4;
+    if (normal.x + normal.y + normal.z < 0) {
+      ++axis;
+    }
+    mesh.area[axis] += twice_area / 2;
+    mesh.volume += dot(v[1], cross(v[2], v[3])) / 6;
+  }
+  return mesh;
+}
+
+static void checkCode(const QRImage& code, const StlSettings& settings,
+                      std::string_view what) {
+  const StlWriter writer(settings);
+  const std::vector<std::uint8_t> stl = writer.encode(code);
+  check(stl.size() == writer.getLength(code),
+        std::string(what) + ", getLength()");
+
+  // What the mesh should be, from the blocks.
+  const int width = code.getWidth();
+  const int height = code.getHeight();
+  auto dark = [&](int x, int y) {
+    return x >= 0 && y >= 0 && x < width && y < height
+           && code.getBlock(x, y);
+  };
+  int blocks = 0;
+  int x_edges = 0; // Edges between dark and light blocks facing +x or -x
+  int y_edges = 0;
+  for (int y = -1; y <= height; ++y) {
+    for (int x = -1; x <= width; ++x) {
+      blocks += dark(x, y);
+      x_edges += dark(x, y) != dark(x + 1, y);
+      y_edges += dark(x, y) != dark(x, y + 1);
+    }
+  }
+  const double block = settings.block_size * settings.block_size;
+  const double plate_width = (width + 2 * settings.quiet_zone)
+                             * settings.block_size;
+  const double plate_height = (height + 2 * settings.quiet_zone)
+                              * settings.block_size;
+  const double plate = plate_width * plate_height;
+  const double flat = settings.base > 0 ? plate : blocks * block;
+  const double x_walls = x_edges / 2.0 * settings.block_size
+                         * settings.height
+                         + plate_height * settings.base;
+  const double y_walls = y_edges / 2.0 * settings.block_size
+                         * settings.height
+                         + plate_width * settings.base;
+
+  try {
+    const Mesh mesh = readStl(stl);
+    check(near(mesh.volume, blocks * block * settings.height
+                                + plate * settings.base),
+          std::string(what) + ", volume");
+    check(near(mesh.area[4], flat) && near(mesh.area[5], flat),
+          std::string(what) + ", top and bottom");
+    check(near(mesh.area[0], x_walls) && near(mesh.area[1], x_walls)
+              && near(mesh.area[2], y_walls) && near(mesh.area[3], y_walls),
+          std::string(what) + ", walls");
+
+    // A box for each dark block takes 12 triangles.
+    check(mesh.triangles * 2 < 12 * static_cast<std::uint32_t>(blocks),
+          std::string(what) + ", merged faces");
+  } catch (const std::runtime_error& error) {
+    check(false, std::string(what) + ": " + error.what());
+  }
+
+  // The buffer and file descriptor overloads write the same bytes.
+  std::vector<std::uint8_t> buffer(stl.size() + 10);
+  check(writer.write(code, buffer) == stl.size()
+            && std::equal(stl.begin(), stl.end(), buffer.begin()),
+        std::string(what) + ", into a buffer");
+  std::FILE* file = std::tmpfile();
+  writer.write(code, fileno(file));
+  std::vector<std::uint8_t> written(stl.size() + 1);
+  std::rewind(file);
+  written.resize(std::fread(written.data(), 1, written.size(), file));
+  std::fclose(file);
+  check(written == stl, std::string(what) + ", to a file descriptor");
+
+  bool threw = false;
+  try {
+    std::vector<std::uint8_t> small(stl.size() - 1);
+    writer.write(code, small);
+  } catch (const std::logic_error&) {
+    threw = true;
+  }
+  check(threw, std::string(what) + ", a small buffer throws");
+}
+
+int main() {
+  Encoder& encoder = Encoder::getThreadLocal();
+  const QRBitmap small = encoder.encode("HELLO", QRCode::ErrCor::kLow, 0);
+  const QRBitmap large = encoder.encode(std::string(1000, 'm'),
+                                        QRCode::ErrCor::kLow,
+                                        QRCode::kAutoMask);
+  const std::vector<std::uint8_t> rmqr = PackedQRCode::serialize(
+      QRCode("rectangular", QRCode::ErrCor::kMedium, 0,
+             QRCode::SymbolType::kRectMicro, 9));
+
+  StlSettings loose;
+  StlSettings plate;
+  plate.block_size = 0.5;
+  plate.height = 2;
+  plate.base = 1.5;
+  plate.quiet_zone = 2;
+  StlSettings edge = plate;
+  edge.quiet_zone = 0;
+  for (const StlSettings& settings : {loose, plate, edge}) {
+    const std::string what = settings.base > 0
+        ? "STL on a plate, quiet zone " + std::to_string(settings.quiet_zone)
+        : std::string("STL without a plate");
+    checkCode(small, settings, what);
+    checkCode(PackedQRCode(rmqr), settings, what + ", rMQR");
+    checkCode(large, settings, what + ", large code");
+  }
+
+  if (failures != 0) {
+    std::cerr << failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "stl_test passed\n";
+  return 0;
+}
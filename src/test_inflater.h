@@ -0,0 +1,141 @@
+#ifndef TEST_INFLATER_H_
+#define TEST_INFLATER_H_
+
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// Adler-32 a byte at a time, not shared with the writers.
+inline std::uint32_t adler32(const std::vector<std::uint8_t>& data) {
+  std::uint32_t a = 1;
+  std::uint32_t b = 0;
+  for (std::uint8_t byte : data) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  return b << 16 | a;
+}
+
+// Inflates the stored and fixed Huffman blocks the writers make, for the
+// tests. Throws on anything else.
+class Inflater {
+ public:
+  explicit Inflater(std::span<const std::uint8_t> in) : in_(in) {}
+
+  std::vector<std::uint8_t> inflate() {
+    std::vector<std::uint8_t> out;
+    bool final = false;
+    while (!final) {
+      final = getBits(1) != 0;
+      const int type = getBits(2);
+      if (type == 0) {
+        bit_ = (bit_ + 7) & ~7;
+        const std::size_t at = bit_ / 8;
+        if (at + 4 > in_.size()) {
+          throw std::runtime_error("Stored block cut short.");
+        }
+        const int length = in_[at] | in_[at + 1] << 8;
+        if ((length ^ (in_[at + 2] | in_[at + 3] << 8)) != 0xFFFF
+            || at + 4 + length > in_.size()) {
+          throw std::runtime_error("Bad stored block.");
+        }
+        out.insert(out.end(), in_.begin() + at + 4,
+                   in_.begin() + at + 4 + length);
+        bit_ = (at + 4 + length) * 8;
+      } else if (type == 1) {
+        inflateFixed(out);
+      } else {
+        throw std::runtime_error("Unexpected block type.");
+      }
+    }
+    position_ = (bit_ + 7) / 8;
+    return out;
+  }
+
+  // Bytes used, once inflate() has returned.
+  std::size_t getPosition() const { return position_; }
+
+ private:
+  int getBits(int count) {
+    int value = 0;
+    for (int i = 0; i < count; ++i, ++bit_) {
+      if (bit_ / 8 >= in_.size()) {
+        throw std::runtime_error("Stream cut short.");
+      }
+      value |= ((in_[bit_ / 8] >> (bit_ % 8)) & 1) << i;
+    }
+    return value;
+  }
+
+  // Huffman codes are read from their first bit.
+  int getCode(int count) {
+    int code = 0;
+    for (int i = 0; i < count; ++i) {
+      code = code << 1 | getBits(1);
+    }
+    return code;
+  }
+
+  int getSymbol() {
+    int code = getCode(7);
+    if (code < 24) {
+      return 256 + code;
+    }
+    code = code << 1 | getBits(1);
+    if (code >= 0x30 && code < 0xC0) {
+      return code - 0x30;
+    }
+    if (code >= 0xC0 && code < 0xC8) {
+      return 280 + code - 0xC0;
+    }
+    code = code << 1 | getBits(1);
+    return 144 + code - 0x190;
+  }
+
+  void inflateFixed(std::vector<std::uint8_t>& out) {
+    static const int kLengths[] = {
+      3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51,
+      59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const int kLengthBits[] = {
+      0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+      5, 5, 5, 5, 0 };
+    static const int kDistances[] = {
+      1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+      513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385,
+      24577 };
+    for (;;) {
+      const int symbol = getSymbol();
+      if (symbol < 256) {
+        out.push_back(static_cast<std::uint8_t>(symbol));
+        continue;
+      }
+      if (symbol == 256) {
+        return;
+      }
+      if (symbol > 285) {
+        throw std::runtime_error("Bad length symbol.");
+      }
+      const int length = kLengths[symbol - 257]
+                         + getBits(kLengthBits[symbol - 257]);
+      const int code = getCode(5);
+      if (code > 29) {
+        throw std::runtime_error("Bad distance symbol.");
+      }
+      const std::size_t distance = kDistances[code]
+                                   + getBits(code < 4 ? 0 : code / 2 - 1);
+      if (distance > out.size() || distance > 32768) {
+        throw std::runtime_error("Distance too far back.");
+      }
+      for (int i = 0; i < length; ++i) {
+        out.push_back(out[out.size() - distance]);
+      }
+    }
+  }
+
+  std::span<const std::uint8_t> in_;
+  std::size_t bit_ = 0;
+  std::size_t position_ = 0;
+}; // Inflater
+
+#endif // TEST_INFLATER_H_
@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed number of worker threads that run submitted tasks in the order
+// they were given.
+class ThreadPool {
+ public:
+  // Constructor, zero threads uses one thread per hardware thread.
+  explicit ThreadPool(int num_threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Queues a task, the result (or exception) is returned through the future.
+  template <typename Task>
+  std::future<std::invoke_result_t<Task>> submit(Task task);
+
+  int getNumThreads() const { return static_cast<int>(workers_.size()); }
+
+  // Pool shared by callers that do not provide their own.
+  static ThreadPool& getDefault();
+
+ private:
+  void workerLoop();
+
+  std::vector<std::thread> workers_;         // Worker threads
+  std::deque<std::function<void()> > tasks_; // Tasks waiting to run
+  std::mutex mutex_;                         // Guards 'tasks_' and 'stopping_'
+  std::condition_variable ready_;            // Signals a new task or stop
+  bool stopping_;                            // Set when the pool is destroyed
+}; // ThreadPool
+
+template <typename Task>
+std::future<std::invoke_result_t<Task>> ThreadPool::submit(Task task) {
+  // std::function needs a copyable target, so the packaged task is shared.
+  auto packaged = std::make_shared<std::packaged_task<
+      std::invoke_result_t<Task>()> >(std::move(task));
+  std::future<std::invoke_result_t<Task>> result = packaged->get_future();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.emplace_back([packaged]() { (*packaged)(); });
+  }
+  ready_.notify_one();
+  return result;
+}
+
+#endif // THREAD_POOL_H_
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+#include "qr_packed.h"
+#include "qr_tiff.h"
+
+static int failures = 0;
+
+static void check(bool passed, std::string_view what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << "\n";
+    ++failures;
+  }
+}
+
+// Codes of the T.4 runs, from 0 pixels up, then the make up codes from 64
+// up in steps of 64, as written in the standard.
+static const char* const kWhiteRuns[] = {
+  "00110101", "000111", "0111", "1000", "1011", "1100", "1110", "1111",
+  "10011", "10100", "00111", "01000", "001000", "000011", "110100",
+  "110101", "101010", "101011", "0100111", "0001100", "0001000", "0010111",
+  "0000011", "0000100", "0101000", "0101011", "0010011", "0100100",
+  "0011000", "00000010", "00000011", "00011010", "00011011", "00010010",
+  "00010011", "00010100", "00010101", "00010110", "00010111", "00101000",
+  "00101001", "00101010", "00101011", "00101100", "00101101", "00000100",
+  "00000101", "00001010", "00001011", "01010010", "01010011", "01010100",
+  "01010101", "00100100", "00100101", "01011000", "01011001", "01011010",
+  "01011011", "01001010", "01001011", "00110010", "00110011", "00110100",
+};
+static const char* const kWhiteMakeup[] = {
+  "11011", "10010", "010111", "0110111", "00110110", "00110111",
+  "01100100", "01100101", "01101000", "01100111", "011001100", "011001101",
+  "011010010", "011010011", "011010100", "011010101", "011010110",
+  "011010111", "011011000", "011011001", "011011010", "011011011",
+  "010011000", "010011001", "010011010", "011000", "010011011",
+};
+static const char* const kBlackRuns[] = {
+  "0000110111", "010", "11", "10", "011", "0011", "0010", "00011", "000101",
+  "000100", "0000100", "0000101", "0000111", "00000100", "00000111",
+  "000011000", "0000010111", "0000011000", "0000001000", "00001100111",
+  "00001101000", "00001101100", "00000110111", "00000101000",
+  "00000010111", "00000011000", "000011001010", "000011001011",
+  "000011001100", "000011001101", "000001101000", "000001101001",
+  "000001101010", "000001101011", "000011010010", "000011010011",
+  "000011010100", "000011010101", "000011010110", "000011010111",
+  "000001101100", "000001101101", "000011011010", "000011011011",
+  "000001010100", "000001010101", "000001010110", "000001010111",
+  "000001100100", "000001100101", "000001010010", "000001010011",
+  "000000100100", "000000110111", "000000111000", "000000100111",
+  "000000101000", "000001011000", "000001011001", "000000101011",
+  "000000101100", "000001011010", "000001100110", "000001100111",
+};
+static const char* const kBlackMakeup[] = {
+  "0000001111", "000011001000", "000011001001", "000001011011",
+  "000000110011", "000000110100", "000000110101", "0000001101100",
+  "0000001101101", "0000001001010", "0000001001011", "0000001001100",
+  "0000001001101", "0000001110010", "0000001110011", "0000001110100",
+  "0000001110101", "0000001110110", "0000001110111", "0000001010010",
+  "0000001010011", "0000001010100", "0000001010101", "0000001011010",
+  "0000001011011", "0000001100100", "0000001100101",
+};
+// Make up codes of either color from 1792 up.
+static const char* const kExtendedMakeup[] = {
+  "00000001000", "00000001100", "00000001101", "000000010010",
+  "000000010011", "000000010100", "000000010101", "000000010110",
+  "000000010111", "000000011100", "000000011101", "000000011110",
+  "000000011111",
+};
+
+// Decodes a T.6 (Group 4) strip, one byte for each pixel, 1 for black.
+class FaxDecoder {
+ public:
+  FaxDecoder(const std::uint8_t* data, std::size_t length)
+      : data_(data), length_(length) {
+    for (int i = 0; i < 64; ++i) {
+      white_[kWhiteRuns[i]] = i;
+      black_[kBlackRuns[i]] = i;
+    }
+    for (int i = 0; i < 27; ++i) {
+      white_[kWhiteMakeup[i]] = 64 * (i + 1);
+      black_[kBlackMakeup[i]] = 64 * (i + 1);
+    }
+    for (int i = 0; i < 13; ++i) {
+      white_[kExtendedMakeup[i]] = 1792 + 64 * i;
+      black_[kExtendedMakeup[i]] = 1792 + 64 * i;
+    }
+  }
+
+  std::vector<std::uint8_t> decode(int width, int height) {
+    std::vector<std::uint8_t> pixels;
+    pixels.reserve(static_cast<std::size_t>(width) * height);
+
+    // Changes of color of the reference and coding lines, the first from
+    // white to black.
+    std::vector<int> reference;
+    std::vector<int> coding;
+    for (int y = 0; y < height; ++y) {
+      coding.clear();
+      int a0 = -1;
+      bool black = false;
+      while (a0 < width) {
+        // b1 is the first change on the reference line right of a0 to the
+        // color opposite a0's, b2 the change after it.
+        std::size_t i = 0;
+        while (i < reference.size()
+               && (reference[i] <= a0 || (i % 2 == 1) != black)) {
+          ++i;
+        }
+        const int b1 = i < reference.size() ? reference[i] : width;
+        const int b2 = i + 1 < reference.size() ? reference[i + 1] : width;
+
+        const std::string mode = readMode();
+        if (mode == "0001") {
+          a0 = b2;
+        } else if (mode == "001") {
+          const int start = std::max(a0, 0);
+          const int a1 = start + readRun(black);
+          const int a2 = a1 + readRun(!black);
+          if (a1 > width || a2 > width) {
+            throw std::runtime_error("Run past the end of the line.");
+          }
+          coding.push_back(a1);
+          coding.push_back(a2);
+          a0 = a2;
+        } else {
+          static const std::map<std::string, int> kVertical = {
+            {"1", 0}, {"011", 1}, {"000011", 2}, {"0000011", 3},
+            {"010", -1}, {"000010", -2}, {"0000010", -3} };
+          const int a1 = b1 + kVertical.at(mode);
+          if (a1 < std::max(a0, 0) || a1 > width) {
+            throw std::runtime_error("Vertical mode off the line.");
+          }
+          coding.push_back(a1);
+          a0 = a1;
+          black = !black;
+        }
+      }
+
+      bool color = false;
+      std::size_t change = 0;
+      for (int x = 0; x < width; ++x) {
+        while (change < coding.size() && coding[change] <= x) {
+          color = !color;
+          ++change;
+        }
+        pixels.push_back(color);
+      }
+      while (!coding.empty() && coding.back() >= width) {
+        coding.pop_back();
+      }
+      reference.swap(coding);
+    }
+
+    if (readBits(24) != "000000000001000000000001") {
+      throw std::runtime_error("No end of facsimile block.");
+    }
+    return pixels;
+  }
+
+ private:
+  char readBit() {
+    if (bit_ / 8 >= length_) {
+      throw std::runtime_error("Strip cut short.");
+    }
+    const int bit = (data_[bit_ / 8] >> (7 - bit_ % 8)) & 1;
+    ++bit_;
+    return bit != 0 ? '1' : '0';
+  }
+
+  std::string readBits(int count) {
+    std::string bits;
+    for (int i = 0; i < count; ++i) {
+      bits += readBit();
+    }
+    return bits;
+  }
+
+  std::string readMode() {
+    static const char* const kModes[] = {
+      "1", "011", "010", "001", "0001", "000011", "000010", "0000011",
+      "0000010" };
+    std::string bits;
+    while (bits.size() < 7) {
+      bits += readBit();
+      for (const char* mode : kModes) {
+        if (bits == mode) {
+          return bits;
+        }
+      }
+    }
+    throw std::runtime_error("Unknown mode " + bits);
+  }
+
+  // Make up codes followed by a terminating code.
+  int readRun(bool black) {
+    const std::map<std::string, int>& codes = black ? black_ : white_;
+    int total = 0;
+    for (;;) {
+      std::string bits;
+      auto found = codes.end();
+      while (found == codes.end()) {
+        if (bits.size() == 13) {
+          throw std::runtime_error("Unknown run code " + bits);
+        }
+        bits += readBit();
+        found = codes.find(bits);
+      }
+      total += found->second;
+      if (found->second < 64) {
+        return total;
+      }
+    }
+  }
+
+  const std::uint8_t* data_;
+  std::size_t length_;
+  std::size_t bit_ = 0;
+  std::map<std::string, int> white_;
+  std::map<std::string, int> black_;
+}; // FaxDecoder
+
+static std::uint32_t read16(const std::vector<std::uint8_t>& data,
+                            std::size_t at) {
+  return data.at(at) | data.at(at + 1) << 8;
+}
+
+static std::uint32_t read32(const std::vector<std::uint8_t>& data,
+                            std::size_t at) {
+  return read16(data, at) | read16(data, at + 2) << 16;
+}
+
+// A decoded TIFF, one byte for each pixel, 1 where it shows black.
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<std::uint8_t> pixels;
+}; // Image
+
+// Reads a little endian, one strip Group 4 TIFF.
+static Image decodeTiff(const std::vector<std::uint8_t>& tiff) {
+  if (tiff.size() < 8 || tiff[0] != 'I' || tiff[1] != 'I'
+      || read16(tiff, 2) != 42) {
+    throw std::runtime_error("Not a little endian TIFF.");
+  }
+  const std::size_t ifd = read32(tiff, 4);
+  std::map<int, std::uint32_t> tags;
+  const int count = static_cast<int>(read16(tiff, ifd));
+  for (int i = 0; i < count; ++i) {
+    const std::size_t entry = ifd + 2 + 12 * i;
+    const int type = static_cast<int>(read16(tiff, entry + 2));
+    if (read32(tiff, entry + 4) != 1) {
+      throw std::runtime_error("Tag with more than one value.");
+    }
+    tags[static_cast<int>(read16(tiff, entry))] =
+        type == 3 ? read16(tiff, entry + 8) : read32(tiff, entry + 8);
+  }
+  if (read32(tiff, ifd + 2 + 12 * count) != 0) {
+    throw std::runtime_error("More than one IFD.");
+  }
+  if (tags[258] != 1 || tags[259] != 4 || tags[277] != 1
+      || tags[262] > 1 || tags[278] != tags[257]) {
+    throw std::runtime_error("Not a one strip Group 4 bilevel TIFF.");
+  }
+  const std::size_t offset = tags[273];
+  const std::size_t length = tags[279];
+  if (offset + length > tiff.size()) {
+    throw std::runtime_error("Strip past the end of the file.");
+  }
+
+  Image image;
+  image.width = static_cast<int>(tags[256]);
+  image.height = static_cast<int>(tags[257]);
+  FaxDecoder decoder(tiff.data() + offset, length);
+  image.pixels = decoder.decode(image.width, image.height);
+
+  // Black is zero swaps the colors shown.
+  if (tags[262] == 1) {
+    for (std::uint8_t& pixel : image.pixels) {
+      pixel ^= 1;
+    }
+  }
+  return image;
+}
+
+// Every pixel is the block under it, or light in the quiet zone, and dark
+// blocks show black unless inverted.
+static bool matches(const Image& image, const QRImage& code, int scale,
+                    int quiet_zone, bool invert) {
+  if (image.width != (code.getWidth() + 2 * quiet_zone) * scale
+      || image.height != (code.getHeight() + 2 * quiet_zone) * scale) {
+    return false;
+  }
+  for (int y = 0; y < image.height; ++y) {
+    for (int x = 0; x < image.width; ++x) {
+      const int block_x = x / scale - quiet_zone;
+      const int block_y = y / scale - quiet_zone;
+      const bool dark = block_x >= 0 && block_y >= 0
+                        && block_x < code.getWidth()
+                        && block_y < code.getHeight()
+                        && code.getBlock(block_x, block_y);
+      if (image.pixels[y * image.width + x] != (dark != invert)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void checkCode(const QRImage& code, int scale, int quiet_zone,
+                      bool invert) {
+  const std::string what = "TIFF at scale " + std::to_string(scale)
+                           + " quiet zone " + std::to_string(quiet_zone)
+                           + (invert ? " inverted" : "");
+  const TiffWriter writer(scale, quiet_zone, invert);
+  const std::vector<std::uint8_t> tiff = writer.encode(code);
+  try {
+    check(matches(decodeTiff(tiff), code, scale, quiet_zone, invert), what);
+  } catch (const std::exception& error) {
+    check(false, what + ": " + error.what());
+  }
+
+  // A reused vector and the file descriptor get the same bytes.
+  std::vector<std::uint8_t> reused(5, 1);
+  writer.encode(code, reused);
+  check(reused == tiff, what + ", into a reused vector");
+
+  std::FILE* file = std::tmpfile();
+  writer.write(code, fileno(file));
+  std::vector<std::uint8_t> written(tiff.size() + 1);
+  std::rewind(file);
+  written.resize(std::fread(written.data(), 1, written.size(), file));
+  std::fclose(file);
+  check(written == tiff, what + ", to a file descriptor");
+}
+
+int main() {
+  Encoder& encoder = Encoder::getThreadLocal();
+  const QRBitmap small = encoder.encode("HELLO", QRCode::ErrCor::kLow, 0);
+  const QRBitmap large = encoder.encode(std::string(2000, 'z'),
+                                        QRCode::ErrCor::kLow,
+                                        QRCode::kAutoMask);
+  const std::vector<std::uint8_t> rmqr = PackedQRCode::serialize(
+      QRCode("rectangular", QRCode::ErrCor::kMedium, 0,
+             QRCode::SymbolType::kRectMicro, 9));
+  const std::vector<std::uint8_t> micro = PackedQRCode::serialize(
+      QRCode("12345", QRCode::ErrCor::kLow, 0, QRCode::SymbolType::kMicro));
+  for (int scale : {1, 2, 5}) {
+    for (int quiet_zone : {0, 4}) {
+      for (bool invert : {false, true}) {
+        checkCode(small, scale, quiet_zone, invert);
+        checkCode(PackedQRCode(rmqr), scale, quiet_zone, invert);
+        checkCode(PackedQRCode(micro), scale, quiet_zone, invert);
+      }
+    }
+  }
+
+  // Runs of more than 64 and 1728 pixels take make up codes.
+  checkCode(large, 1, 4, false);
+  checkCode(small, 90, 1, false);
+  checkCode(large, 12, 4, true);
+
+  if (failures != 0) {
+    std::cerr << failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "tiff_test passed\n";
+  return 0;
+}
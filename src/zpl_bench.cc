@@ -0,0 +1,57 @@
+#include <cstddef>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+#include "qr_zpl.h"
+
+// Prints the bytes of each kind of label for a few versions and scales:
+// the native ^BQ command, the graphic field compressed with ZPL's ASCII
+// scheme or as Z64, and the graphic field as plain hex, which is what a
+// label costs without any compression.
+int main() {
+  const int kCodes = 100;
+  Encoder& encoder = Encoder::getThreadLocal();
+  std::printf("version scale  native     acs     z64  plain hex\n");
+  for (int length : {20, 100, 400, 1500}) {
+    for (int scale : {2, 4, 8}) {
+      const ZplWriter acs(scale, 4, ZplWriter::Compression::kAcs);
+      const ZplWriter z64(scale, 4, ZplWriter::Compression::kZ64);
+      std::mt19937 random(length);
+      std::string label;
+      std::size_t native_bytes = 0;
+      std::size_t acs_bytes = 0;
+      std::size_t z64_bytes = 0;
+      std::size_t hex_bytes = 0;
+      int version = 0;
+      for (int i = 0; i < kCodes; ++i) {
+        std::string text;
+        for (int j = 0; j < length; ++j) {
+          text += static_cast<char>('a' + random() % 26);
+        }
+        QRBitmap code = encoder.encode(text, QRCode::ErrCor::kMedium,
+                                       QRCode::kAutoMask);
+        version = code.getVersion();
+        native_bytes += ZplWriter::renderNative(
+            text, QRCode::ErrCor::kMedium, code.getMask(), scale).size();
+        acs.render(code, label);
+        acs_bytes += label.size();
+        z64.render(code, label);
+        z64_bytes += label.size();
+
+        // Two hex digits for each byte of each row of dots.
+        const std::size_t dots = (code.getSize() + 8) * scale;
+        hex_bytes += 2 * ((dots + 7) / 8) * dots;
+        encoder.recycle(std::move(code));
+      }
+      std::printf("%7d %5d %7zu %7zu %7zu %10zu\n", version, scale,
+                  native_bytes / kCodes, acs_bytes / kCodes,
+                  z64_bytes / kCodes, hex_bytes / kCodes);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,271 @@
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "encoder.h"
+#include "qr.h"
+#include "qr_packed.h"
+#include "qr_zpl.h"
+#include "test_inflater.h"
+
+static int failures = 0;
+
+static void check(bool passed, std::string_view what) {
+  if (!passed) {
+    std::cerr << "FAILED: " << what << "\n";
+    ++failures;
+  }
+}
+
+static int hexValue(char digit) {
+  if (digit >= '0' && digit <= '9') {
+    return digit - '0';
+  }
+  if (digit >= 'A' && digit <= 'F') {
+    return digit - 'A' + 10;
+  }
+  throw std::runtime_error(std::string("Not a hex digit: ") + digit);
+}
+
+// Rows of hex digits with ZPL's ASCII compression: 'G' - 'Y' and 'g' - 'z'
+// repeat the next digit, ',' and '!' fill the row with 0 or F and ':'
+// repeats the row above.
+static std::vector<std::uint8_t> decodeAcs(std::string_view data,
+                                           std::size_t row_length) {
+  std::vector<std::string> rows;
+  std::string row;
+  std::size_t count = 0;
+  for (char ch : data) {
+    if (ch == ':' && row.empty() && count == 0) {
+      if (rows.empty()) {
+        throw std::runtime_error("':' before the first row.");
+      }
+      rows.push_back(rows.back());
+      continue;
+    }
+    if (ch >= 'G' && ch <= 'Y') {
+      count += ch - 'G' + 1;
+    } else if (ch >= 'g' && ch <= 'z') {
+      count += 20 * (ch - 'g' + 1);
+    } else if (ch == ',' || ch == '!') {
+      row.append(2 * row_length - row.size(), ch == ',' ? '0' : 'F');
+    } else {
+      hexValue(ch);
+      row.append(count == 0 ? 1 : count, ch);
+      count = 0;
+    }
+    if (row.size() > 2 * row_length) {
+      throw std::runtime_error("Row too long.");
+    }
+    if (row.size() == 2 * row_length) {
+      rows.push_back(row);
+      row.clear();
+    }
+  }
+  if (!row.empty() || count != 0) {
+    throw std::runtime_error("Last row not finished.");
+  }
+
+  std::vector<std::uint8_t> bytes;
+  for (const std::string& hex : rows) {
+    for (std::size_t i = 0; i < hex.size(); i += 2) {
+      bytes.push_back(static_cast<std::uint8_t>(
+          hexValue(hex[i]) << 4 | hexValue(hex[i + 1])));
+    }
+  }
+  return bytes;
+}
+
+// ":Z64:", Base64 of a zlib stream, ':' and the CRC-16 of the Base64 text.
+static std::vector<std::uint8_t> decodeZ64(std::string_view data) {
+  static const std::string_view kBase64 =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  if (data.substr(0, 5) != ":Z64:" || data.size() < 10
+      || data[data.size() - 5] != ':') {
+    throw std::runtime_error("Not a Z64 field.");
+  }
+  const std::string_view text = data.substr(5, data.size() - 10);
+  std::uint32_t crc = 0;
+  for (char ch : text) {
+    crc ^= static_cast<std::uint32_t>(static_cast<std::uint8_t>(ch)) << 8;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc << 1 ^ (crc & 0x8000 ? 0x1021 : 0)) & 0xFFFF;
+    }
+  }
+  std::uint32_t expected = 0;
+  for (char digit : data.substr(data.size() - 4)) {
+    expected = expected << 4 | hexValue(digit);
+  }
+  if (crc != expected || text.size() % 4 != 0) {
+    throw std::runtime_error("Bad Z64 CRC.");
+  }
+
+  std::vector<std::uint8_t> stream;
+  for (std::size_t i = 0; i < text.size(); i += 4) {
+    std::uint32_t group = 0;
+    int padding = 0;
+    for (std::size_t j = i; j < i + 4; ++j) {
+      const std::size_t value = kBase64.find(text[j]);
+      if (text[j] == '=') {
+        ++padding;
+      } else if (value == std::string_view::npos || padding > 0) {
+        throw std::runtime_error("Bad Base64.");
+      }
+      group = group << 6 | (text[j] == '=' ? 0 : value);
+    }
+    for (int k = 0; k < 3 - padding; ++k) {
+      stream.push_back(static_cast<std::uint8_t>(group >> (16 - 8 * k)));
+    }
+  }
+
+  if (stream.size() < 6 || stream[0] != 0x78
+      || (stream[0] << 8 | stream[1]) % 31 != 0) {
+    throw std::runtime_error("Bad zlib header.");
+  }
+  Inflater inflater(std::span<const std::uint8_t>(stream).subspan(2));
+  const std::vector<std::uint8_t> raw = inflater.inflate();
+  const std::uint8_t* end = &stream[stream.size() - 4];
+  if (inflater.getPosition() + 6 != stream.size()
+      || adler32(raw) != (static_cast<std::uint32_t>(end[0]) << 24
+                          | end[1] << 16 | end[2] << 8 | end[3])) {
+    throw std::runtime_error("Bad Adler-32.");
+  }
+  return raw;
+}
+
+// Checks the label is one graphic field of the code, every dot printed for
+// a dark block and none for the quiet zone.
+static void checkLabel(const std::string& zpl, const QRImage& code,
+                       int scale, int quiet_zone, std::string_view what) {
+  static const std::string_view kStart = "^XA\n^FO0,0^GFA,";
+  static const std::string_view kEnd = "^FS\n^XZ\n";
+  try {
+    if (zpl.substr(0, kStart.size()) != kStart || zpl.size() < kEnd.size()
+        || zpl.substr(zpl.size() - kEnd.size()) != kEnd) {
+      throw std::runtime_error("Not a graphic field label.");
+    }
+    std::size_t at = kStart.size();
+    std::size_t numbers[3];
+    for (std::size_t& number : numbers) {
+      const std::size_t comma = zpl.find(',', at);
+      number = std::stoul(zpl.substr(at, comma - at));
+      at = comma + 1;
+    }
+    const std::string_view data(zpl.data() + at,
+                                zpl.size() - kEnd.size() - at);
+
+    const int width = (code.getWidth() + 2 * quiet_zone) * scale;
+    const int height = (code.getHeight() + 2 * quiet_zone) * scale;
+    const std::size_t row_length = (width + 7) / 8;
+    if (numbers[0] != row_length * height || numbers[1] != numbers[0]
+        || numbers[2] != row_length) {
+      throw std::runtime_error("Wrong field size.");
+    }
+    const std::vector<std::uint8_t> dots =
+        data.substr(0, 5) == ":Z64:" ? decodeZ64(data)
+                                     : decodeAcs(data, row_length);
+    bool same = dots.size() == numbers[0];
+    for (int y = 0; same && y < height; ++y) {
+      for (int x = 0; x < width; ++x) {
+        const int block_x = x / scale - quiet_zone;
+        const int block_y = y / scale - quiet_zone;
+        const bool dark = block_x >= 0 && block_y >= 0
+                          && block_x < code.getWidth()
+                          && block_y < code.getHeight()
+                          && code.getBlock(block_x, block_y);
+        same = same && ((dots[y * row_length + x / 8] >> (7 - x % 8)) & 1)
+                           == dark;
+      }
+    }
+    check(same, what);
+  } catch (const std::exception& error) {
+    check(false, std::string(what) + ": " + error.what());
+  }
+}
+
+static void checkCode(const QRImage& code, int scale, int quiet_zone,
+                      ZplWriter::Compression compression) {
+  const std::string what = "ZPL at scale " + std::to_string(scale)
+                           + " quiet zone " + std::to_string(quiet_zone)
+                           + (compression == ZplWriter::Compression::kZ64
+                                  ? " z64" : " acs");
+  const ZplWriter writer(scale, quiet_zone, compression);
+  const std::string zpl = writer.render(code);
+  checkLabel(zpl, code, scale, quiet_zone, what);
+
+  // A reused string and the file descriptor get the same label.
+  std::string reused = "old label";
+  writer.render(code, reused);
+  check(reused == zpl, what + ", into a reused string");
+
+  std::FILE* file = std::tmpfile();
+  writer.write(code, fileno(file));
+  std::string written(zpl.size() + 1, '\0');
+  std::rewind(file);
+  written.resize(std::fread(written.data(), 1, written.size(), file));
+  std::fclose(file);
+  check(written == zpl, what + ", to a file descriptor");
+}
+
+static void testGraphicField() {
+  Encoder& encoder = Encoder::getThreadLocal();
+  const QRBitmap small = encoder.encode("HELLO", QRCode::ErrCor::kLow, 0);
+  const QRBitmap large = encoder.encode(std::string(1500, 'q'),
+                                        QRCode::ErrCor::kLow,
+                                        QRCode::kAutoMask);
+  const std::vector<std::uint8_t> rmqr = PackedQRCode::serialize(
+      QRCode("rectangular", QRCode::ErrCor::kMedium, 0,
+             QRCode::SymbolType::kRectMicro, 9));
+  for (ZplWriter::Compression compression :
+       {ZplWriter::Compression::kAcs, ZplWriter::Compression::kZ64}) {
+    for (int scale : {1, 3, 8}) {
+      for (int quiet_zone : {0, 4}) {
+        checkCode(small, scale, quiet_zone, compression);
+        checkCode(PackedQRCode(rmqr), scale, quiet_zone, compression);
+      }
+    }
+    // Runs of more than 400 digits take several 'z' counts.
+    checkCode(large, 10, 4, compression);
+  }
+}
+
+static bool nativeThrows(int mask, int magnification) {
+  try {
+    ZplWriter::renderNative("text", QRCode::ErrCor::kLow, mask,
+                            magnification);
+  } catch (const std::logic_error&) {
+    return true;
+  }
+  return false;
+}
+
+// ^BQ is given the level and mask, and the field data escapes what ZPL
+// would read as a command.
+static void testNative() {
+  check(ZplWriter::renderNative("A^b~c_d\ne", QRCode::ErrCor::kQuartile, 5,
+                                3)
+            == "^XA\n^FO0,0^BQN,2,3,Q,5^FH^FDQA,A_5Eb_7Ec_5Fd_0Ae^FS\n"
+               "^XZ\n",
+        "native label");
+  check(!nativeThrows(0, 1) && !nativeThrows(7, 10), "native mask 0 - 7");
+  check(nativeThrows(QRCode::kAutoMask, 4) && nativeThrows(8, 4),
+        "native label needs a mask");
+  check(nativeThrows(0, 0) && nativeThrows(0, 11),
+        "native magnification 1 - 10");
+}
+
+int main() {
+  testGraphicField();
+  testNative();
+  if (failures != 0) {
+    std::cerr << failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "zpl_test passed\n";
+  return 0;
+}